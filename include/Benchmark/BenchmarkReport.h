@@ -0,0 +1,72 @@
+#ifndef BENCHMARKREPORT_H
+#define BENCHMARKREPORT_H
+
+#include <fstream>
+#include <string>
+
+class FrameStats;
+
+/*!
+    JSON report of a benchmark: top level fields, then an array of runs, each with its own
+    fields and a FrameStats' summaries. It is written as it goes, so every top level field
+    has to be added before the first run.
+*/
+class BenchmarkReport
+{
+public:
+    BenchmarkReport();
+
+    /*!
+        Opens path, printing why when it can't. runs names the array the runs go in.
+    */
+    bool open(const std::string& path, const std::string& runs = "runs");
+
+    // Numbers and booleans as the stream writes them, strings quoted and escaped
+    template <typename T> void addField(const std::string& name, T value);
+    void addField(const std::string& name, const std::string& value);
+    void addField(const std::string& name, const char* value);
+    /*!
+        Adds json as it is, for nested objects and arrays
+    */
+    void addJsonField(const std::string& name, const std::string& json);
+    /*!
+        Adds the "cpuMs" and "gpuMs" summaries of stats as an object
+    */
+    void addSummaryField(const std::string& name, FrameStats& stats);
+
+    /*!
+        Starts the next run, its fields go in until endRun
+    */
+    void beginRun();
+    template <typename T> void addRunField(const std::string& name, T value);
+    void addRunField(const std::string& name, const std::string& value);
+    void addRunField(const std::string& name, const char* value);
+    /*!
+        Ends the run with the summaries of stats
+    */
+    void endRun(FrameStats& stats);
+
+    /*!
+        Ends the report and prints where it went, false if writing failed
+    */
+    bool close();
+
+private:
+    std::ofstream out;
+    std::string path;
+    std::string runsName;
+    int runCount;
+    bool runsOpen;
+};
+
+template <typename T> void BenchmarkReport::addField(const std::string& name, T value)
+{
+    this->out << "  \"" << name << "\": " << value << ",\n";
+}
+
+template <typename T> void BenchmarkReport::addRunField(const std::string& name, T value)
+{
+    this->out << "\"" << name << "\": " << value << ", ";
+}
+
+#endif // BENCHMARKREPORT_H
@@ -0,0 +1,67 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+class MainWindow;
+
+/*!
+    The benchmark modes, each writing its JSON report to the settings' benchmarkOutput. The
+    scene benchmarks drive the MainWindow's scene and frame loop, the others only read its
+    settings and GL context.
+*/
+class Benchmarks
+{
+public:
+    Benchmarks(MainWindow* mainWindow);
+
+    /*!
+        Renders the loaded scene for the configured frames, or sweeps light counts or compares
+        the depth pre-pass off and on when the settings ask for it
+    */
+    void runSceneBenchmark();
+
+    /*!
+        Times cold texture loads from JPEG and from cooked files
+    */
+    void runTextureBenchmark();
+    /*!
+        Times loading the --mesh file by parsing it and from its cache
+    */
+    void runMeshBenchmark();
+    /*!
+        Times the SIMD culling kernel against the scalar reference on a million random spheres
+    */
+    void runCullBenchmark();
+    /*!
+        Times rasterizing a wall of occluders with the SIMD kernel, on one thread and in parallel,
+        against the scalar reference, and testing 100k boxes behind and around it
+    */
+    void runOcclusionBenchmark();
+    /*!
+        Times TransformStore updates of a ~100k node hierarchy, whole tree and scattered subtrees
+    */
+    void runTransformBenchmark();
+    /*!
+        Times empty jobs and parallelFor calls, then a compute bound parallelFor on 1..N threads
+    */
+    void runJobBenchmark();
+    /*!
+        Times recording 10k and 100k draws on one thread and on the job system, and their replay
+    */
+    void runCommandBenchmark();
+    /*!
+        Times building the scene's programs without and with the binary cache, on the GL thread
+        and on the shader compiler thread
+    */
+    void runShaderBenchmark();
+
+private:
+    MainWindow* mainWindow;
+
+    void runLightSweep();
+    /*!
+        Runs the scene with the depth pre-pass off and then on, comparing GPU time and shaded fragments
+    */
+    void runPrepassComparison();
+};
+
+#endif // BENCHMARKS_H
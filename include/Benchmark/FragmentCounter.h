@@ -0,0 +1,34 @@
+#ifndef FRAGMENTCOUNTER_H
+#define FRAGMENTCOUNTER_H
+
+#include "Benchmark/QueryRing.h"
+
+#include <vector>
+
+/*!
+    Counts the fragments frames shade with a ring of GL_SAMPLES_PASSED queries, which the
+    RenderQueue wraps around its opaque pass
+*/
+class FragmentCounter
+{
+public:
+    bool init();
+
+    /*!
+        Query to hand to RenderQueue::setFragmentQuery for this frame, 0 when not counting.
+        The queue's execute must run before endFrame.
+    */
+    unsigned int beginFrame();
+    void endFrame();
+
+    /*!
+        Appends the samples passed of every finished frame, oldest first.
+        With wait set, blocks until all outstanding queries have resolved.
+    */
+    void collect(std::vector<double>& out, bool wait);
+
+private:
+    QueryRing ring;
+};
+
+#endif // FRAGMENTCOUNTER_H
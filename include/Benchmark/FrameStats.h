@@ -0,0 +1,60 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class FrameStats
+{
+public:
+    struct Summary
+    {
+        size_t count;
+        double mean;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+    };
+
+    FrameStats();
+
+    void reserve(size_t frames);
+
+    void addCpuSample(double ms);
+    void addGpuSample(double ms);
+
+    /*!
+        Named per-run value reported alongside the timings, e.g. draw calls
+    */
+    void setCounter(const std::string& name, double value);
+    // 0 for a counter never set
+    double getCounter(const std::string& name) const;
+
+    static Summary summarize(const std::vector<double>& samples);
+    static std::string escapeJson(const std::string& text);
+
+    /*!
+        Prints percentile summaries of the collected frame times to stdout
+    */
+    void print();
+
+    /*!
+        Writes summaries and raw per-frame samples (milliseconds) as JSON
+    */
+    bool writeJson(const std::string& path, const std::string& renderer, int warmupFrames);
+
+    /*!
+        Writes the "cpuMs" and "gpuMs" summaries as members of an already open JSON object
+    */
+    void writeSummaryFields(std::ostream& out);
+
+private:
+    std::vector<double> cpuSamples;
+    std::vector<double> gpuSamples;
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+#endif // FRAMESTATS_H
@@ -0,0 +1,31 @@
+#ifndef GPUFRAMETIMER_H
+#define GPUFRAMETIMER_H
+
+#include "Benchmark/QueryRing.h"
+
+#include <vector>
+
+/*!
+    Times whole frames on the GPU with a ring of GL_TIMESTAMP query pairs.
+    Timestamps rather than GL_TIME_ELAPSED so profiler GPU zones can run inside the frame.
+*/
+class GpuFrameTimer
+{
+public:
+    bool init();
+
+    void beginFrame();
+    void endFrame();
+
+    /*!
+        Appends the GPU time in ms of every finished frame, oldest first.
+        With wait set, blocks until all outstanding queries have resolved.
+    */
+    void collect(std::vector<double>& out, bool wait);
+
+private:
+    // Begin and end timestamp per slot
+    QueryRing ring;
+};
+
+#endif // GPUFRAMETIMER_H
@@ -0,0 +1,57 @@
+#ifndef QUERYRING_H
+#define QUERYRING_H
+
+#include <vector>
+
+/*!
+    Ring of GL query slots, one per frame, read back a few frames late so the CPU never waits on
+    the GPU. A slot holds queriesPerSlot queries, and read turns a finished slot's results into
+    one value per frame. The last query of a slot has to be the last to finish.
+*/
+class QueryRing
+{
+public:
+    static const int SLOT_COUNT = 4;
+
+    // Blocking read of a finished slot's queries
+    typedef double (*ReadFunction)(const unsigned int* queries);
+
+    QueryRing();
+    ~QueryRing();
+
+    /*!
+        Generates queriesPerSlot queries per slot, label names them in the error printed on failure
+    */
+    bool init(int queriesPerSlot, ReadFunction read, const char* label);
+
+    /*!
+        Queries of the slot for the frame starting, nullptr when not initialized or a frame is
+        already open
+    */
+    const unsigned int* beginFrame();
+    /*!
+        Queries of the slot for the frame ending, nullptr when no frame is open
+    */
+    const unsigned int* endFrame();
+
+    /*!
+        Appends the value of every finished frame, oldest first.
+        With wait set, blocks until all outstanding queries have resolved.
+    */
+    void collect(std::vector<double>& out, bool wait);
+
+private:
+    int queriesPerSlot;
+    ReadFunction read;
+    std::vector<unsigned int> queries;
+    int head;
+    int pending;
+    bool active;
+
+    std::vector<double> finished;
+
+    const unsigned int* getSlot(int slot) { return &this->queries[slot * this->queriesPerSlot]; }
+    void resolve(bool wait);
+};
+
+#endif // QUERYRING_H
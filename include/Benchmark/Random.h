@@ -0,0 +1,29 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+/*!
+    Linear congruential generator with the Numerical Recipes constants. Too weak for anything
+    statistical, but the same numbers on every run and platform, so generated scenes and
+    benchmark inputs are reproducible.
+*/
+class Random
+{
+public:
+    Random(unsigned int seed) { this->seed = seed; }
+
+    unsigned int nextInt()
+    {
+        this->seed = this->seed * 1664525u + 1013904223u;
+        return this->seed;
+    }
+
+    /*!
+        Value in [low, high), from the top 24 bits so every value is exact in a float
+    */
+    float next(float low, float high) { return low + (high - low) * (float)(nextInt() >> 8) / 16777216.f; }
+
+private:
+    unsigned int seed;
+};
+
+#endif // RANDOM_H
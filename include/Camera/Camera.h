@@ -19,6 +19,19 @@ public:
 
     glm::mat4 getProjection() { return this->projection; }
     glm::mat4 getView() { return this->view; }
+    float getNearClip() { return this->nearClip; }
+    float getFarClip() { return this->farClip; }
+
+    /*!
+        World space eye position, setLocation moves the world so this is not simply (x, y, z)
+    */
+    glm::vec3 getPosition();
+
+    /*!
+        Pixels a world unit facing the camera covers at distance 1 on the MainWindow::HEIGHT
+        tall viewport the projection is built for, divide by distance for anything farther
+    */
+    float getPixelScale();
 
 private:
     float x;
@@ -0,0 +1,167 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+    Fixed pool of worker threads running short jobs. Every thread owns a lock-free work stealing
+    deque: it pushes and pops its own jobs at the bottom, idle threads steal the oldest from the
+    top of the others. Completion is tracked with counters, and a thread waiting on one runs
+    queued jobs instead of blocking, so the render thread helps with its own parallel work.
+
+    Long running work such as asset decode goes to a separate background queue that only the
+    workers take from, a waiting render thread never picks it up mid-frame.
+
+    Jobs may be queued from the thread that started the system, from attached threads and from
+    inside jobs. Before start, and from threads the system doesn't know, jobs run inline on the
+    calling thread.
+*/
+class JobSystem
+{
+public:
+    // Outstanding jobs, zero once all of them have run
+    typedef std::atomic<int> Counter;
+    typedef std::function<void(size_t begin, size_t end)> RangeFunction;
+
+    // Jobs a thread can have queued at once, also the size of its job ring
+    static const size_t QUEUE_CAPACITY = 4096;
+    // Long lived threads besides the starting one that can queue jobs at once
+    static const int MAX_ATTACHED_THREADS = 2;
+
+    static JobSystem* instance;
+    static JobSystem* getInstance();
+
+    /*!
+        Starts workerCount workers, one less than the core count by default. The calling
+        thread becomes thread 0 and may queue jobs.
+    */
+    void start(int workerCount = -1);
+    /*!
+        Waits for queued work to finish and joins the workers
+    */
+    void stop();
+    bool isRunning() { return this->running; }
+
+    /*!
+        Gives the calling thread a queue of its own so it can queue and help with jobs like the
+        starting thread. Returns false if every slot is taken, its jobs then run inline.
+        Attached threads must detach, with nothing left queued, before the system stops.
+    */
+    bool attachThread();
+    void detachThread();
+
+    // Workers plus the thread that started the system, 1 while stopped
+    int getThreadCount() { return this->running ? (int)this->workers.size() + 1 : 1; }
+
+    /*!
+        Queues task, counter (if any) is incremented now and decremented once it ran.
+        With a dependency the task does not start before that counter reaches zero, until then
+        it is parked on the side rather than kept in a queue.
+    */
+    void run(std::function<void()> task, Counter* counter = nullptr, const Counter* dependency = nullptr);
+
+    /*!
+        Queues long running work only workers pick up, in submission order
+    */
+    void runBackground(std::function<void()> task, Counter* counter = nullptr);
+
+    /*!
+        Runs queued jobs until counter reaches zero
+    */
+    void wait(const Counter& counter);
+
+    /*!
+        Calls body over [0, count) split into ranges of about grain indices, run in parallel
+        and returning once all are done. grain 0 picks one that gives every thread a few ranges.
+    */
+    void parallelFor(size_t count, size_t grain, const RangeFunction& body);
+
+private:
+    JobSystem();
+
+    struct Job
+    {
+        std::function<void()> task;
+        // Range jobs call range over [begin, end) instead of task
+        const RangeFunction* range = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+        Counter* counter = nullptr;
+        const Counter* dependency = nullptr;
+        // Heap allocated (background jobs, or the ring slot was busy), deleted once it ran
+        bool heap = false;
+        // Ring slots stay taken from allocation until the job ran, cleared by the thread that ran it
+        std::atomic<bool> busy{ false };
+    };
+
+    /*!
+        Chase-Lev deque of a fixed capacity (Le et al., "Correct and Efficient Work-Stealing for
+        Weak Memory Models"), only the owning thread pushes and pops
+    */
+    class JobQueue
+    {
+    public:
+        JobQueue();
+        bool push(Job* job);
+        Job* pop();
+        Job* steal();
+
+    private:
+        // Thieves hammer top, the owner bottom, keep them on separate cache lines
+        alignas(64) std::atomic<int64_t> top;
+        alignas(64) std::atomic<int64_t> bottom;
+        std::atomic<Job*> buffer[QUEUE_CAPACITY];
+    };
+
+    struct ThreadData
+    {
+        JobQueue queue;
+        // Jobs are recycled in order, a slot still busy from the last lap is passed over for a heap job
+        std::unique_ptr<Job[]> ring;
+        size_t ringCursor = 0;
+        uint32_t stealSeed = 0;
+        // Taken by an attached thread, only used for the slots after the workers
+        std::atomic<bool> attached{ false };
+    };
+
+    std::vector<std::unique_ptr<ThreadData>> threads;
+    std::vector<std::thread> workers;
+    std::atomic<bool> running;
+
+    // Queued and not yet taken, workers sleep while it is zero
+    std::atomic<int> pendingJobs;
+    std::atomic<int> sleepingWorkers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    std::mutex backgroundMutex;
+    std::deque<std::unique_ptr<Job>> backgroundJobs;
+
+    // Jobs whose dependency wasn't done when they were taken, and those since released by it.
+    // The counts let finishing jobs and findJob skip the lock when both are empty.
+    std::mutex parkedMutex;
+    std::vector<Job*> parkedJobs;
+    std::deque<Job*> readyJobs;
+    std::atomic<int> parkedCount;
+    std::atomic<int> readyCount;
+
+    void workerLoop(int index);
+    Job* allocate(int index);
+    void push(int index, Job* job);
+    Job* findJob(int index, bool background);
+    void execute(int index, Job* job);
+    bool park(Job* job);
+    void finish(Counter* counter);
+    void wakeWorkers(int count);
+};
+
+#endif // JOBSYSTEM_H
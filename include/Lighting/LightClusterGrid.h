@@ -0,0 +1,92 @@
+#ifndef LIGHTCLUSTERGRID_H
+#define LIGHTCLUSTERGRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Camera;
+class PointLight;
+
+/*!
+    Owns the light data texture buffer and, for clustered forward lighting, splits the view
+    frustum into GRID_X * GRID_Y screen tiles by GRID_Z exponential depth slices. Each frame
+    every light is assigned to the clusters its radius touches and the per-cluster light lists
+    are uploaded as texture buffers, so fragments only shade the lights of their own cluster.
+*/
+class LightClusterGrid
+{
+public:
+    static const int GRID_X = 16;
+    static const int GRID_Y = 9;
+    static const int GRID_Z = 24;
+    static const int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+    LightClusterGrid();
+    ~LightClusterGrid();
+
+    bool init();
+
+    /*!
+        Deletes the buffers, call before the context is destroyed
+    */
+    void release();
+
+    /*!
+        With clustering off only the light data is uploaded and shaders loop over every light
+    */
+    void setClustered(bool clustered) { this->clustered = clustered; }
+    bool isClustered() { return this->clustered; }
+
+    /*!
+        Packs and uploads the lights, assigns them to clusters and binds the texture buffers
+    */
+    void update(Camera* cam, const std::vector<PointLight*>& lights, int viewportWidth, int viewportHeight);
+
+    int getLightCount() { return this->lightCount; }
+    size_t getIndexCount() { return this->indices.size(); }
+
+    // Shader side slice lookup: slice = log(viewDepth) * sliceScale + sliceBias
+    float getSliceScale() { return this->sliceScale; }
+    float getSliceBias() { return this->sliceBias; }
+    float getTileWidth() { return this->tileWidth; }
+    float getTileHeight() { return this->tileHeight; }
+
+private:
+    struct LightRange
+    {
+        int minX, maxX;
+        int minY, maxY;
+        int minZ, maxZ;
+    };
+
+    bool clustered;
+    int lightCount;
+
+    float sliceScale;
+    float sliceBias;
+    float tileWidth;
+    float tileHeight;
+
+    // Light data, cluster (offset, count) pairs and the flattened light index lists
+    unsigned int bufferHandles[3];
+    unsigned int textureHandles[3];
+    size_t bufferCapacity[3];
+
+    std::vector<float> lightData;
+    std::vector<LightRange> ranges;
+    std::vector<uint32_t> grid;
+    std::vector<uint32_t> indices;
+
+    // Per depth slice scratch, slices are assigned independently and merged afterwards
+    std::vector<uint32_t> sliceLights[GRID_Z];
+    std::vector<uint32_t> sliceIndices[GRID_Z];
+    std::vector<uint32_t> sliceCounts;
+
+    void computeRanges(Camera* cam, const std::vector<PointLight*>& lights);
+    void assignSlices(int firstSlice, int lastSlice);
+    void mergeSlices();
+    void upload(int buffer, const void* data, size_t bytes);
+};
+
+#endif // LIGHTCLUSTERGRID_H
@@ -0,0 +1,35 @@
+#ifndef LIGHTCONTROLLER_H
+#define LIGHTCONTROLLER_H
+
+#include <vector>
+
+class PointLight;
+
+class LightController
+{
+
+public:
+    static LightController* instance;
+    static LightController* getInstance();
+
+    /*!
+        Takes ownership of the light, it lights every object in the scene
+    */
+    void addLight(PointLight* light);
+    void removeLight(PointLight* light);
+
+    /*!
+        Deletes all lights
+    */
+    void clear();
+
+    const std::vector<PointLight*>& getLights() { return this->lights; }
+
+private:
+    LightController();
+
+    std::vector<PointLight*> lights;
+
+};
+
+#endif // LIGHTCONTROLLER_H
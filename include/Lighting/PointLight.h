@@ -7,6 +7,7 @@ class PointLight
 public:
     PointLight();
     PointLight(float x, float y, float z, float r, float g, float b);
+    PointLight(float x, float y, float z, float r, float g, float b, float radius);
 
     float getX() { return x; }
     float getY() { return y; }
@@ -16,6 +17,8 @@ public:
     float getGreen() { return g; }
     float getBlue() { return b; }
 
+    float getRadius() { return radius; }
+
     void setLocation(float x, float y, float z);
 
     /*!
@@ -23,6 +26,11 @@ public:
     */
     void setColor(float r, float g, float b);
 
+    /*!
+        Distance at which the light's contribution falls off to zero
+    */
+    void setRadius(float radius);
+
 private:
     float x;
     float y;
@@ -32,6 +40,8 @@ private:
     float g;
     float b;
 
+    float radius;
+
 };
 
 #endif // POINTLIGHT_H
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef COOKEDMESH_H
+#define COOKEDMESH_H
+
+#include "Textures/MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct MeshData;
+
+/*!
+    On-disk layout of a cooked .omesh file, little endian: the header, the
+    LOD table, then the vertex, tangent and index arrays in MeshData's layout
+    at 16 byte aligned offsets, ready to hand to glBufferData as they are.
+    indexCount covers every LOD, each one a range of the index array.
+*/
+struct CookedMeshHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t vertexOffset;
+    uint64_t tangentOffset;
+    uint64_t indexOffset;
+    float boundsMin[3];
+    float boundsMax[3];
+    // Entries in the LOD table right after the header, at least one
+    uint32_t lodCount;
+    uint32_t reserved;
+};
+
+struct CookedMeshLod
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // MeshLod::error, in mesh units
+    float error;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(CookedMeshHeader) == 80, "CookedMeshHeader layout is part of the file format");
+static_assert(sizeof(CookedMeshLod) == 16, "CookedMeshLod layout is part of the file format");
+
+/*!
+    A cooked mesh mapped into memory, the arrays point straight into the mapping
+*/
+class CookedMesh
+{
+public:
+    // Version 2 caches hold MeshOptimizer's index and vertex order, version 3 adds the LOD chain
+    static const uint32_t VERSION = 3;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() { return this->header != nullptr; }
+
+    const CookedMeshHeader& getHeader() { return *this->header; }
+    size_t getVertexCount() { return (size_t)this->header->vertexCount; }
+    // Indices of every LOD together
+    size_t getIndexCount() { return (size_t)this->header->indexCount; }
+    size_t getLodCount() { return this->header->lodCount; }
+    // Full detail first, each level about half the triangles of the one before
+    const CookedMeshLod* getLods() { return (const CookedMeshLod*)(this->file.getData() + sizeof(CookedMeshHeader)); }
+
+    // 5 floats per vertex: position, uv
+    const float* getVertices() { return (const float*)(this->file.getData() + this->header->vertexOffset); }
+    // 6 floats per vertex: tangent, bitangent
+    const float* getTangents() { return (const float*)(this->file.getData() + this->header->tangentOffset); }
+    const unsigned int* getIndices() { return (const unsigned int*)(this->file.getData() + this->header->indexOffset); }
+
+    static bool write(const std::string& path, const MeshData& mesh);
+
+private:
+    MappedFile file;
+    const CookedMeshHeader* header = nullptr;
+};
+
+#endif // COOKEDMESH_H
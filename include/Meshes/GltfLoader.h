@@ -0,0 +1,22 @@
+#ifndef GLTFLOADER_H
+#define GLTFLOADER_H
+
+#include <string>
+
+struct MeshData;
+
+/*!
+    Minimal glTF 2.0 importer for .gltf (external or base64 embedded buffers)
+    and .glb files, with a small built-in JSON parser. Every triangle
+    primitive reachable from the default scene is flattened into one mesh
+    with its node transforms applied; materials, skins, morph targets and
+    sparse accessors are ignored. Primitives are converted in parallel and
+    missing tangents are generated.
+*/
+class GltfLoader
+{
+public:
+    static bool load(const std::string& path, MeshData& mesh);
+};
+
+#endif // GLTFLOADER_H
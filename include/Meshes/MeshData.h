@@ -0,0 +1,51 @@
+#ifndef MESHDATA_H
+#define MESHDATA_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+/*!
+    One level of detail, a range of a mesh's indices over the shared vertices
+*/
+struct MeshLod
+{
+    size_t firstIndex = 0;
+    size_t indexCount = 0;
+    // Farthest the simplified surface may be from the full detail one, in mesh units
+    float error = 0.f;
+};
+
+/*!
+    Imported geometry in the layout Object uploads: interleaved position and
+    texture coordinates (5 floats per vertex), tangent and bitangent
+    (6 floats per vertex, normal = cross(tangent, bitangent)) and 32 bit
+    triangle indices.
+
+    With lods set, indices holds every level back to back, full detail first.
+    Without, all of it is the single full detail level.
+*/
+struct MeshData
+{
+    std::vector<float> vertices;
+    std::vector<float> tangents;
+    std::vector<unsigned int> indices;
+    std::vector<MeshLod> lods;
+
+    glm::vec3 boundsMin = glm::vec3(0.f);
+    glm::vec3 boundsMax = glm::vec3(0.f);
+
+    size_t getVertexCount() const { return this->vertices.size() / 5; }
+
+    void clear();
+    void computeBounds();
+
+    /*!
+        Fills tangents from the triangle UVs. normals (one per vertex) are
+        preserved when given, otherwise area weighted face normals are used.
+    */
+    void generateTangents(const std::vector<glm::vec3>* normals);
+};
+
+#endif // MESHDATA_H
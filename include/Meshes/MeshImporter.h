@@ -0,0 +1,28 @@
+#ifndef MESHIMPORTER_H
+#define MESHIMPORTER_H
+
+#include <string>
+
+struct MeshData;
+class CookedMesh;
+
+/*!
+    Front end over the mesh importers and the .omesh cache kept beside each source
+*/
+class MeshImporter
+{
+public:
+    /*!
+        Parses an .obj, .gltf or .glb file, picked by extension
+    */
+    static bool import(const std::string& path, MeshData& mesh);
+
+    static std::string getCookedPath(const std::string& source);
+
+    /*!
+        Maps the cooked mesh for source, importing, optimizing, generating LODs for and cooking it first when missing or older than the source
+    */
+    static bool load(const std::string& source, CookedMesh& mesh);
+};
+
+#endif // MESHIMPORTER_H
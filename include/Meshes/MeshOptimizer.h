@@ -0,0 +1,59 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <cstddef>
+#include <vector>
+
+struct MeshData;
+
+/*!
+    CPU passes reordering imported triangles and vertices for the GPU's post
+    transform vertex cache, overdraw and vertex fetch. Geometry is unchanged,
+    only the order of the index and vertex arrays.
+*/
+class MeshOptimizer
+{
+public:
+    // Cache the reordering targets, the Forsyth scores assume an LRU of this size
+    static const int CACHE_SIZE = 32;
+    // FIFO size used for reporting, close to what current GPUs keep
+    static const int ANALYSIS_CACHE_SIZE = 16;
+
+    struct CacheStats
+    {
+        // Vertex shader invocations per triangle, 0.5 is the best a regular grid can reach
+        float acmr = 0.f;
+        // Vertex shader invocations per vertex, 1.0 is optimal
+        float atvr = 0.f;
+    };
+
+    /*!
+        Simulates a FIFO post transform cache over the index buffer
+    */
+    static CacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize = ANALYSIS_CACHE_SIZE);
+
+    /*!
+        Forsyth's linear speed reordering: greedily emits the triangle whose vertices score highest for
+        their cache position and how few unemitted triangles still use them
+    */
+    static void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+    /*!
+        Splits cache optimized triangles into clusters where the cache order allows it and sorts the
+        clusters outward facing first, so near surfaces tend to fill depth before the ones behind them.
+        threshold is how much worse than the cache optimal order the clusters may make the ACMR.
+    */
+    static void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& vertices, float threshold = 1.05f);
+
+    /*!
+        Renumbers vertices in order of first use and drops unreferenced ones, so fetches walk the vertex buffer linearly
+    */
+    static void optimizeVertexFetch(MeshData& mesh);
+
+    /*!
+        Runs all three passes in order and prints ACMR/ATVR before and after
+    */
+    static void optimize(MeshData& mesh);
+};
+
+#endif // MESHOPTIMIZER_H
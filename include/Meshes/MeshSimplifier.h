@@ -0,0 +1,41 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <cstddef>
+#include <vector>
+
+struct MeshData;
+
+/*!
+    Quadric error edge collapse (Garland and Heckbert) over an indexed mesh. Each collapse moves
+    one vertex onto a neighbour, so simplified levels only index the existing vertices and share
+    the vertex buffer with the full mesh.
+
+    Vertices at the same position are welded for the error metric. Positions on a UV seam,
+    an open border or a non-manifold edge are never removed, only collapsed onto, which keeps
+    attributes and silhouettes intact at the cost of reduction on heavily seamed meshes.
+*/
+class MeshSimplifier
+{
+public:
+    // Levels in a chain, full detail included
+    static const int MAX_LODS = 5;
+    // No level is generated below this many triangles
+    static const size_t MIN_LOD_TRIANGLES = 32;
+
+    /*!
+        Collapses edges of indices (5 floats per vertex in vertices) until at most targetIndexCount
+        indices remain or the cheapest collapse would exceed maxError, in mesh units.
+        Returns the largest error of any collapse made.
+    */
+    static float simplify(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, size_t targetIndexCount, float maxError, std::vector<unsigned int>& result);
+
+    /*!
+        Appends a chain of levels with about half the triangles of the one before to mesh's
+        indices and fills mesh.lods, stopping when a level no longer shrinks much.
+        Run after MeshOptimizer, every level is cache optimized on its own.
+    */
+    static void generateLods(MeshData& mesh);
+};
+
+#endif // MESHSIMPLIFIER_H
@@ -0,0 +1,21 @@
+#ifndef OBJLOADER_H
+#define OBJLOADER_H
+
+#include <string>
+
+struct MeshData;
+
+/*!
+    Wavefront OBJ importer. The file is memory mapped and split at line
+    boundaries into one chunk per hardware thread; chunks parse vertices and
+    faces independently and are stitched together afterwards. Polygons are
+    triangulated as fans, identical position/uv/normal corners share a
+    vertex and tangents are always generated.
+*/
+class ObjLoader
+{
+public:
+    static bool load(const std::string& path, MeshData& mesh);
+};
+
+#endif // OBJLOADER_H
@@ -0,0 +1,145 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/*!
+    Frame profiler with scoped CPU zones and GL_TIME_ELAPSED GPU zones.
+    Only compiled when OPTIM_PROFILING is defined (debug builds), otherwise
+    the PROFILE_* macros expand to nothing.
+*/
+#ifdef OPTIM_PROFILING
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Profiler
+{
+public:
+    // Frames whose GPU queries may be in flight at once, and zones per frame
+    static const int GPU_FRAME_LATENCY = 4;
+    static const int MAX_GPU_ZONES_PER_FRAME = 256;
+
+    static Profiler* instance;
+    static Profiler* getInstance();
+
+    /*!
+        Records the next frameCount frames and writes them to path as a
+        chrome://tracing / Perfetto JSON trace once all GPU results are in
+    */
+    void startCapture(int frameCount, const std::string& path);
+    bool isCapturing() { return this->captureFramesLeft > 0 || this->gpuFramesPending > 0; }
+
+    /*!
+        Ends a running capture early and writes it, waiting for outstanding GPU results
+    */
+    void finishCapture();
+
+    void beginFrame();
+    void endFrame();
+
+    /*!
+        Names the calling thread in captures, CPU zones default to the render thread
+    */
+    void registerThread(const char* name);
+
+    int beginCpuZone(const char* name);
+    void endCpuZone(int zone);
+
+    int beginGpuZone(const char* name);
+    void endGpuZone(int zone);
+
+private:
+    struct Event
+    {
+        const char* name;
+        uint64_t startNs;
+        uint64_t durationNs;
+        uint32_t frame;
+        int thread;
+    };
+
+    struct GpuFrame
+    {
+        uint32_t frame;
+        int zoneCount;
+        bool inFlight;
+        const char* names[MAX_GPU_ZONES_PER_FRAME];
+        uint64_t issueNs[MAX_GPU_ZONES_PER_FRAME];
+    };
+
+    Profiler();
+
+    uint64_t now();
+    bool initQueries();
+    void resolveGpuFrames(bool wait);
+    void completeCapture();
+    bool writeTrace();
+
+    uint64_t epochNs;
+    uint32_t frameIndex;
+
+    int captureFramesLeft;
+    int gpuFramesPending;
+    std::string capturePath;
+
+    // CPU zones may be recorded from several threads, guards cpuEvents and the frame state they read
+    std::mutex cpuMutex;
+    std::vector<Event> cpuEvents;
+    std::vector<std::pair<int, const char*>> threadNames;
+    std::vector<Event> gpuEvents;
+
+    unsigned int queries[GPU_FRAME_LATENCY * MAX_GPU_ZONES_PER_FRAME];
+    GpuFrame gpuFrames[GPU_FRAME_LATENCY];
+    int gpuFrameSlot;
+    int activeGpuZone;
+    bool recordingFrame;
+    size_t droppedGpuFrames;
+};
+
+class ProfileCpuZone
+{
+public:
+    ProfileCpuZone(const char* name) { this->zone = Profiler::getInstance()->beginCpuZone(name); }
+    ~ProfileCpuZone() { Profiler::getInstance()->endCpuZone(this->zone); }
+
+private:
+    int zone;
+};
+
+class ProfileGpuZone
+{
+public:
+    ProfileGpuZone(const char* name) { this->zone = Profiler::getInstance()->beginGpuZone(name); }
+    ~ProfileGpuZone() { Profiler::getInstance()->endGpuZone(this->zone); }
+
+private:
+    int zone;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_ZONE(name) ProfileCpuZone PROFILE_CONCAT(profileCpuZone, __LINE__)(name)
+// GL_TIME_ELAPSED queries cannot nest, a GPU zone opened inside another one is ignored
+#define PROFILE_GPU_ZONE(name) ProfileGpuZone PROFILE_CONCAT(profileGpuZone, __LINE__)(name)
+#define PROFILE_FRAME_BEGIN() Profiler::getInstance()->beginFrame()
+#define PROFILE_FRAME_END() Profiler::getInstance()->endFrame()
+#define PROFILE_THREAD(name) Profiler::getInstance()->registerThread(name)
+#define PROFILE_CAPTURE(frames, path) Profiler::getInstance()->startCapture(frames, path)
+#define PROFILE_FINISH_CAPTURE() Profiler::getInstance()->finishCapture()
+
+#else
+
+#define PROFILE_ZONE(name)
+#define PROFILE_GPU_ZONE(name)
+#define PROFILE_FRAME_BEGIN()
+#define PROFILE_FRAME_END()
+#define PROFILE_THREAD(name)
+#define PROFILE_CAPTURE(frames, path)
+#define PROFILE_FINISH_CAPTURE()
+
+#endif // OPTIM_PROFILING
+
+#endif // PROFILER_H
@@ -0,0 +1,99 @@
+#ifndef INSTANCEDMESH_H
+#define INSTANCEDMESH_H
+
+#include "Rendering/FrustumCuller.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Object;
+class ShaderProgram;
+class RenderQueue;
+class StreamingBuffer;
+class VertexLayout;
+
+/*!
+    Draws many copies of one Object's geometry and material with a single
+    glDrawElementsInstanced. Per-instance model matrices live in a dynamic
+    vertex buffer (attribute locations 4-7, divisor 1) and only the range of
+    instances changed since the last copy is re-uploaded.
+
+    Transforms are owned by the simulation side. copyChangedInstances hands the
+    changed range over, and uploadInstances writes it on the GL thread, so the
+    two may run on different threads as long as the copies arrive in order.
+*/
+class InstancedMesh
+{
+public:
+    /*!
+        prototype supplies geometry and textures, it must be built and outlive the mesh
+    */
+    InstancedMesh(Object* prototype);
+    ~InstancedMesh();
+
+    /*!
+        Attaches the shared instanced lit program variant for the prototype's material and
+        a ShaderVariants lighting key, and its depth-only variant
+    */
+    bool compileShader(uint32_t lighting = 0);
+
+    /*!
+        Program defines compileShader uses for a variant key and a prototype in layout, for preloading it
+    */
+    static std::string getShaderDefines(uint32_t variant, const VertexLayout& layout);
+    bool build();
+
+    void reserve(size_t count);
+    size_t addInstance(const glm::mat4& transform);
+    void setTransform(size_t instance, const glm::mat4& transform);
+    const glm::mat4& getTransform(size_t instance) { return this->transforms[instance]; }
+    size_t getInstanceCount() { return this->transforms.size(); }
+
+    /*!
+        Sphere around every instance the mesh has held, the batch is culled as a whole
+    */
+    void getWorldSphere(glm::vec3& center, float& radius);
+
+    /*!
+        Appends the instances changed since the last call to out, ready for upload, and
+        returns how many. first is the index of the first one.
+    */
+    size_t copyChangedInstances(std::vector<glm::mat4>& out, size_t& first);
+
+    /*!
+        Writes count instance matrices from copyChangedInstances starting at first, staged
+        through stream and copied on the GPU. GL thread only.
+    */
+    void uploadInstances(size_t first, const glm::mat4* matrices, size_t count, StreamingBuffer& stream);
+
+    /*!
+        Queues one instanced draw, changed instances must be uploaded before it executes
+    */
+    void submit(RenderQueue& queue);
+
+private:
+    Object* prototype;
+    ShaderProgram* shader;
+    ShaderProgram* depthShader;
+
+    unsigned int attributeHandle;
+    // Positions and instance matrices only, for the depth pre-pass
+    unsigned int depthAttributeHandle;
+    unsigned int instanceHandle;
+    size_t instanceCapacity;
+
+    std::vector<glm::mat4> transforms;
+    size_t dirtyBegin;
+    size_t dirtyEnd;
+    // Instances the GL side has been handed, more means the next copy must cover all of them
+    size_t copiedCount;
+    // Instance origins, only ever grows so moving instances needs no rescan
+    Bounds originBounds;
+    int materialKey;
+};
+
+#endif // INSTANCEDMESH_H
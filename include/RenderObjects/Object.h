@@ -1,10 +1,21 @@
 #ifndef OBJECT_H
 #define OBJECT_H
 
+#include "Rendering/VertexLayout.h"
+#include "Rendering/FrustumCuller.h"
+#include "shaders/ShaderVariants.h"
+#include "Meshes/MeshData.h"
+
+#include <glm/glm.hpp>
+
 #include <cstddef>
+#include <cstdint>
+#include <string>
 #include <vector>
 
-class PointLight;
+class ShaderProgram;
+class RenderQueue;
+struct OccluderMesh;
 
 class Object
 {
@@ -17,14 +28,97 @@ public:
     // TODO: Implement
     void setVertexData(float* vcData, unsigned int* elementData, size_t vcSize, size_t eSize);
 
-    void addAffectingLight(PointLight* light);
+    void setLocation(float x, float y, float z);
+    uint32_t getTransform() { return this->transform; }
+
+    /*!
+        Queues this object's draw, nothing is drawn until the queue executes
+    */
+    void submit(RenderQueue& queue);
+
+    /*!
+        Adds a texture through the TextureManager, objects loading the same file share one GL texture.
+        The texture streams in asynchronously, a placeholder is drawn until it is resident.
+        Load the albedo first, a normal map turns on the NORMAL_MAP feature.
+    */
+    bool loadTexture(const char* path, bool normalMap = false);
 
-    void render();
+    // Material switches picking the shader variant, Blinn-Phong specular is on by default
+    void setSpecular(bool specular);
+    void setAlphaTest(bool alphaTest);
+    // ShaderVariants feature bits of the material
+    uint32_t getMaterialFeatures() { return this->materialFeatures; }
 
-    bool loadTexture(const char* path);
-    bool compileShader();
+    /*!
+        Attaches the shared lit program variant for the material and a ShaderVariants lighting
+        key, and its depth-only variant, compiling them on first use. Set the vertex layout,
+        textures and material switches first.
+    */
+    bool compileShader(uint32_t lighting = ShaderVariants::DYNAMIC_LIGHTING);
+    // Variant key of the attached program
+    uint32_t getShaderVariant() { return this->shaderVariant; }
+
+    /*!
+        Program defines compileShader uses for a variant key and layout, for preloading it
+    */
+    static std::string getShaderDefines(uint32_t variant, const VertexLayout& layout);
+
+    /*!
+        Encoding used by the next buildGeometry, the compact layout by default
+    */
+    void setVertexLayout(const VertexLayout& layout) { this->layout = layout; }
+    const VertexLayout& getVertexLayout() { return this->layout; }
+
+    /*!
+        Uploads the object's geometry into the GeometryPool
+    */
     bool buildGeometry();
 
+    /*!
+        Uploads geometry the object doesn't keep, e.g. straight from a mapped mesh file.
+        Sizes are in floats for vertices (5 per vertex) and tangents (6 per vertex).
+        lods are ranges of elements, full detail first, without them all elements are one level.
+    */
+    bool buildGeometry(const float* vertices, size_t vertexSize, const float* tangents, size_t tangentSize, const unsigned int* elements, size_t elementCount,
+                       const MeshLod* lods = nullptr, size_t lodCount = 0);
+
+    /*!
+        Picks the coarsest level whose error projects to at most maxErrorPixels from eye.
+        pixelScale comes from Camera::getPixelScale, 0 pixels always draws full detail.
+        A coarser level is only taken once it is well inside the limit, so objects near
+        the switching distance don't alternate between two levels every frame.
+    */
+    void selectLod(const glm::vec3& eye, float pixelScale, float maxErrorPixels);
+    size_t getLod() { return this->lod; }
+    size_t getLodCount() { return this->lods.size(); }
+
+    // Pool allocation holding the geometry, GeometryPool::INVALID until built
+    uint32_t getGeometry() { return this->geometry; }
+    // Indices of the full detail level, which starts at the allocation's index offset
+    size_t getElementCount() { return this->lods.empty() ? 0 : this->lods[0].indexCount; }
+    // GL_UNSIGNED_SHORT when every vertex fits in 16 bit indices, otherwise GL_UNSIGNED_INT
+    unsigned int getIndexType() { return this->indexType; }
+    // Maps stored (possibly quantized) positions to mesh space, part of every model matrix
+    const glm::mat4& getPositionTransform() { return this->positionTransform; }
+    const std::vector<unsigned int>& getTextures() { return this->textureHandles; }
+
+    // Mesh space box of the vertex data, set by buildGeometry
+    const Bounds& getLocalBounds() { return this->localBounds; }
+    // Farthest vertex from the mesh origin, bounds the mesh under any rotation
+    float getBoundingRadius() { return this->boundingRadius; }
+
+    /*!
+        World space sphere around the object as of the last TransformStore update
+    */
+    void getWorldSphere(glm::vec3& center, float& radius);
+
+    /*!
+        Rasterizes mesh into the OcclusionCuller's depth buffer for this object, nullptr for none.
+        Shared between objects, it must outlive them.
+    */
+    void setOccluder(const OccluderMesh* mesh) { this->occluder = mesh; }
+    const OccluderMesh* getOccluder() { return this->occluder; }
+
 private:
     float* vData;
     unsigned int* elementBufferData;
@@ -33,18 +127,27 @@ private:
     size_t elementSize;
     size_t tangentSize;
 
-    unsigned int attributeHandle;
-    unsigned int vDataHandle;
-    unsigned int elementHandle;
-    unsigned int tangentHandle;
+    uint32_t geometry;
+    unsigned int indexType;
+    std::vector<MeshLod> lods;
+    size_t lod;
 
-    unsigned int shaderProgramHandle;
-    std::vector<unsigned int> textureHandles;
+    VertexLayout layout;
+    glm::mat4 positionTransform;
+    Bounds localBounds;
+    float boundingRadius;
+    const OccluderMesh* occluder;
 
-    std::vector<PointLight*> affectingLights;
+    // Node in the TransformStore, the object's world matrix comes from there
+    uint32_t transform;
 
-    void bindTexturesForRender();
-    void setLightingInShader();
+    ShaderProgram* shader;
+    // Depth pre-pass program, nullptr skips the object in that pass
+    ShaderProgram* depthShader;
+    uint32_t shaderVariant;
+    uint32_t materialFeatures;
+    std::vector<unsigned int> textureHandles;
+    int materialKey;
 };
 
 #endif // OBJECT_H
\ No newline at end of file
@@ -0,0 +1,122 @@
+#ifndef COMMANDLIST_H
+#define COMMANDLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class ShaderProgram;
+
+enum CommandType : uint16_t
+{
+    BIND_PROGRAM_COMMAND,
+    BIND_UNIFORM_BLOCK_COMMAND,
+    BIND_TEXTURE_COMMAND,
+    BIND_VERTEX_ARRAY_COMMAND,
+    SET_MODEL_COMMAND,
+    SET_PASS_STATE_COMMAND,
+    DRAW_COMMAND
+};
+
+// Every command starts with its header, size includes the header and padding to the next command
+struct CommandHeader
+{
+    CommandType type;
+    uint16_t size;
+};
+
+struct BindProgramCommand
+{
+    CommandHeader header;
+    ShaderProgram* program;
+};
+
+struct BindUniformBlockCommand
+{
+    CommandHeader header;
+    uint32_t binding;
+    uint32_t buffer;
+};
+
+struct BindTextureCommand
+{
+    CommandHeader header;
+    uint32_t unit;
+    uint32_t texture;
+};
+
+struct BindVertexArrayCommand
+{
+    CommandHeader header;
+    uint32_t vertexArray;
+};
+
+struct SetModelCommand
+{
+    CommandHeader header;
+    int32_t location;
+    float model[16];
+};
+
+// Depth and colour state of a render pass, starts every pass
+struct SetPassStateCommand
+{
+    CommandHeader header;
+    // RenderPass the state belongs to, PASS_COUNT when restoring the default after the last one
+    uint32_t pass;
+    uint32_t depthFunc;
+    uint8_t depthWrite;
+    uint8_t colorWrite;
+    // glBlendFunc(GL_ONE, GL_ONE) when set, blending off otherwise
+    uint8_t additiveBlend;
+};
+
+struct DrawCommand
+{
+    CommandHeader header;
+    uint32_t elementCount;
+    // As in DrawPacket
+    uint32_t indexType;
+    int32_t baseVertex;
+    uint32_t indexOffset;
+    // Zero for a plain draw
+    uint32_t instanceCount;
+};
+
+/*!
+    Flat list of plain data commands, recorded on any thread and replayed later by the
+    backend on its own thread. Commands are placed back to back in one linearly allocated
+    block that is kept across resets, so recording a frame allocates nothing once warm.
+*/
+class CommandList
+{
+public:
+    CommandList();
+
+    /*!
+        Drops the recorded commands, keeping the memory
+    */
+    void reset() { this->used = 0; }
+
+    void bindProgram(ShaderProgram* program);
+    void bindUniformBlock(uint32_t binding, uint32_t buffer);
+    void bindTexture(uint32_t unit, uint32_t texture);
+    void bindVertexArray(uint32_t vertexArray);
+    void setModel(int32_t location, const float* model);
+    void setPassState(uint32_t pass, uint32_t depthFunc, bool depthWrite, bool colorWrite, bool additiveBlend);
+    void draw(uint32_t elementCount, uint32_t indexType, int32_t baseVertex, uint32_t indexOffset, uint32_t instanceCount);
+
+    // Walk the commands from getBegin, each header's size leads to the next
+    const uint8_t* getBegin() const { return this->memory.get(); }
+    const uint8_t* getEnd() const { return this->memory.get() + this->used; }
+    size_t getSize() const { return this->used; }
+
+private:
+    std::unique_ptr<uint8_t[]> memory;
+    size_t capacity;
+    size_t used;
+
+    template <typename T> T* allocate(CommandType type);
+};
+
+#endif // COMMANDLIST_H
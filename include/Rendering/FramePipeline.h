@@ -0,0 +1,122 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include "Camera/Camera.h"
+#include "Lighting/PointLight.h"
+#include "Rendering/RenderQueue.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class InstancedMesh;
+
+/*!
+    Everything the GL thread needs to draw one simulated frame. Filled by the simulation and
+    not touched by it again until the frame has been drawn, so the scene can move on meanwhile.
+*/
+struct FrameSnapshot
+{
+    // Instances copied out of a mesh for upload, matrices live in instanceMatrices
+    struct InstanceUpload
+    {
+        InstancedMesh* mesh;
+        size_t first;
+        size_t count;
+        size_t offset;
+    };
+
+    FrameSnapshot() : camera(nullptr) {}
+
+    // Index of the frame since the pipeline started
+    uint64_t frame = 0;
+    // Scene time in seconds
+    double time = 0.0;
+    // Input state the simulation consumed, frames report their latency from it
+    std::chrono::steady_clock::time_point inputTime;
+
+    Camera camera;
+    std::vector<PointLight> lights;
+    // Into lights, the form the light grid takes
+    std::vector<PointLight*> lightPointers;
+
+    std::vector<InstanceUpload> instanceUploads;
+    std::vector<glm::mat4> instanceMatrices;
+
+    // Sorted visible draws recorded into command lists, the GL thread only replays them
+    RenderQueue queue;
+    size_t visibleObjects = 0;
+    // Of visibleObjects, hidden behind occluders and not queued
+    size_t occludedObjects = 0;
+    double occlusionMs = 0.0;
+    // Sum of the screen fractions queued objects cover, and whether it turned the depth pre-pass on
+    float depthComplexity = 0.f;
+    bool depthPrepass = false;
+};
+
+/*!
+    Hands frames from the simulation to the GL thread. With a depth above 0 the simulation runs
+    on its own thread up to depth frames ahead of the frame being drawn, cycling through
+    depth + 1 snapshots: at depth 2 one is drawn while the next two are simulated or waiting.
+    Depth 0 simulates each frame on the GL thread right before it is drawn.
+*/
+class FramePipeline
+{
+public:
+    static const int MAX_DEPTH = 2;
+
+    /*!
+        Fills frame for frame.frame, returns false once there are no more frames
+    */
+    typedef std::function<bool(FrameSnapshot& frame)> SimulateFunction;
+
+    FramePipeline();
+    ~FramePipeline();
+
+    void start(int depth, SimulateFunction simulate);
+    /*!
+        Stops the simulation thread, frames not yet drawn are dropped
+    */
+    void stop();
+
+    /*!
+        Next frame in simulation order, waiting for it if needed. nullptr once the simulation ended
+    */
+    FrameSnapshot* acquire();
+    /*!
+        Returns a drawn frame to the simulation
+    */
+    void release(FrameSnapshot* frame);
+
+    int getDepth() { return this->depth; }
+
+private:
+    int depth;
+    SimulateFunction simulate;
+    uint64_t nextFrame;
+
+    // Kept across runs so their vectors keep their capacity
+    std::vector<std::unique_ptr<FrameSnapshot>> snapshots;
+
+    std::mutex mutex;
+    std::condition_variable frameReady;
+    std::condition_variable frameFree;
+    std::deque<FrameSnapshot*> freeFrames;
+    std::deque<FrameSnapshot*> readyFrames;
+    bool finished;
+    bool stopping;
+    std::thread simulationThread;
+
+    void simulationLoop();
+};
+
+#endif // FRAMEPIPELINE_H
@@ -0,0 +1,37 @@
+#ifndef FRAMEUNIFORMBUFFER_H
+#define FRAMEUNIFORMBUFFER_H
+
+#include <cstddef>
+
+class Camera;
+class LightClusterGrid;
+class StreamingBuffer;
+
+/*!
+    std140 uniform block holding camera, time and light cluster parameters for the whole frame.
+    Written once per frame into the streaming buffer and bound at BINDING_POINT, which every
+    ShaderProgram links its FrameData block to.
+*/
+class FrameUniformBuffer
+{
+public:
+    static const unsigned int BINDING_POINT = 0;
+
+    FrameUniformBuffer();
+
+    /*!
+        stream must outlive the block
+    */
+    bool init(StreamingBuffer* stream);
+
+    /*!
+        Writes and binds this frame's data, call after the light grid has been updated for the frame
+    */
+    void update(Camera* cam, LightClusterGrid* lightGrid, float time, float deltaTime);
+
+private:
+    StreamingBuffer* stream;
+    size_t alignment;
+};
+
+#endif // FRAMEUNIFORMBUFFER_H
@@ -0,0 +1,74 @@
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*!
+    Axis aligned box, empty until the first point is added
+*/
+struct Bounds
+{
+    glm::vec3 min = glm::vec3(1e30f);
+    glm::vec3 max = glm::vec3(-1e30f);
+
+    bool isEmpty() const { return this->min.x > this->max.x; }
+    void add(const glm::vec3& point);
+    void add(const Bounds& other);
+
+    glm::vec3 getCenter() const { return (this->min + this->max) * 0.5f; }
+    float getRadius() const { return glm::length(this->max - this->min) * 0.5f; }
+};
+
+/*!
+    Tests bounding spheres against the six planes of a view frustum. The spheres are kept as
+    separate x, y, z and radius arrays so the kernel tests 4 (SSE) or 8 (AVX) per iteration.
+*/
+class FrustumCuller
+{
+public:
+    /*!
+        Extracts the planes (Gribb/Hartmann), normalized so plane distances are in world units
+    */
+    void setFrustum(const glm::mat4& viewProjection);
+    const glm::vec4& getPlane(int i) { return this->planes[i]; }
+
+    void clear();
+    void resize(size_t count);
+    size_t add(const glm::vec3& center, float radius);
+    void set(size_t i, const glm::vec3& center, float radius);
+    size_t getCount() { return this->count; }
+
+    /*!
+        Tests every sphere, returns the number visible, see isVisible for the results.
+        Large sets are split into jobs.
+    */
+    size_t cull();
+    /*!
+        Plain C++ version of cull, the reference the SIMD kernel has to match exactly
+    */
+    size_t cullScalar();
+
+    bool isVisible(size_t i) { return this->visibility[i] != 0; }
+    const std::vector<uint8_t>& getVisibility() { return this->visibility; }
+
+private:
+    glm::vec4 planes[6];
+
+    // Padded to a multiple of 8 with spheres behind every plane, so the kernel has no tail
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+    std::vector<uint8_t> visibility;
+    size_t count = 0;
+
+    void cullRange(size_t begin, size_t end);
+    void cullScalarRange(size_t begin, size_t end);
+    size_t countVisible(size_t begin, size_t end);
+};
+
+#endif // FRUSTUMCULLER_H
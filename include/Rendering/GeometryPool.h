@@ -0,0 +1,124 @@
+#ifndef GEOMETRYPOOL_H
+#define GEOMETRYPOOL_H
+
+#include "Rendering/VertexLayout.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*!
+    Holds the geometry of every Object in a few large vertex and element buffers, one vertex
+    array per vertex layout, so draws of different meshes only differ in their base vertex
+    and index offset. Both buffers are carved up with a first fit free list that merges
+    neighbouring ranges on free. Buffer handles never change, only the ranges inside move.
+
+    An allocation that finds enough free space in a buffer but no range large enough compacts
+    that buffer first, so allocate, free and defragment must not run while a frame using the
+    old offsets is being queued. GL thread only.
+*/
+class GeometryPool
+{
+public:
+    static const uint32_t INVALID = 0xFFFFFFFFu;
+
+    struct Stats
+    {
+        size_t buffers;
+        size_t allocations;
+        size_t vertexBytes;
+        size_t vertexCapacity;
+        size_t indexBytes;
+        size_t indexCapacity;
+        size_t freeRanges;
+        // 0 while every free list is a single range, towards 1 as free space splits into small ranges
+        float fragmentation;
+    };
+
+    static GeometryPool* instance;
+    static GeometryPool* getInstance();
+
+    /*!
+        Copies vertexCount vertices already encoded in layout and indexBytes of 16 or 32 bit
+        indices into a buffer for that layout. Returns INVALID on a GL error.
+    */
+    uint32_t allocate(const VertexLayout& layout, const void* vertices, size_t vertexCount, const void* indices, size_t indexBytes);
+    void free(uint32_t geometry);
+
+    unsigned int getVertexArray(uint32_t geometry) { return this->buffers[this->allocations[geometry].buffer]->vertexArray; }
+    // Same buffers with only positions enabled, for the depth pre-pass
+    unsigned int getDepthVertexArray(uint32_t geometry) { return this->buffers[this->allocations[geometry].buffer]->depthVertexArray; }
+    unsigned int getVertexBuffer(uint32_t geometry) { return this->buffers[this->allocations[geometry].buffer]->vertexBuffer; }
+    unsigned int getElementBuffer(uint32_t geometry) { return this->buffers[this->allocations[geometry].buffer]->elementBuffer; }
+    // Added to every index of a draw
+    int getBaseVertex(uint32_t geometry) { return (int)this->allocations[geometry].firstVertex; }
+    // Byte offset of the first index in the element buffer
+    size_t getIndexOffset(uint32_t geometry) { return this->allocations[geometry].indexOffset; }
+
+    /*!
+        Moves every allocation to the front of its buffers, leaving one free range at the end
+    */
+    void defragment();
+
+    Stats getStats();
+
+    /*!
+        Deletes every buffer, outstanding allocations must not be used afterwards
+    */
+    void clear();
+
+private:
+    struct Range
+    {
+        size_t offset;
+        size_t size;
+    };
+
+    // Free ranges sorted by offset, never two adjacent ones
+    struct FreeList
+    {
+        std::vector<Range> ranges;
+        size_t capacity;
+
+        void reset(size_t capacity, size_t used);
+        bool allocate(size_t size, size_t alignment, size_t& offset);
+        void release(size_t offset, size_t size);
+        size_t getFree();
+        size_t getLargest();
+    };
+
+    struct Buffer
+    {
+        VertexLayout layout;
+        unsigned int vertexArray;
+        unsigned int depthVertexArray;
+        unsigned int vertexBuffer;
+        unsigned int elementBuffer;
+        // In vertices
+        FreeList vertices;
+        // In bytes
+        FreeList indices;
+    };
+
+    struct Allocation
+    {
+        uint32_t buffer;
+        size_t firstVertex;
+        size_t vertexCount;
+        size_t indexOffset;
+        size_t indexBytes;
+        bool live;
+    };
+
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    std::vector<Allocation> allocations;
+    std::vector<uint32_t> freeAllocations;
+
+    GeometryPool() {}
+
+    Buffer* createBuffer(const VertexLayout& layout, size_t vertexCapacity, size_t indexCapacity);
+    void defragment(uint32_t buffer);
+};
+
+#endif // GEOMETRYPOOL_H
@@ -0,0 +1,143 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include "Rendering/FrustumCuller.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*!
+    Triangles an occluder is rasterized from, in mesh space. Closed and wound like the drawn
+    mesh (counter-clockwise front faces), back faces are skipped.
+*/
+struct OccluderMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+
+    /*!
+        Takes the positions of vertices (5 floats per vertex, as in MeshData) and their indices
+    */
+    void set(const float* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+    /*!
+        The twelve triangles of a box
+    */
+    void setBox(const Bounds& bounds);
+    void clear();
+    bool isEmpty() const { return this->indices.empty(); }
+};
+
+/*!
+    Software occlusion culling on the CPU. A few occluders are rasterized into a small depth
+    buffer split into tiles, one job per tile, with a kernel filling 4 (SSE) or 8 (AVX) pixels
+    per iteration. Each tile then keeps the farthest depth of every 8x8 block and of the whole
+    tile, and a box is occluded when its nearest depth lies behind that maximum everywhere its
+    screen rectangle reaches.
+
+    Depths are only taken at pixel centers and boxes are tested against the centers around them,
+    so gaps between occluders narrower than a pixel of the depth buffer (about 3 pixels of an
+    800x600 window) count as closed.
+*/
+class OcclusionCuller
+{
+public:
+    // Depth buffer size, the window's aspect at about a third of its resolution, whole tiles
+    static const int WIDTH = 256;
+    static const int HEIGHT = 192;
+    // Tiles rasterized by one job, a multiple of BLOCK_SIZE and of the kernel width
+    static const int TILE_SIZE = 32;
+    static const int BLOCK_SIZE = 8;
+
+    OcclusionCuller();
+
+    /*!
+        Starts a frame, dropping the previous frame's occluders
+    */
+    void begin(const glm::mat4& viewProjection);
+    /*!
+        Transforms mesh by viewProjection * model, clips it to the near plane and sets up its
+        front facing triangles. Returns the number set up.
+    */
+    size_t addOccluder(const OccluderMesh& mesh, const glm::mat4& model);
+    size_t getTriangleCount() { return this->triangles.size(); }
+
+    /*!
+        Clears the depth buffer, rasterizes every triangle added and builds the block and tile
+        maxima. parallel splits it into one job per tile.
+    */
+    void rasterize(bool parallel = true);
+    /*!
+        Plain C++ version of rasterize, the reference the SIMD kernel has to match exactly
+    */
+    void rasterizeScalar();
+
+    /*!
+        Whether any of a mesh space box under model may be in front of the occluders. Boxes
+        reaching through the near plane or entirely off the screen count as visible. The screen
+        rectangle of the rest is clamped to the depth buffer, so a box partly off the screen is
+        occluded when its part on the screen is.
+    */
+    bool isVisible(const Bounds& bounds, const glm::mat4& model) const;
+
+    void resize(size_t count);
+    void set(size_t i, const Bounds& bounds, const glm::mat4& model);
+    size_t getCount() { return this->boxes.size(); }
+    /*!
+        Tests every box candidates marks (every box without candidates), returns the number
+        occluded, see isOccluded for the results. Large sets are split into jobs.
+    */
+    size_t cull(const uint8_t* candidates = nullptr);
+    bool isOccluded(size_t i) { return this->occluded[i] != 0; }
+
+    // Tile-major depth buffer, TILE_SIZE rows of TILE_SIZE pixels per tile, bottom row first
+    const std::vector<float>& getDepth() { return this->depth; }
+    float getDepth(int x, int y) const;
+
+private:
+    struct Triangle
+    {
+        // Edge functions (a * x + b * y) + c, positive inside
+        float edgeA[3];
+        float edgeB[3];
+        float edgeC[3];
+        // Depth plane (a * x + b * y) + c
+        float depthA;
+        float depthB;
+        float depthC;
+        // Pixels the triangle may cover, inclusive
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+    };
+
+    struct Box
+    {
+        Bounds bounds;
+        glm::mat4 model;
+    };
+
+    glm::mat4 viewProjection;
+    // Scratch for the occluder being added
+    std::vector<glm::vec4> clipPositions;
+    std::vector<Triangle> triangles;
+    // Triangle indices overlapping each tile
+    std::vector<std::vector<uint32_t>> bins;
+
+    std::vector<float> depth;
+    std::vector<float> blockMax;
+    std::vector<float> tileMax;
+
+    std::vector<Box> boxes;
+    std::vector<uint8_t> occluded;
+
+    void addTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2);
+    void rasterizeTile(size_t tile);
+    void rasterizeTileScalar(size_t tile);
+    void updateMaxima(size_t tile);
+};
+
+#endif // OCCLUSIONCULLER_H
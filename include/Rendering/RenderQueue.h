@@ -0,0 +1,170 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include "Rendering/CommandList.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class ShaderProgram;
+
+// In drawing order
+enum RenderPass
+{
+    DEPTH_PASS = 0,
+    OPAQUE_PASS,
+    PASS_COUNT
+};
+
+/*!
+    Everything needed to issue one indexed draw
+*/
+struct DrawPacket
+{
+    ShaderProgram* program;
+    unsigned int textures[2];
+    unsigned int vertexArray;
+    unsigned int elementCount;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    unsigned int indexType;
+    // Where the mesh sits in the vertex array's shared buffers
+    int baseVertex;
+    unsigned int indexOffset;
+    // Non-zero draws instanced with per-instance matrices from the vertex array, model is then unused
+    unsigned int instanceCount;
+    glm::mat4 model;
+
+    // Position-only program and vertex array for the depth pre-pass, nullptr draws no depth pass
+    ShaderProgram* depthProgram;
+    unsigned int depthVertexArray;
+    // Albedo an alpha-tested depth program samples, 0 otherwise
+    unsigned int depthTexture;
+};
+
+/*!
+    Collects draw packets for a frame, radix sorts them by a 64 bit key
+    (pass | program | material | vertex array | depth) and records them in
+    that order into command lists, skipping any program, texture or vertex
+    array bind that would not change state. Lists cover consecutive runs of
+    packets and are recorded in parallel, each starting from the state the
+    run before it leaves bound. Only execute touches GL.
+
+    With the depth pre-pass on, opaque packets are also drawn depth-only in
+    DEPTH_PASS first, and the opaque pass then tests GL_LEQUAL without
+    writing depth, so every pixel is shaded about once.
+*/
+class RenderQueue
+{
+public:
+    struct Stats
+    {
+        size_t packets;
+        size_t drawCalls;
+        size_t instances;
+        // Submitted across every instance, after LOD selection
+        size_t triangles;
+        size_t programSwitches;
+        size_t textureBinds;
+        size_t vertexArrayBinds;
+        // Draws of the depth pre-pass, included in drawCalls
+        size_t depthDraws;
+    };
+
+    // Packets per command list, and so per recording job
+    static const size_t PACKETS_PER_LIST = 1024;
+
+    RenderQueue();
+
+    /*!
+        Clears last frame's packets, view and far clip are used to build depth keys
+    */
+    void begin(const glm::mat4& view, float farClip);
+
+    /*!
+        Uniform block bound at the start of the frame's commands, none by default
+    */
+    void setUniformBlock(uint32_t binding, uint32_t buffer);
+
+    /*!
+        Draws opaque packets in a depth pre-pass first, takes effect for packets submitted afterwards
+    */
+    void setDepthPrepass(bool enabled) { this->depthPrepass = enabled; }
+    bool getDepthPrepass() { return this->depthPrepass; }
+    /*!
+        Draws opaque packets with their depth program, adding a fixed colour per fragment that
+        passes the depth test, so brightness shows how often each pixel is shaded
+    */
+    void setOverdrawView(bool enabled) { this->overdrawView = enabled; }
+
+    void submit(RenderPass pass, uint16_t materialKey, const DrawPacket& packet);
+
+    void sort();
+    /*!
+        Records the sorted packets into command lists, on the job system unless parallel is false.
+        Any thread may record, stats are final afterwards.
+    */
+    void record(bool parallel = true);
+    /*!
+        Replays the recorded lists on the GL thread, recording first if that has not happened yet
+    */
+    void execute();
+    /*!
+        GL_SAMPLES_PASSED query the next execute wraps around the opaque pass, 0 for none
+    */
+    void setFragmentQuery(unsigned int query) { this->fragmentQuery = query; }
+
+    const Stats& getStats() { return this->stats; }
+    const std::vector<DrawPacket>& getPackets() { return this->packets; }
+
+    /*!
+        Small stable id for a texture pair, objects cache it instead of hashing every frame.
+        Shared by every queue, any thread may ask for one.
+    */
+    static uint16_t getMaterialKey(unsigned int albedo, unsigned int normalMap);
+
+private:
+    struct SortItem
+    {
+        uint64_t key;
+        uint32_t packet;
+    };
+
+    std::vector<DrawPacket> packets;
+    std::vector<SortItem> items;
+    std::vector<SortItem> scratch;
+    // Per queue so queues of different snapshots can sort at the same time
+    size_t histograms[8][256];
+
+    glm::mat4 view;
+    float farClip;
+    Stats stats;
+
+    bool depthPrepass;
+    bool overdrawView;
+    size_t depthPackets;
+    unsigned int fragmentQuery;
+
+    bool hasUniformBlock;
+    uint32_t uniformBinding;
+    uint32_t uniformBuffer;
+
+    // Only the first listCount are this frame's, the rest keep their memory for later frames
+    std::vector<std::unique_ptr<CommandList>> lists;
+    std::vector<Stats> listStats;
+    size_t listCount;
+    bool recorded;
+
+    static std::mutex materialKeyMutex;
+    static std::unordered_map<uint64_t, uint16_t> materialKeys;
+
+    void recordRange(size_t list, size_t begin, size_t end);
+    void recordPassState(CommandList& commands, uint32_t pass);
+};
+
+#endif // RENDERQUEUE_H
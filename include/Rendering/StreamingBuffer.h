@@ -0,0 +1,71 @@
+#ifndef STREAMINGBUFFER_H
+#define STREAMINGBUFFER_H
+
+#include <cstddef>
+#include <deque>
+
+typedef struct __GLsync* GLsync;
+
+/*!
+    Ring allocator over one large GL buffer for data rewritten every frame. Each allocation
+    maps its own range unsynchronized, so the driver neither stalls nor renames the buffer,
+    and endFrame fences everything the frame allocated. Space is only reused once the fence
+    of the frame that last used it has signalled, waiting for it if the ring has caught up.
+*/
+class StreamingBuffer
+{
+public:
+    StreamingBuffer();
+    ~StreamingBuffer();
+
+    bool init(size_t capacity);
+
+    /*!
+        Deletes the buffer and fences, call before the context is destroyed
+    */
+    void release();
+
+    /*!
+        Maps size bytes at an offset that is a multiple of alignment, nullptr if they can never
+        fit. The range must be written and unmapped before anything else is allocated.
+    */
+    void* map(size_t size, size_t alignment, size_t& offset);
+    void unmap();
+
+    /*!
+        Copies data into a new allocation, returns false if it can never fit
+    */
+    bool write(const void* data, size_t size, size_t alignment, size_t& offset);
+
+    /*!
+        Fences this frame's allocations, call once the frame's draws using them are issued
+    */
+    void endFrame();
+
+    unsigned int getHandle() { return this->bufferHandle; }
+    size_t getCapacity() { return this->capacity; }
+    // Times an allocation had to wait for the GPU to release space
+    size_t getStallCount() { return this->stallCount; }
+
+private:
+    struct FrameFence
+    {
+        GLsync fence;
+        // Where the frame's allocations end, the ring is free up to here once the fence signals
+        size_t end;
+    };
+
+    unsigned int bufferHandle;
+    size_t capacity;
+    // Next free byte and start of the oldest bytes still in use, equal when nothing is in use
+    size_t head;
+    size_t tail;
+    size_t frameBegin;
+    std::deque<FrameFence> frames;
+    size_t stallCount;
+
+    bool fits(size_t offset, size_t size);
+    bool retireOldest();
+};
+
+#endif // STREAMINGBUFFER_H
@@ -0,0 +1,100 @@
+#ifndef VERTEXLAYOUT_H
+#define VERTEXLAYOUT_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*!
+    Encoding of Object vertices in a single interleaved buffer.
+
+    Attribute locations match VertexShader.h: 0 position, 1 uv, then either
+    2 tangent / 3 bitangent as floats, or with a packed tangent frame
+    2 normal / 3 tangent with the bitangent sign in w, both
+    GL_INT_2_10_10_10_REV, the bitangent rebuilt in the shader.
+
+    Both tangent encodings describe a right-handed frame, the normal is
+    cross(tangent, bitangent) as in the original float layout. Mirrored UVs
+    are not supported: their bitangent would flip the normal, so importers
+    build the bitangent as cross(normal, tangent) and the packed w is
+    always +1.
+
+    Quantized positions are 16 bit unsigned normalized within the mesh
+    bounds. The bounds use one scale for all axes so normals stay correct,
+    and the dequantizing transform is folded into the model matrix.
+*/
+class VertexLayout
+{
+public:
+    enum PositionEncoding
+    {
+        POSITION_FLOAT,
+        POSITION_UNORM16
+    };
+
+    enum UvEncoding
+    {
+        UV_FLOAT,
+        UV_HALF
+    };
+
+    enum TangentEncoding
+    {
+        TANGENT_FLOAT,
+        TANGENT_PACKED
+    };
+
+    VertexLayout(PositionEncoding position = POSITION_FLOAT, UvEncoding uv = UV_HALF, TangentEncoding tangent = TANGENT_PACKED);
+
+    // 44 bytes, the original two stream layout in one stream
+    static VertexLayout full() { return VertexLayout(POSITION_FLOAT, UV_FLOAT, TANGENT_FLOAT); }
+    // 24 bytes
+    static VertexLayout compact() { return VertexLayout(POSITION_FLOAT, UV_HALF, TANGENT_PACKED); }
+    // 20 bytes
+    static VertexLayout quantized() { return VertexLayout(POSITION_UNORM16, UV_HALF, TANGENT_PACKED); }
+
+    /*!
+        Parses full, compact or quantized, returns false for anything else
+    */
+    static bool fromName(const std::string& name, VertexLayout& layout);
+
+    size_t getStride() const { return this->stride; }
+
+    bool operator==(const VertexLayout& other) const
+    {
+        return this->position == other.position && this->uv == other.uv && this->tangent == other.tangent;
+    }
+
+    /*!
+        #define lines the lit shaders need for this layout
+    */
+    std::string getDefines() const;
+
+    /*!
+        Points attributes 0-3 at the bound GL_ARRAY_BUFFER, a vertex array must be bound
+    */
+    void apply() const;
+    /*!
+        Points only attribute 0 at the bound GL_ARRAY_BUFFER, for depth-only draws
+    */
+    void applyPositions() const;
+
+    /*!
+        Packs count vertices given as 5 floats (position, uv) and 6 floats (tangent, bitangent) each.
+        positionTransform receives the matrix that maps stored positions back to mesh space.
+    */
+    void encode(const float* vertices, const float* tangents, size_t count, std::vector<unsigned char>& out, glm::mat4& positionTransform) const;
+
+private:
+    PositionEncoding position;
+    UvEncoding uv;
+    TangentEncoding tangent;
+
+    size_t stride;
+    size_t uvOffset;
+    size_t tangentOffset;
+};
+
+#endif // VERTEXLAYOUT_H
@@ -0,0 +1,101 @@
+#ifndef TRANSFORMSTORE_H
+#define TRANSFORMSTORE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*!
+    Local translation, rotation and scale of every scene node, with parent links and cached world
+    matrices. Components live in separate arrays kept in depth first order, so parents always come
+    before their children and every subtree is one contiguous run of slots. Nodes are referred to
+    by handles that stay valid while slots move.
+*/
+class TransformStore
+{
+public:
+    static const uint32_t INVALID = 0xFFFFFFFFu;
+
+    static TransformStore* instance;
+    static TransformStore* getInstance();
+
+    /*!
+        Adds an identity node under parent (a root without one), placed at the end of the parent's subtree
+    */
+    uint32_t create(uint32_t parent = INVALID);
+
+    /*!
+        Removes the node and its whole subtree, slots are compacted on the next update
+    */
+    void destroy(uint32_t handle);
+
+    /*!
+        Removes every node, outstanding handles must not be used afterwards
+    */
+    void clear();
+
+    void setPosition(uint32_t handle, const glm::vec3& position);
+    void setRotation(uint32_t handle, const glm::quat& rotation);
+    void setScale(uint32_t handle, const glm::vec3& scale);
+
+    const glm::vec3& getPosition(uint32_t handle) { return this->positions[this->slots[handle]]; }
+    const glm::quat& getRotation(uint32_t handle) { return this->rotations[this->slots[handle]]; }
+    const glm::vec3& getScale(uint32_t handle) { return this->scales[this->slots[handle]]; }
+    uint32_t getParent(uint32_t handle);
+
+    /*!
+        World matrix as of the last update
+    */
+    const glm::mat4& getWorld(uint32_t handle) { return this->worlds[this->slots[handle]]; }
+
+    /*!
+        Recomputes the world matrices of changed nodes and everything below them
+    */
+    void update();
+
+    size_t getCount() { return this->nodeCount; }
+    // World matrices recomputed by the last update
+    size_t getUpdatedCount() { return this->updatedCount; }
+
+private:
+    TransformStore();
+
+    // Per slot components
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> worlds;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> subtreeSizes;
+    std::vector<uint32_t> depths;
+    std::vector<uint32_t> handles;
+    std::vector<uint8_t> dirty;
+    std::vector<uint8_t> changed;
+    std::vector<uint8_t> alive;
+
+    // Slot of every handle, INVALID for free ones
+    std::vector<uint32_t> slots;
+    std::vector<uint32_t> freeHandles;
+
+    size_t nodeCount;
+    size_t deadCount;
+    size_t updatedCount;
+    bool anyDirty;
+
+    // Update plan: nodes above the split depth run serially, subtrees rooted at it run in parallel
+    bool planValid;
+    std::vector<uint32_t> shallowSlots;
+    std::vector<uint32_t> splitRoots;
+    std::vector<size_t> workerRoots;
+
+    void insertSlot(uint32_t slot);
+    void compact();
+    void buildPlan(int workerCount);
+    size_t updateSlots(size_t begin, size_t end);
+    size_t updateSubtrees(size_t firstRoot, size_t lastRoot);
+};
+
+#endif // TRANSFORMSTORE_H
@@ -0,0 +1,77 @@
+#ifndef COOKEDTEXTURE_H
+#define COOKEDTEXTURE_H
+
+#include "Textures/MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*!
+    On-disk layout of a cooked .otex texture, little endian:
+    header, levelCount level records, then each level's payload at a 16 byte aligned offset.
+    Levels run from full size down to 1x1 and are ready for glTexImage2D or
+    glCompressedTexImage2D as stored.
+*/
+struct CookedTextureHeader
+{
+    char magic[4];
+    uint32_t version;
+    // GL internal format of the payload
+    uint32_t internalFormat;
+    // GL pixel format and type of uncompressed payloads, 0 when compressed
+    uint32_t format;
+    uint32_t type;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t flags;
+    uint32_t reserved[3];
+};
+
+struct CookedTextureLevel
+{
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+static_assert(sizeof(CookedTextureHeader) == 48, "CookedTextureHeader layout is part of the file format");
+static_assert(sizeof(CookedTextureLevel) == 24, "CookedTextureLevel layout is part of the file format");
+
+/*!
+    A cooked texture mapped into memory, level data points straight into the mapping
+*/
+class CookedTexture
+{
+public:
+    static const uint32_t VERSION = 1;
+    static const uint32_t COMPRESSED = 1;
+
+    bool open(const std::string& path);
+    void close();
+
+    /*!
+        Touches every page of the mapping so the uploads on the render thread never wait on disk
+    */
+    void prefetch();
+
+    const CookedTextureHeader& getHeader() { return *this->header; }
+    bool isCompressed() { return (this->header->flags & COMPRESSED) != 0; }
+    unsigned int getLevelCount() { return this->header->levelCount; }
+    const CookedTextureLevel& getLevel(unsigned int level) { return this->levels[level]; }
+    const unsigned char* getLevelData(unsigned int level) { return this->file.getData() + this->levels[level].offset; }
+
+    /*!
+        Validates only the header, cheap enough for the render thread
+    */
+    static bool readHeader(const std::string& path, CookedTextureHeader& header);
+
+private:
+    MappedFile file;
+    const CookedTextureHeader* header = nullptr;
+    const CookedTextureLevel* levels = nullptr;
+};
+
+#endif // COOKEDTEXTURE_H
@@ -0,0 +1,46 @@
+#ifndef TEXTURECOOKER_H
+#define TEXTURECOOKER_H
+
+#include <string>
+
+/*!
+    Converts source images into cooked .otex textures (see CookedTexture.h)
+    with a CPU built mip chain, so loading needs neither a decode nor glGenerateMipmap.
+*/
+class TextureCooker
+{
+public:
+    /*!
+        Cooked file used for a source image, stored next to it
+    */
+    static std::string getCookedPath(const std::string& source);
+
+    /*!
+        True if the cooked file exists and is newer than the source
+    */
+    static bool isUpToDate(const std::string& source, const std::string& cooked);
+
+    /*!
+        Decodes source and writes the cooked texture. compress stores a DXT5 payload
+        compressed by the driver, which needs a current GL context with S3TC support;
+        without it the texture is cooked uncompressed.
+    */
+    static bool cook(const std::string& source, const std::string& destination, bool compress);
+
+    /*!
+        Writes an uncompressed cooked texture from decoded RGBA8 pixels, safe on any thread
+    */
+    static bool cookPixels(const unsigned char* rgba, int width, int height, const std::string& destination);
+
+    /*!
+        Halves an RGBA8 image with a 2x2 box filter, odd edges repeat their last texel
+    */
+    static void downsample(const unsigned char* source, int width, int height, unsigned char* destination);
+
+    /*!
+        Whether the current GL context can create and read back DXT5 textures, GL thread only
+    */
+    static bool supportsCompression();
+};
+
+#endif // TEXTURECOOKER_H
@@ -0,0 +1,190 @@
+#ifndef TEXTUREMANAGER_H
+#define TEXTUREMANAGER_H
+
+#include "Textures/CookedTexture.h"
+#include "Jobs/JobSystem.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*!
+    Owns every GL texture loaded from disk. Textures are shared by canonical
+    path, and optionally by a hash of the file contents so copies of the same
+    image under different names upload once. Users hold references through
+    acquire/release; a texture nobody references is deleted a few frames
+    later unless it is acquired again in the meantime.
+
+    Loading is asynchronous: acquire returns a handle showing a 1x1
+    placeholder straight away, background jobs decode the file, and update()
+    streams the pixels through a pixel buffer object a budgeted slice per
+    frame. The handle stays the same once the real image is resident.
+
+    With cooked textures enabled, a source with an up to date .otex beside it
+    is memory mapped instead of decoded and its stored mips are uploaded
+    smallest first, one or more levels per frame. Sources without one are
+    cooked by the decode job on first load.
+*/
+class TextureManager
+{
+
+public:
+    static TextureManager* instance;
+    static TextureManager* getInstance();
+
+    // Frames an unreferenced texture stays resident before it is deleted
+    static const unsigned int DELETE_DELAY_FRAMES = 3;
+    // Decoded bytes copied into pixel buffers per update, bounds the streaming cost of a frame
+    static const size_t UPLOAD_BUDGET_BYTES = 8 * 1024 * 1024;
+    // Decode jobs running at once, each drains the shared queue
+    static const int MAX_DECODERS = 4;
+
+    // Picks the placeholder shown while loading
+    enum Usage
+    {
+        COLOR_TEXTURE,
+        NORMAL_TEXTURE
+    };
+
+    // Called on the render thread once the texture is resident or failed to load
+    typedef std::function<void(unsigned int handle, bool loaded)> LoadedCallback;
+
+    /*!
+        Returns the texture for path with one more reference, queueing the load on first use.
+        matchContent also reuses an already loaded texture with identical file contents,
+        which reads the file on the calling thread.
+        Returns 0 if the file could not be opened.
+    */
+    unsigned int acquire(const std::string& path, Usage usage = COLOR_TEXTURE, bool matchContent = false, LoadedCallback onLoaded = nullptr);
+
+    /*!
+        Adds a reference to a texture previously returned by acquire
+    */
+    void retain(unsigned int handle);
+    void release(unsigned int handle);
+
+    bool isResident(unsigned int handle);
+    /*!
+        Blocks until the texture is decoded and fully uploaded, returns false if it failed to load
+    */
+    bool wait(unsigned int handle);
+    void waitAll();
+
+    /*!
+        Load from and write cooked .otex files, on by default
+    */
+    void setCookedTextures(bool enabled) { this->cookedTextures = enabled; }
+
+    /*!
+        Hands decoded textures to GL within the upload budget, call once per frame before drawing
+    */
+    void update();
+
+    /*!
+        Deletes textures that have been unreferenced for DELETE_DELAY_FRAMES, call once per frame
+    */
+    void endFrame();
+
+    /*!
+        Cancels pending loads and deletes every texture regardless of references,
+        the GL context must still be current
+    */
+    void clear();
+
+    size_t getTextureCount() { return this->textures.size(); }
+    size_t getPendingCount() { return this->uploads.size(); }
+    // Estimated GPU memory of all resident textures including mip chains
+    size_t getResidentBytes() { return this->residentBytes; }
+
+private:
+    TextureManager();
+
+    // Shared between the render thread and the decode job that owns it
+    struct Upload
+    {
+        unsigned int handle;
+        std::string path;
+        std::vector<unsigned char> fileBytes;
+        // Empty when the source is decoded without cooking
+        std::string cookedPath;
+        bool useCooked = false;
+
+        // Written by the decode job before decoded is set
+        unsigned char* pixels = nullptr;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        bool decoded = false;
+        bool cancelled = false;
+        // Set instead of pixels when the cooked file was mapped
+        CookedTexture cooked;
+        bool mapped = false;
+
+        // Render thread staging state
+        unsigned int pixelBuffer = 0;
+        size_t stagedBytes = 0;
+        // Next cooked level to upload, levels go in from the smallest
+        int nextLevel = -1;
+        size_t residentBytes = 0;
+        std::vector<LoadedCallback> callbacks;
+    };
+
+    struct Texture
+    {
+        std::string path;
+        uint64_t contentHash;
+        unsigned int refCount;
+        // Frame the last reference was released, only meaningful while refCount is 0
+        uint64_t releaseFrame;
+        size_t bytes;
+        bool resident;
+    };
+
+    std::unordered_map<unsigned int, Texture> textures;
+    std::unordered_map<std::string, unsigned int> byPath;
+    std::unordered_map<uint64_t, unsigned int> byContent;
+    std::vector<unsigned int> unreferenced;
+
+    // Render thread list of loads in submission order
+    std::vector<std::shared_ptr<Upload>> uploads;
+
+    // Decode queue shared with the decode jobs, activeDecoders is guarded by decodeMutex
+    std::deque<std::shared_ptr<Upload>> decodeQueue;
+    std::mutex decodeMutex;
+    std::condition_variable decodeDone;
+    int activeDecoders;
+    JobSystem::Counter decodeJobs;
+    bool cookedTextures;
+
+    uint64_t frame;
+    size_t residentBytes;
+
+    static std::string canonicalPath(const std::string& path);
+    static uint64_t hashContent(const std::vector<unsigned char>& bytes);
+    static bool readFile(const std::string& path, std::vector<unsigned char>& bytes);
+
+    int getDecoderLimit();
+    void cancelDecodes();
+    void decodeLoop();
+
+    unsigned int createPlaceholder(Usage usage);
+    /*!
+        Copies up to budget bytes of a decoded upload into its pixel buffer, returns true once it is resident
+    */
+    bool stage(Upload& upload, size_t& budget);
+    bool stageCooked(Upload& upload, size_t& budget);
+    void finishUpload(Upload& upload, bool loaded);
+    void cancel(Upload& upload);
+
+    void addReference(unsigned int handle);
+    void destroy(unsigned int handle);
+};
+
+#endif // TEXTUREMANAGER_H
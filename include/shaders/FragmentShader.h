@@ -1,50 +1,126 @@
+// #version and the FrameData block are prepended by ShaderProgram
+// Variant defines come from ShaderVariants:
+// NORMAL_MAP samples the normal map instead of using the interpolated normal
+// SPECULAR adds the Blinn-Phong highlight, ALPHA_TEST discards texels below half alpha
+// CLUSTERED_LIGHTING selects the clustered light loop over the brute force one
+// LIGHT_LOOP_BOUND gives the brute force loop a constant bound the compiler can unroll
+// DEPTH_ONLY skips lighting for the depth pre-pass, its colour only shows in the overdraw view
 const char* fragmentShader = R"(
-#version 330 core
-
-#define MAX_LIGHTS 16
+#ifdef DEPTH_ONLY
+#ifdef ALPHA_TEST
+in vec2 TexCoord;
+uniform sampler2D texture1;
+#endif
+out vec4 FragColor;
 
+void main() {
+#ifdef ALPHA_TEST
+   if (texture(texture1, TexCoord).a < 0.5)
+      discard;
+#endif
+   // Added up per pixel in the overdraw view, eight fragments saturate it
+   FragColor = vec4(0.125, 0.0625, 0.03125, 1.0);
+}
+#else
 in vec2 TexCoord;
 in mat3 TBN;
 in vec3 FragPos;
 out vec4 FragColor;
 uniform sampler2D texture1;
+#ifdef NORMAL_MAP
 uniform sampler2D normalMap; // Normal map
-uniform vec3 lightPositions[MAX_LIGHTS];
-uniform vec3 lightColors[MAX_LIGHTS];
-uniform int numLights; // active number of lights
-uniform vec3 viewPos; // Camera position
+#endif
+uniform samplerBuffer lightData; // Two texels per light: xyz position w radius, rgb color
+#ifdef CLUSTERED_LIGHTING
+uniform usamplerBuffer clusterGrid; // Per cluster: x offset into lightIndices, y light count
+uniform usamplerBuffer lightIndices;
+#endif
+
+vec3 ambient = vec3(0.0);
+vec3 diffuse = vec3(0.0);
+const float ambientStrength = 0.1;
+#ifdef SPECULAR
+vec3 specular = vec3(0.0);
+const float specularStrength = 0.5;
+#endif
+
+void addLight(int light, vec3 normal, vec3 viewDir) {
+   vec4 positionRadius = texelFetch(lightData, light * 2);
+   vec3 lightColor = texelFetch(lightData, light * 2 + 1).rgb;
+
+   // Windowed falloff reaching zero at the light radius
+   vec3 toLight = positionRadius.xyz - FragPos;
+   float distanceRatio = dot(toLight, toLight) / (positionRadius.w * positionRadius.w);
+   float attenuation = clamp(1.0 - distanceRatio, 0.0, 1.0);
+   attenuation *= attenuation;
+   if (attenuation <= 0.0)
+      return;
+   lightColor *= attenuation;
+
+   // Ambient
+   ambient += ambientStrength * lightColor;
+
+   // Diffuse
+   vec3 lightDir = normalize(toLight);
+   float diff = max(dot(normal, lightDir), 0.0);
+   diffuse += diff * lightColor;
+
+#ifdef SPECULAR
+   // Specular (Blinn-Phong)
+   vec3 halfwayDir = normalize(lightDir + viewDir);
+   float spec = pow(max(dot(normal, halfwayDir), 0.0), 128.0);
+   specular += specularStrength * spec * lightColor;
+#endif
+}
+
 void main() {
+   vec4 albedo = texture(texture1, TexCoord);
+#ifdef ALPHA_TEST
+   if (albedo.a < 0.5)
+      discard;
+#endif
+
+#ifdef NORMAL_MAP
    // Sample normal from normal map (tangent space)
    vec3 normal = texture(normalMap, TexCoord).rgb;
    normal = normalize(normal * 2.0 - 1.0); // Convert from [0,1] to [-1,1]
    normal = normalize(TBN * normal); // Transform to world space
+#else
+   vec3 normal = normalize(TBN[2]);
+#endif
+
+   vec3 viewDir = normalize(cameraPosition.xyz - FragPos);
 
-   // Initialize lighting components
-   vec3 ambient = vec3(0.0);
-   vec3 diffuse = vec3(0.0);
-   vec3 specular = vec3(0.0);
-   float ambientStrength = 0.1;
-   float specularStrength = 0.5;
+#ifdef CLUSTERED_LIGHTING
+   // Find this fragment's cluster from its screen tile and exponential depth slice
+   float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+   int slice = clamp(int(log(viewDepth) * clusterParams.x + clusterParams.y), 0, clusterDims.z - 1);
+   ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterParams.zw), clusterDims.xy - 1);
+   int cluster = tile.x + clusterDims.x * (tile.y + clusterDims.y * slice);
 
+   uvec2 range = texelFetch(clusterGrid, cluster).xy;
+   for (uint i = 0u; i < range.y; ++i) {
+      addLight(int(texelFetch(lightIndices, int(range.x + i)).x), normal, viewDir);
+   }
+#elif defined(LIGHT_LOOP_BOUND)
+   // Constant trip count, fewer lights than the bound skip the remaining iterations
+   for (int i = 0; i < LIGHT_LOOP_BOUND; ++i) {
+      if (i < lightCount.x)
+         addLight(i, normal, viewDir);
+   }
+#else
    // Compute contribution from each light
-   for (int i = 0; i < numLights; ++i) {
-      // Ambient
-      ambient += ambientStrength * lightColors[i];
-
-      // Diffuse
-      vec3 lightDir = normalize(lightPositions[i] - FragPos);
-      float diff = max(dot(normal, lightDir), 0.0);
-      diffuse += diff * lightColors[i];
-
-      // Specular (Blinn-Phong)
-      vec3 viewDir = normalize(viewPos - FragPos);
-      vec3 halfwayDir = normalize(lightDir + viewDir);
-      float spec = pow(max(dot(normal, halfwayDir), 0.0), 128.0);
-      specular += specularStrength * spec * lightColors[i];
+   for (int i = 0; i < lightCount.x; ++i) {
+      addLight(i, normal, viewDir);
    }
+#endif
 
    // Combine lighting with texture
-   vec3 result = (ambient + diffuse + specular) * texture(texture1, TexCoord).rgb;
-   FragColor = vec4(result, 1.0);
+   vec3 lighting = ambient + diffuse;
+#ifdef SPECULAR
+   lighting += specular;
+#endif
+   FragColor = vec4(lighting * albedo.rgb, 1.0);
 }
-)";
\ No newline at end of file
+#endif
+)";
@@ -0,0 +1,13 @@
+// Shared by every program, must match FrameUniformData in FrameUniformBuffer.cpp
+const char* frameDataBlock = R"(
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition; // xyz world space eye
+    vec4 frameTime; // x seconds, y delta seconds
+    ivec4 lightCount; // x number of lights in lightData
+    ivec4 clusterDims; // xyz light cluster grid size
+    vec4 clusterParams; // x depth slice scale, y depth slice bias, zw cluster tile size in pixels
+};
+)";
@@ -0,0 +1,62 @@
+#ifndef SHADERCOMPILER_H
+#define SHADERCOMPILER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+class ShaderProgram;
+struct GLFWwindow;
+
+/*!
+    Compiles preloaded programs on a thread of its own, current on a hidden context that shares
+    objects with the main one, so compiling and linking overlaps whatever the GL thread loads
+    meanwhile. Everything queued is started before any status is queried, which lets drivers with
+    KHR_parallel_shader_compile work on the whole batch at once.
+
+    Without the thread, queued programs compile on the first thread that waits for one of them.
+*/
+class ShaderCompiler
+{
+public:
+    static ShaderCompiler* instance;
+    static ShaderCompiler* getInstance();
+
+    /*!
+        Creates the hidden context and starts the thread, call on the main thread with the
+        window hints of shareWith still set. Returns false if no shared context could be made.
+    */
+    bool start(GLFWwindow* shareWith);
+    /*!
+        Finishes what is queued and destroys the context
+    */
+    void stop();
+
+    void submit(ShaderProgram* program);
+    /*!
+        Returns once program has been linked or failed to, GL thread only
+    */
+    void wait(ShaderProgram* program);
+
+private:
+    GLFWwindow* context;
+    std::thread thread;
+    bool running;
+    bool stopping;
+
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable finished;
+    std::deque<ShaderProgram*> pending;
+    // Taken off pending by the thread and not finished yet
+    std::unordered_set<ShaderProgram*> compiling;
+
+    ShaderCompiler();
+
+    void compilerLoop();
+    static void compileBatch(const std::deque<ShaderProgram*>& batch);
+};
+
+#endif // SHADERCOMPILER_H
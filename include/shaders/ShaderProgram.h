@@ -0,0 +1,147 @@
+#ifndef SHADERPROGRAM_H
+#define SHADERPROGRAM_H
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+/*!
+    Linked GL program with every active uniform reflected into a location table at link time,
+    so per-frame code never looks uniforms up by name. Programs are shared between objects.
+
+    With a cache directory set, linked programs are saved with glGetProgramBinary under a hash of
+    their sources, defines and the driver, and later runs load them instead of compiling. Shared
+    programs can be preloaded, which hands them to the ShaderCompiler and only waits for them once
+    they are asked for.
+*/
+class ShaderProgram
+{
+public:
+    // Uniforms the engine sets every frame, resolved once after linking (-1 when inactive)
+    // Camera and light data come from the FrameData uniform block instead
+    enum Uniform
+    {
+        MODEL,
+        UNIFORM_COUNT
+    };
+
+    // Texture units samplers are bound to at link time
+    enum TextureUnit
+    {
+        ALBEDO_UNIT = 0,
+        NORMAL_MAP_UNIT = 1,
+        LIGHT_DATA_UNIT = 2,
+        CLUSTER_GRID_UNIT = 3,
+        LIGHT_INDEX_UNIT = 4,
+        FIRST_FREE_UNIT = 5
+    };
+
+    /*!
+        Shared lit program built from VertexShader.h / FragmentShader.h with normal mapping, specular
+        and the dynamic light loop, compiled on first use
+    */
+    static ShaderProgram* getDefault();
+
+    /*!
+        Shared lit program compiled with the given #define lines, one program per distinct set.
+        Waits for it if it was preloaded and is still compiling.
+    */
+    static ShaderProgram* getShared(const std::string& defines);
+
+    /*!
+        Starts compiling the shared program for defines without waiting for it
+    */
+    static void preload(const std::string& defines);
+
+    /*!
+        Directory program binaries are kept in, created on first write. Empty disables the cache.
+        Call on the GL thread, the driver strings become part of every cache key.
+    */
+    static void setCacheDirectory(const std::string& directory);
+    // Programs loaded from and missing in the cache since startup
+    static int getCacheHits() { return cacheHits; }
+    static int getCacheMisses() { return cacheMisses; }
+
+    /*!
+        Deletes all shared programs, call before the context is destroyed
+    */
+    static void releaseAll();
+
+    ShaderProgram();
+    ~ShaderProgram();
+
+    /*!
+        Compiles both stages with the #version line, defines and FrameData block prepended
+    */
+    bool compile(const char* vertexSource, const char* fragmentSource, const std::string& defines = "");
+
+    /*!
+        First half of compile, loads the cached binary or starts compiling and linking without
+        waiting on the driver. Any thread with a context sharing this program's objects.
+    */
+    void beginLink(const char* vertexSource, const char* fragmentSource, const std::string& defines);
+    /*!
+        Waits for the link, falling back to compiling when a cached binary is rejected, and saves
+        new binaries. Same thread as beginLink. The GL thread still has to reflect the result.
+    */
+    bool endLink();
+
+    /*!
+        Makes the program current, skipping glUseProgram when it already is
+    */
+    void bind();
+
+    unsigned int getHandle() { return this->handle; }
+
+    /*!
+        Small sequential id, used in render queue sort keys
+    */
+    unsigned int getId() { return this->id; }
+    int getLocation(Uniform uniform) { return this->locations[uniform]; }
+
+    /*!
+        Location of any active uniform by name from the reflected table, meant for setup code
+    */
+    int findUniform(const std::string& name);
+
+    /*!
+        Texture unit a sampler uniform was assigned at link time, -1 if the program has no such sampler
+    */
+    int findSamplerUnit(const std::string& name);
+
+private:
+    friend class ShaderCompiler;
+
+    unsigned int handle;
+    unsigned int id;
+
+    // Kept between beginLink and endLink
+    const char* vertexSource;
+    const char* fragmentSource;
+    std::string defines;
+    unsigned int stages[2];
+    std::string cachePath;
+    bool fromCache;
+    // Preloaded and not yet collected by getShared
+    bool pending;
+    int locations[UNIFORM_COUNT];
+    std::unordered_map<std::string, int> uniformLocations;
+    std::unordered_map<std::string, int> samplerUnits;
+
+    static std::unordered_map<std::string, ShaderProgram*> sharedPrograms;
+    static unsigned int boundHandle;
+    static unsigned int nextId;
+
+    static std::string cacheDirectory;
+    static std::string driverKey;
+    static bool binariesSupported;
+    static std::atomic<int> cacheHits;
+    static std::atomic<int> cacheMisses;
+
+    void beginCompile();
+    bool loadBinary();
+    void saveBinary();
+    void reflectUniforms();
+};
+
+#endif // SHADERPROGRAM_H
@@ -0,0 +1,56 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include <cstdint>
+#include <string>
+
+/*!
+    Keys of the specialized variants of the lit program. A key packs the material's feature
+    bits with how the scene's lights are looped over, and maps to the #define lines that
+    compile exactly that variant, so a material without a normal map or specular never pays
+    for them.
+
+    Brute force lighting with at most MAX_UNROLLED_LIGHTS lights loops to a constant bound,
+    the light count rounded up to a power of two, which the compiler can unroll. More lights
+    and clustered lighting keep the dynamic loop.
+*/
+class ShaderVariants
+{
+public:
+    enum Feature
+    {
+        NORMAL_MAP = 1 << 0,
+        SPECULAR = 1 << 1,
+        ALPHA_TEST = 1 << 2,
+        // Position only program for the depth pre-pass, of the other features only ALPHA_TEST applies
+        DEPTH_ONLY = 1 << 3,
+        FEATURE_MASK = NORMAL_MAP | SPECULAR | ALPHA_TEST | DEPTH_ONLY
+    };
+
+    // Lighting key looping dynamically over the brute force light list
+    static const uint32_t DYNAMIC_LIGHTING = 0;
+    static const int MAX_UNROLLED_LIGHTS = 16;
+
+    /*!
+        Lighting part of a key for lightCount lights, combined with feature bits by makeKey
+    */
+    static uint32_t getLightingKey(bool clustered, int lightCount);
+    static uint32_t makeKey(uint32_t features, uint32_t lighting) { return (features & FEATURE_MASK) | lighting; }
+    // Depth-only variant for a material's features
+    static uint32_t getDepthKey(uint32_t features) { return (features & ALPHA_TEST) | DEPTH_ONLY; }
+
+    // Constant light loop bound of a key, -1 for a dynamic loop
+    static int getLightBound(uint32_t key);
+
+    /*!
+        #define lines selecting the variant, one per line
+    */
+    static std::string getDefines(uint32_t key);
+
+private:
+    static const uint32_t CLUSTERED_BIT = 1 << 4;
+    // Bits above hold the loop bound plus one, zero for a dynamic loop
+    static const uint32_t LIGHT_BOUND_SHIFT = 5;
+};
+
+#endif // SHADERVARIANTS_H
@@ -1,24 +1,55 @@
+// #version and the FrameData block are prepended by ShaderProgram
+// INSTANCED takes the model matrix from a per-instance attribute instead of the uniform
+// PACKED_TANGENT_FRAME reads a normal and signed tangent and rebuilds the bitangent
+// DEPTH_ONLY only transforms positions (and UVs for ALPHA_TEST) for the depth pre-pass
 const char* vertexShader = R"(
-#version 330 core
 layout (location = 0) in vec3 aPos;
+#if !defined(DEPTH_ONLY) || defined(ALPHA_TEST)
 layout (location = 1) in vec2 aTexCoord;
+out vec2 TexCoord;
+#endif
+#ifndef DEPTH_ONLY
+#ifdef PACKED_TANGENT_FRAME
+layout (location = 2) in vec3 aNormal;
+layout (location = 3) in vec4 aTangent;
+#else
 layout (location = 2) in vec3 aTangent;
 layout (location = 3) in vec3 aBitangent;
-out vec2 TexCoord;
+#endif
 out mat3 TBN;
 out vec3 FragPos;
+#endif
+#ifdef INSTANCED
+layout (location = 4) in mat4 aInstanceModel;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+// The lit pass tests against depth from the pre-pass, both must compute identical positions
+invariant gl_Position;
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifdef INSTANCED
+    mat4 model = aInstanceModel;
+#endif
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * worldPos;
+#if !defined(DEPTH_ONLY) || defined(ALPHA_TEST)
     TexCoord = aTexCoord;
-    FragPos = vec3(model * vec4(aPos, 1.0)); // Fragment position in world space
+#endif
+#ifndef DEPTH_ONLY
+    FragPos = vec3(worldPos); // Fragment position in world space
 
     // Compute TBN matrix
+#ifdef PACKED_TANGENT_FRAME
+    vec3 N = normalize(mat3(model) * aNormal);
+    vec3 T = normalize(mat3(model) * aTangent.xyz);
+    // w holds the handedness, only its sign: before GL 4.2 a 2 bit -1 decodes to -1/3
+    vec3 B = cross(N, T) * (aTangent.w < 0.0 ? -1.0 : 1.0);
+#else
     vec3 T = normalize(mat3(model) * aTangent);
     vec3 B = normalize(mat3(model) * aBitangent);
     vec3 N = normalize(cross(T, B)); // Compute normal from tangent and bitangent
+#endif
     TBN = mat3(T, B, N);
+#endif
 }
-)";
\ No newline at end of file
+)";
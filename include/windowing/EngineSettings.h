@@ -0,0 +1,92 @@
+#ifndef ENGINESETTINGS_H
+#define ENGINESETTINGS_H
+
+#include <string>
+
+struct EngineSettings
+{
+    // Create the GL context without showing a window (hidden GLFW window, OSMesa fallback)
+    bool headless = false;
+
+    // Run a fixed number of frames of the scripted scene and report frame timings
+    bool benchmark = false;
+    int benchmarkFrames = 1000;
+    int warmupFrames = 60;
+    std::string benchmarkOutput = "benchmark.json";
+
+    // Number of cubes in the scene, laid out on a grid
+    int objectCount = 1;
+    // Draw this many cubes as one instanced mesh instead of the object grid, 0 disables
+    int instanceCount = 0;
+    // Vertex encoding of scene meshes: full, compact or quantized (see VertexLayout)
+    std::string vertexFormat = "compact";
+    // OBJ or glTF mesh drawn instead of the cube, cached as .omesh beside it
+    std::string meshPath;
+    // Benchmark parsing meshPath against loading its cached .omesh
+    bool meshBenchmark = false;
+
+    // Benchmark the frustum culling kernel on a million bounding spheres
+    bool cullBenchmark = false;
+    // Benchmark occluder rasterization and occlusion tests of 100k boxes, SIMD against scalar
+    bool occlusionBenchmark = false;
+    // Benchmark world matrix updates of a ~100k node transform hierarchy
+    bool transformBenchmark = false;
+    // Benchmark job scheduling overhead and parallelFor scaling over 1..N threads
+    bool jobBenchmark = false;
+    // Benchmark serial against parallel command recording and GL replay of 10k and 100k draws
+    bool commandBenchmark = false;
+    // Job system worker threads, -1 uses one less than the core count
+    int jobWorkers = -1;
+    // Frames the simulation thread may run ahead of rendering, 0 simulates on the render thread
+    int pipelineDepth = 2;
+
+    // Skip drawing objects hidden behind the occluders (the front layer of the grid) in the CPU depth buffer
+    bool occlusionCulling = true;
+
+    // Depth-only pass before shading: auto (on while the estimated depth complexity is high), on or off
+    std::string depthPrepass = "auto";
+    // Show how often each pixel is shaded instead of the lit scene, F2 toggles it interactively
+    bool overdrawView = false;
+    // Benchmark the scene with the depth pre-pass off and on, comparing GPU time and shaded fragments
+    bool prepassCompare = false;
+
+    // Screen space error in pixels a mesh LOD may show, 0 always draws full detail
+    float lodErrorPixels = 1.f;
+
+    // Clustered forward lighting, otherwise every fragment loops over every light
+    bool clusteredLighting = true;
+    // Number of generated scene lights, 0 keeps the default two light setup
+    int lightCount = 0;
+    // Benchmark every lighting mode over 4..1024 lights instead of a single run
+    bool lightSweep = false;
+    // Specialize the brute force light loop to small light counts, otherwise it is always dynamic
+    bool shaderVariants = true;
+
+    // Frames recorded by the profiler (debug builds), starting at the first frame; F1 captures interactively
+    int captureFrames = 0;
+    std::string captureOutput = "capture.json";
+
+    // Load textures from cooked .otex files beside the sources, cooking them on first load
+    bool cookedTextures = true;
+    // Cook the scene textures offline and exit instead of rendering
+    bool cookTextures = false;
+    // Benchmark scene texture load times, JPEG decode against cooked files
+    bool textureBenchmark = false;
+
+    // Linked programs are cached here as driver binaries, empty always compiles
+    std::string shaderCacheDirectory = "shadercache";
+    // Benchmark building the scene programs cold against from the cache, serially and on the compiler thread
+    bool shaderBenchmark = false;
+
+    // Directory the scene textures are loaded from, must end in a path separator
+    std::string assetDirectory = "C:\\Users\\jrbri\\Documents\\Megascans\\Downloaded\\surface\\Brick_Modern_ui5kaiqg\\";
+
+    /*!
+        Fills settings from the command line, returns false on unknown or malformed arguments
+    */
+    bool parseArguments(int argc, char** argv);
+
+    static void printUsage();
+};
+
+#endif // ENGINESETTINGS_H
@@ -1,15 +1,40 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "windowing/EngineSettings.h"
+#include "Rendering/FrameUniformBuffer.h"
+#include "Rendering/StreamingBuffer.h"
+#include "Lighting/LightClusterGrid.h"
+#include "Rendering/RenderQueue.h"
+#include "Rendering/FrustumCuller.h"
+#include "Rendering/OcclusionCuller.h"
+#include "Rendering/FramePipeline.h"
+#include "Meshes/CookedMesh.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
 class GLFWwindow;
+class Object;
+class InstancedMesh;
+class FrameStats;
 
 class MainWindow 
 {
+    friend class Benchmarks;
+
 public:
     static const int WIDTH;
     static const int HEIGHT;
 
     MainWindow();
+    MainWindow(const EngineSettings& settings);
 
     bool isAlive();
 
@@ -19,15 +44,105 @@ public:
     static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 
     /*!
-        Starts render loop
+        Starts render loop, or the fixed frame benchmark when enabled in the settings
     */
     void exec();
 
 private:
     bool alive;
     GLFWwindow* window;
+    EngineSettings settings;
+    bool captureKeyDown;
+    bool overdrawKeyDown;
+    // Toggled on the GL thread, read by the simulation
+    std::atomic<bool> overdrawView;
+
+    std::vector<Object*> objects;
+    // Geometry and material source of instancedCubes, never submitted itself
+    Object* instancePrototype;
+    InstancedMesh* instancedCubes;
+    // Mapped --mesh file, open only while the scene loads
+    CookedMesh sceneMesh;
+    size_t instanceCursor;
+    // Per-frame data for the GL thread: frame uniforms and changed instance matrices
+    StreamingBuffer streamBuffer;
+    FrameUniformBuffer frameUniforms;
+    LightClusterGrid lightGrid;
+    // Simulation side, objects first and the instanced batch last
+    FrustumCuller culler;
+    // Front layer of the grid rasterized as occluders, the rest tested against it
+    OcclusionCuller occlusionCuller;
+    OccluderMesh sceneOccluder;
+    std::vector<uint8_t> occlusionCandidates;
+    FramePipeline pipeline;
+    // Last drawn frame
+    RenderQueue::Stats queueStats;
+    size_t visibleObjects;
+    size_t occludedObjects;
+    // Simulation side state of the automatic depth pre-pass switch
+    bool depthPrepassOn;
+    double lastFrameTime;
+    // steady_clock ticks of the last event poll, read by the simulation as its input timestamp
+    std::atomic<int64_t> inputPollTime;
+    // Scene load start to the first submitted frame, negative until that frame
+    std::chrono::steady_clock::time_point loadBegin;
+    double timeToFirstFrameMs;
+    float cameraDistance;
+
+    bool init();
+    bool createWindow(bool offscreenFallback);
+
+    /*!
+        Stream buffer, frame uniforms and light grid, everything a frame needs besides the scene
+    */
+    bool initFrameResources();
+    /*!
+        Path of the scene's albedo or normal map in settings.assetDirectory
+    */
+    std::string getSceneTexturePath(bool normal);
+    bool loadSceneTextures(Object* obj);
+    bool loadScene();
+    /*!
+        Builds an object from the imported scene mesh, or the cube without one
+    */
+    Object* createSceneObject();
+    bool loadInstancedCubes(int count, const std::function<glm::vec3(int)>& gridPosition);
+    void destroyScene();
+
+    /*!
+        Replaces the scene lights with count deterministic pseudo-random point lights
+    */
+    void createLights(int count);
+    bool setClusteredLighting(bool clustered);
+    /*!
+        ShaderVariants lighting key for the current lighting mode and light count
+    */
+    uint32_t getLightingVariant();
+    /*!
+        Reattaches every object's program for the current lighting, after lights are added or removed
+    */
+    bool updateShaderVariants();
+
+    /*!
+        Moves scripted scene elements to their state at time t (seconds)
+    */
+    void updateScene(double t);
+    /*!
+        Updates the scene to frame.time and records what to draw, never touches GL
+    */
+    void simulateFrame(FrameSnapshot& frame);
+    void renderFrame(FrameSnapshot& frame);
+    void pollEvents();
+
+    void runInteractive();
+    void runBenchmarkPass(FrameStats& stats);
+
+    /*!
+        Writes cooked .otex files for the scene textures, only stale ones unless forced
+    */
+    bool cookSceneTextures(bool force);
 
     void processInput();
 };
 
-#endif // MAINWINDOW_H
\ No newline at end of file
+#endif // MAINWINDOW_H
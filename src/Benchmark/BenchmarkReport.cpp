@@ -0,0 +1,92 @@
+#include "Benchmark/BenchmarkReport.h"
+#include "Benchmark/FrameStats.h"
+
+#include <iostream>
+
+BenchmarkReport::BenchmarkReport()
+{
+    this->runCount = 0;
+    this->runsOpen = false;
+}
+
+bool BenchmarkReport::open(const std::string& path, const std::string& runs)
+{
+    this->out.open(path);
+    if (!this->out)
+    {
+        std::cout << "Failed to open benchmark output: " << path << std::endl;
+        return false;
+    }
+
+    this->path = path;
+    this->runsName = runs;
+    this->runCount = 0;
+    this->runsOpen = false;
+
+    this->out.precision(6);
+    this->out << std::boolalpha;
+    this->out << "{\n";
+    return true;
+}
+
+void BenchmarkReport::addField(const std::string& name, const std::string& value)
+{
+    this->out << "  \"" << name << "\": \"" << FrameStats::escapeJson(value) << "\",\n";
+}
+
+void BenchmarkReport::addField(const std::string& name, const char* value)
+{
+    addField(name, std::string(value ? value : ""));
+}
+
+void BenchmarkReport::addJsonField(const std::string& name, const std::string& json)
+{
+    this->out << "  \"" << name << "\": " << json << ",\n";
+}
+
+void BenchmarkReport::addSummaryField(const std::string& name, FrameStats& stats)
+{
+    this->out << "  \"" << name << "\": { ";
+    stats.writeSummaryFields(this->out);
+    this->out << " },\n";
+}
+
+void BenchmarkReport::beginRun()
+{
+    if (!this->runsOpen)
+    {
+        this->out << "  \"" << this->runsName << "\": [";
+        this->runsOpen = true;
+    }
+    this->out << (this->runCount > 0 ? ",\n" : "\n") << "    { ";
+}
+
+void BenchmarkReport::addRunField(const std::string& name, const std::string& value)
+{
+    this->out << "\"" << name << "\": \"" << FrameStats::escapeJson(value) << "\", ";
+}
+
+void BenchmarkReport::addRunField(const std::string& name, const char* value)
+{
+    addRunField(name, std::string(value ? value : ""));
+}
+
+void BenchmarkReport::endRun(FrameStats& stats)
+{
+    stats.writeSummaryFields(this->out);
+    this->out << " }";
+    this->runCount++;
+}
+
+bool BenchmarkReport::close()
+{
+    if (!this->runsOpen)
+        this->out << "  \"" << this->runsName << "\": [";
+    this->out << "\n  ]\n}\n";
+    this->out.close();
+
+    if (!this->out)
+        return false;
+    std::cout << "Wrote " << this->path << std::endl;
+    return true;
+}
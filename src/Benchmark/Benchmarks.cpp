@@ -0,0 +1,834 @@
+#include "Benchmark/Benchmarks.h"
+#include "Benchmark/BenchmarkReport.h"
+#include "Benchmark/FrameStats.h"
+#include "Benchmark/Random.h"
+#include "windowing/Mainwindow.h"
+#include "RenderObjects/Object.h"
+#include "RenderObjects/InstancedMesh.h"
+#include "Camera/Camera.h"
+#include "shaders/ShaderProgram.h"
+#include "shaders/ShaderCompiler.h"
+#include "shaders/ShaderVariants.h"
+#include "Textures/TextureManager.h"
+#include "Scene/TransformStore.h"
+#include "Jobs/JobSystem.h"
+#include "Meshes/MeshData.h"
+#include "Meshes/MeshImporter.h"
+#include "Meshes/MeshOptimizer.h"
+#include "Meshes/MeshSimplifier.h"
+#include "Rendering/VertexLayout.h"
+#include "Rendering/GeometryPool.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+Benchmarks::Benchmarks(MainWindow* mainWindow)
+{
+    this->mainWindow = mainWindow;
+}
+
+void Benchmarks::runSceneBenchmark()
+{
+    const EngineSettings& settings = this->mainWindow->settings;
+    if (settings.lightSweep)
+    {
+        runLightSweep();
+        return;
+    }
+    if (settings.prepassCompare)
+    {
+        runPrepassComparison();
+        return;
+    }
+
+    FrameStats stats;
+    this->mainWindow->runBenchmarkPass(stats);
+
+    // State changes of the last frame, every frame of the scripted scene submits the same draws
+    const RenderQueue::Stats& queueStats = this->mainWindow->queueStats;
+    size_t visibleObjects = this->mainWindow->visibleObjects;
+    size_t occludedObjects = this->mainWindow->occludedObjects;
+    stats.setCounter("drawCalls", (double)queueStats.drawCalls);
+    stats.setCounter("instances", (double)queueStats.instances);
+    stats.setCounter("triangles", (double)queueStats.triangles);
+    stats.setCounter("visibleObjects", (double)visibleObjects);
+    stats.setCounter("occludedObjects", (double)occludedObjects);
+    stats.setCounter("occludedPercent", visibleObjects > 0 ? 100.0 * occludedObjects / visibleObjects : 0.0);
+    stats.setCounter("transformsUpdated", (double)TransformStore::getInstance()->getUpdatedCount());
+    stats.setCounter("residentTextureBytes", (double)TextureManager::getInstance()->getResidentBytes());
+    stats.setCounter("timeToFirstFrameMs", this->mainWindow->timeToFirstFrameMs);
+    VertexLayout layout;
+    VertexLayout::fromName(settings.vertexFormat, layout);
+    stats.setCounter("vertexStride", (double)layout.getStride());
+    stats.setCounter("programSwitches", (double)queueStats.programSwitches);
+    stats.setCounter("textureBinds", (double)queueStats.textureBinds);
+    stats.setCounter("vertexArrayBinds", (double)queueStats.vertexArrayBinds);
+    stats.setCounter("depthDraws", (double)queueStats.depthDraws);
+    GeometryPool::Stats poolStats = GeometryPool::getInstance()->getStats();
+    stats.setCounter("geometryBuffers", (double)poolStats.buffers);
+    stats.setCounter("geometryBytes", (double)(poolStats.vertexBytes + poolStats.indexBytes));
+    stats.setCounter("geometryFragmentation", poolStats.fragmentation);
+
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    std::cout << "Benchmark on " << (renderer ? renderer : "unknown renderer") << std::endl;
+    stats.print();
+
+    if (stats.writeJson(settings.benchmarkOutput, renderer ? renderer : "", settings.warmupFrames))
+        std::cout << "Wrote " << settings.benchmarkOutput << std::endl;
+}
+
+void Benchmarks::runLightSweep()
+{
+    static const int lightCounts[] = { 4, 8, 16, 32, 64, 128, 256, 512, 1024 };
+
+    const EngineSettings& settings = this->mainWindow->settings;
+    BenchmarkReport report;
+    if (!report.open(settings.benchmarkOutput))
+        return;
+    report.addField("renderer", (const char*)glGetString(GL_RENDERER));
+    report.addField("frames", settings.benchmarkFrames);
+    report.addField("shaderVariants", settings.shaderVariants);
+
+    for (int clustered = 0; clustered < 2; clustered++)
+    {
+        if (!this->mainWindow->setClusteredLighting(clustered == 1))
+            return;
+
+        for (int count : lightCounts)
+        {
+            this->mainWindow->createLights(count);
+            if (!this->mainWindow->updateShaderVariants())
+                return;
+
+            FrameStats stats;
+            this->mainWindow->runBenchmarkPass(stats);
+
+            const char* mode = clustered ? "clustered" : "brute";
+            std::cout << mode << " lighting, " << count << " lights" << std::endl;
+            stats.print();
+
+            report.beginRun();
+            report.addRunField("lighting", mode);
+            report.addRunField("lights", count);
+            report.endRun(stats);
+        }
+    }
+
+    report.close();
+}
+
+void Benchmarks::runPrepassComparison()
+{
+    static const char* modes[] = { "off", "on" };
+
+    EngineSettings& settings = this->mainWindow->settings;
+    BenchmarkReport report;
+    if (!report.open(settings.benchmarkOutput))
+        return;
+    report.addField("renderer", (const char*)glGetString(GL_RENDERER));
+    report.addField("frames", settings.benchmarkFrames);
+    report.addField("objects", settings.instanceCount > 0 ? settings.instanceCount : settings.objectCount);
+
+    double shaded[2] = { 0.0, 0.0 };
+    for (int i = 0; i < 2; i++)
+    {
+        settings.depthPrepass = modes[i];
+
+        FrameStats stats;
+        this->mainWindow->runBenchmarkPass(stats);
+        shaded[i] = stats.getCounter("shadedFragments");
+        stats.setCounter("drawCalls", (double)this->mainWindow->queueStats.drawCalls);
+        stats.setCounter("depthDraws", (double)this->mainWindow->queueStats.depthDraws);
+
+        std::cout << "Depth pre-pass " << modes[i] << std::endl;
+        stats.print();
+
+        report.beginRun();
+        report.addRunField("depthPrepass", modes[i]);
+        report.endRun(stats);
+    }
+
+    if (shaded[0] > 0.0)
+        std::cout << "Depth pre-pass shades " << 100.0 * (1.0 - shaded[1] / shaded[0]) << "% fewer fragments" << std::endl;
+
+    report.close();
+}
+
+void Benchmarks::runTextureBenchmark()
+{
+    const int runs = 5;
+
+    // Cook up front, otherwise the first cooked load pays for the cook
+    if (!this->mainWindow->cookSceneTextures(false))
+        return;
+
+    const EngineSettings& settings = this->mainWindow->settings;
+    BenchmarkReport report;
+    if (!report.open(settings.benchmarkOutput))
+        return;
+    report.addField("renderer", (const char*)glGetString(GL_RENDERER));
+
+    TextureManager* textures = TextureManager::getInstance();
+    std::string albedo = this->mainWindow->getSceneTexturePath(false);
+    std::string normal = this->mainWindow->getSceneTexturePath(true);
+
+    for (int cooked = 0; cooked < 2; cooked++)
+    {
+        // Each run is a cold texture cache but a warm OS file cache for both paths
+        FrameStats stats;
+        textures->setCookedTextures(cooked == 1);
+        for (int run = 0; run < runs; run++)
+        {
+            textures->clear();
+            glFinish();
+
+            auto begin = std::chrono::steady_clock::now();
+            unsigned int albedoHandle = textures->acquire(albedo, TextureManager::COLOR_TEXTURE);
+            unsigned int normalHandle = textures->acquire(normal, TextureManager::NORMAL_TEXTURE);
+            textures->waitAll();
+            glFinish();
+            stats.addCpuSample(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+
+            stats.setCounter("residentTextureBytes", (double)textures->getResidentBytes());
+            textures->release(albedoHandle);
+            textures->release(normalHandle);
+        }
+
+        const char* path = cooked ? "cooked" : "jpeg";
+        std::cout << path << " texture loads" << std::endl;
+        stats.print();
+
+        report.beginRun();
+        report.addRunField("path", path);
+        report.endRun(stats);
+    }
+
+    textures->clear();
+    textures->setCookedTextures(settings.cookedTextures);
+
+    report.close();
+}
+
+void Benchmarks::runMeshBenchmark()
+{
+    const int runs = 5;
+    const EngineSettings& settings = this->mainWindow->settings;
+    const std::string& path = settings.meshPath;
+    CookedMesh& sceneMesh = this->mainWindow->sceneMesh;
+
+    // Make sure the cache exists so the cached runs never import
+    if (!MeshImporter::load(path, sceneMesh))
+        return;
+    const CookedMeshLod& full = sceneMesh.getLods()[0];
+    size_t triangles = full.indexCount / 3;
+    MeshOptimizer::CacheStats cooked = MeshOptimizer::analyzeVertexCache(sceneMesh.getIndices() + full.firstIndex, full.indexCount,
+                                                                          sceneMesh.getVertexCount());
+    std::vector<CookedMeshLod> lods(sceneMesh.getLods(), sceneMesh.getLods() + sceneMesh.getLodCount());
+    sceneMesh.close();
+
+    // Vertex shader invocations the authored index order would cost, for comparison
+    MeshData imported;
+    if (!MeshImporter::import(path, imported))
+        return;
+    MeshOptimizer::CacheStats authored = MeshOptimizer::analyzeVertexCache(imported.indices.data(), imported.indices.size(),
+                                                                           imported.getVertexCount());
+    imported.clear();
+
+    BenchmarkReport report;
+    if (!report.open(settings.benchmarkOutput))
+        return;
+    report.addField("renderer", (const char*)glGetString(GL_RENDERER));
+    report.addField("mesh", path);
+    report.addField("triangles", triangles);
+
+    std::ostringstream json;
+    json << "{ \"authored\": " << authored.acmr << ", \"optimized\": " << cooked.acmr << " }";
+    report.addJsonField("acmr", json.str());
+    json.str("");
+    json << "{ \"authored\": " << authored.atvr << ", \"optimized\": " << cooked.atvr << " }";
+    report.addJsonField("atvr", json.str());
+    json.str("");
+    json << "[";
+    for (size_t i = 0; i < lods.size(); i++)
+        json << (i > 0 ? ", " : "") << "{ \"triangles\": " << lods[i].indexCount / 3 << ", \"error\": " << lods[i].error << " }";
+    json << "]";
+    report.addJsonField("lods", json.str());
+
+    for (int cached = 0; cached < 2; cached++)
+    {
+        // Both paths end with the geometry in GL buffers, the OS file cache is warm for both
+        FrameStats stats;
+        for (int run = 0; run < runs; run++)
+        {
+            glFinish();
+            auto begin = std::chrono::steady_clock::now();
+
+            Object* obj = nullptr;
+            if (cached)
+            {
+                if (sceneMesh.open(MeshImporter::getCookedPath(path)))
+                    obj = this->mainWindow->createSceneObject();
+                sceneMesh.close();
+            }
+            else
+            {
+                MeshData mesh;
+                if (MeshImporter::import(path, mesh))
+                {
+                    MeshOptimizer::optimize(mesh);
+                    MeshSimplifier::generateLods(mesh);
+                    VertexLayout layout;
+                    VertexLayout::fromName(settings.vertexFormat, layout);
+                    obj = new Object();
+                    obj->setVertexLayout(layout);
+                    obj->buildGeometry(mesh.vertices.data(), mesh.vertices.size(), mesh.tangents.data(), mesh.tangents.size(),
+                                       mesh.indices.data(), mesh.indices.size(), mesh.lods.data(), mesh.lods.size());
+                }
+            }
+            glFinish();
+            stats.addCpuSample(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+            delete obj;
+        }
+
+        const char* mode = cached ? "cached" : "parse";
+        std::cout << mode << " mesh loads" << std::endl;
+        stats.print();
+
+        report.beginRun();
+        report.addRunField("path", mode);
+        report.endRun(stats);
+    }
+
+    report.close();
+}
+
+void Benchmarks::runCullBenchmark()
+{
+    const size_t SPHERE_COUNT = 1000000;
+    const int runs = 100;
+
+    // Spheres scattered through a box around the default camera, roughly a third inside the frustum
+    Camera camera(this->mainWindow, 0.f, 0.f, -50.f, 45.f);
+    camera.setFarClippingDistance(150.f);
+    FrustumCuller culler;
+    culler.setFrustum(camera.getProjection() * camera.getView());
+
+    Random random(12345u);
+    culler.resize(SPHERE_COUNT);
+    for (size_t i = 0; i < SPHERE_COUNT; i++)
+        culler.set(i, glm::vec3(random.next(-100.f, 100.f), random.next(-100.f, 100.f), random.next(-100.f, 100.f)), random.next(0.1f, 2.f));
+
+    // The kernel must agree with the reference on every sphere
+    size_t visible = culler.cullScalar();
+    std::vector<uint8_t> reference = culler.getVisibility();
+    if (culler.cull() != visible || culler.getVisibility() != reference)
+    {
+        std::cout << "SIMD frustum culling disagrees with the scalar reference" << std::endl;
+        return;
+    }
+
+    BenchmarkReport report;
+    if (!report.open(this->mainWindow->settings.benchmarkOutput))
+        return;
+    report.addField("spheres", SPHERE_COUNT);
+    report.addField("visible", visible);
+
+    for (int simd = 0; simd < 2; simd++)
+    {
+        FrameStats stats;
+        std::vector<double> samples;
+        for (int run = 0; run < runs; run++)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            if (simd)
+                culler.cull();
+            else
+                culler.cullScalar();
+            samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+            stats.addCpuSample(samples.back());
+        }
+
+        const char* path = simd ? "simd" : "scalar";
+        double perMicrosecond = (double)SPHERE_COUNT / (FrameStats::summarize(samples).p50 * 1000.0);
+        std::cout << path << " culling: " << perMicrosecond << " spheres per microsecond" << std::endl;
+        stats.print();
+
+        report.beginRun();
+        report.addRunField("path", path);
+        report.addRunField("spheresPerMicrosecond", perMicrosecond);
+        report.endRun(stats);
+    }
+
+    report.close();
+}
+
+void Benchmarks::runOcclusionBenchmark()
+{
+    const size_t BOX_COUNT = 100000;
+    const int WALL_COLUMNS = 8;
+    const int WALL_ROWS = 6;
+    const float WALL_Z = 20.f;
+    const int runs = 100;
+
+    // A wall of slabs with gaps between them 30 units in front of the default camera, boxes scattered around and behind it
+    Camera camera(this->mainWindow, 0.f, 0.f, -50.f, 45.f);
+    camera.setFarClippingDistance(150.f);
+    glm::mat4 viewProjection = camera.getProjection() * camera.getView();
+
+    Bounds unitBox;
+    unitBox.add(glm::vec3(-0.5f));
+    unitBox.add(glm::vec3(0.5f));
+    OccluderMesh slab;
+    slab.setBox(unitBox);
+    std::vector<glm::mat4> wall;
+    for (int row = 0; row < WALL_ROWS; row++)
+    {
+        for (int column = 0; column < WALL_COLUMNS; column++)
+        {
+            glm::vec3 position((column - (WALL_COLUMNS - 1) * 0.5f) * 5.f, (row - (WALL_ROWS - 1) * 0.5f) * 5.f, WALL_Z);
+            wall.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(4.f, 4.f, 1.f)));
+        }
+    }
+
+    Random random(12345u);
+    std::vector<float> boxFront(BOX_COUNT);
+    FrustumCuller culler;
+    OcclusionCuller occlusionCuller;
+    culler.setFrustum(viewProjection);
+    culler.resize(BOX_COUNT);
+    occlusionCuller.resize(BOX_COUNT);
+    for (size_t i = 0; i < BOX_COUNT; i++)
+    {
+        glm::vec3 position(random.next(-40.f, 40.f), random.next(-30.f, 30.f), random.next(-60.f, 35.f));
+        float size = random.next(0.2f, 2.f);
+        culler.set(i, position, size * 0.8660254f);
+        occlusionCuller.set(i, unitBox, glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(size)));
+        boxFront[i] = position.z - size * 0.5f;
+    }
+    size_t inFrustum = culler.cull();
+
+    auto addWall = [&occlusionCuller, &viewProjection, &slab, &wall]() {
+        occlusionCuller.begin(viewProjection);
+        for (const glm::mat4& model : wall)
+            occlusionCuller.addOccluder(slab, model);
+    };
+
+    // The kernel must match the reference on every pixel, on one thread and split into jobs
+    addWall();
+    occlusionCuller.rasterizeScalar();
+    std::vector<float> reference = occlusionCuller.getDepth();
+    occlusionCuller.rasterize(false);
+    bool matches = occlusionCuller.getDepth() == reference;
+    occlusionCuller.rasterize(true);
+    if (!matches || occlusionCuller.getDepth() != reference)
+    {
+        std::cout << "SIMD occluder rasterization disagrees with the scalar reference" << std::endl;
+        return;
+    }
+
+    // Nothing entirely in front of the wall may be hidden by it
+    size_t occluded = occlusionCuller.cull(culler.getVisibility().data());
+    for (size_t i = 0; i < BOX_COUNT; i++)
+    {
+        if (occlusionCuller.isOccluded(i) && boxFront[i] > WALL_Z + 0.5f)
+        {
+            std::cout << "Occlusion culling hid a box in front of the occluders" << std::endl;
+            return;
+        }
+    }
+
+    BenchmarkReport report;
+    if (!report.open(this->mainWindow->settings.benchmarkOutput))
+        return;
+
+    double occludedPercent = inFrustum > 0 ? 100.0 * occluded / inFrustum : 0.0;
+    std::cout << "Occluders: " << occlusionCuller.getTriangleCount() << " triangles, " << occluded << " of " << inFrustum
+              << " boxes in the frustum occluded (" << occludedPercent << "%)" << std::endl;
+
+    report.addField("occluderTriangles", occlusionCuller.getTriangleCount());
+    report.addField("depthWidth", OcclusionCuller::WIDTH);
+    report.addField("depthHeight", OcclusionCuller::HEIGHT);
+    report.addField("boxes", BOX_COUNT);
+    report.addField("inFrustum", inFrustum);
+    report.addField("occluded", occluded);
+    report.addField("occludedPercent", occludedPercent);
+
+    // Setup is part of every rasterization run, as it is each frame
+    const char* paths[4] = { "scalar", "simd", "simdParallel", "test" };
+    for (int path = 0; path < 4; path++)
+    {
+        FrameStats stats;
+        for (int run = 0; run < runs; run++)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            if (path == 3)
+                occlusionCuller.cull(culler.getVisibility().data());
+            else
+            {
+                addWall();
+                if (path == 0)
+                    occlusionCuller.rasterizeScalar();
+                else
+                    occlusionCuller.rasterize(path == 2);
+            }
+            stats.addCpuSample(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        }
+
+        std::cout << paths[path] << (path == 3 ? " box tests:" : " rasterization:") << std::endl;
+        stats.print();
+
+        report.beginRun();
+        report.addRunField("path", paths[path]);
+        report.endRun(stats);
+    }
+
+    report.close();
+}
+
+void Benchmarks::runTransformBenchmark()
+{
+    const int BRANCHING = 5;
+    const int DEPTH = 7;
+    const int runs = 100;
+
+    // Built depth first so every create appends, 5^0 + ... + 5^7 = 97656 nodes
+    TransformStore* transforms = TransformStore::getInstance();
+    transforms->clear();
+    std::vector<uint32_t> nodes;
+    std::function<void(uint32_t, int)> build = [&](uint32_t parent, int depth) {
+        uint32_t node = transforms->create(parent);
+        transforms->setPosition(node, glm::vec3(1.f, 0.f, 0.f));
+        transforms->setRotation(node, glm::angleAxis(0.1f * (float)(nodes.size() % 7), glm::vec3(0.f, 1.f, 0.f)));
+        nodes.push_back(node);
+        if (depth < DEPTH)
+        {
+            for (int i = 0; i < BRANCHING; i++)
+                build(node, depth + 1);
+        }
+    };
+    build(TransformStore::INVALID, 0);
+    transforms->update();
+
+    BenchmarkReport report;
+    if (!report.open(this->mainWindow->settings.benchmarkOutput))
+    {
+        transforms->clear();
+        return;
+    }
+    report.addField("nodes", nodes.size());
+    report.addField("depth", DEPTH);
+
+    // Moving the root recomputes the whole tree, scattered moves only their subtrees
+    const char* cases[] = { "root", "scattered" };
+    for (int c = 0; c < 2; c++)
+    {
+        FrameStats stats;
+        size_t updated = 0;
+        Random random(12345u);
+        for (int run = 0; run < runs; run++)
+        {
+            if (c == 0)
+                transforms->setPosition(nodes[0], glm::vec3(0.f, 0.f, (float)run));
+            else
+            {
+                for (size_t i = 0; i < nodes.size() / 100; i++)
+                {
+                    uint32_t node = nodes[random.nextInt() % nodes.size()];
+                    transforms->setPosition(node, transforms->getPosition(node));
+                }
+            }
+
+            auto begin = std::chrono::steady_clock::now();
+            transforms->update();
+            stats.addCpuSample(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+            updated += transforms->getUpdatedCount();
+        }
+
+        std::cout << cases[c] << " updates, " << updated / runs << " world matrices per update" << std::endl;
+        stats.print();
+
+        report.beginRun();
+        report.addRunField("case", cases[c]);
+        report.addRunField("updated", updated / runs);
+        report.endRun(stats);
+    }
+    transforms->clear();
+
+    report.close();
+}
+
+void Benchmarks::runJobBenchmark()
+{
+    const int EMPTY_JOBS = 2048;
+    const size_t WORK_ITEMS = 1 << 20;
+    const int runs = 50;
+
+    const EngineSettings& settings = this->mainWindow->settings;
+    JobSystem* jobs = JobSystem::getInstance();
+    int maxThreads = jobs->getThreadCount();
+    if (settings.jobWorkers < 0)
+        maxThreads = std::max(maxThreads, (int)std::thread::hardware_concurrency());
+
+    BenchmarkReport report;
+    if (!report.open(settings.benchmarkOutput, "scaling"))
+        return;
+
+    // Scheduling cost alone: jobs that do nothing, and parallelFor calls with empty ranges
+    FrameStats emptyStats;
+    std::vector<double> emptySamples;
+    for (int run = 0; run < runs; run++)
+    {
+        JobSystem::Counter counter(0);
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < EMPTY_JOBS; i++)
+            jobs->run([] {}, &counter);
+        jobs->wait(counter);
+        emptySamples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        emptyStats.addCpuSample(emptySamples.back());
+    }
+    double jobNs = FrameStats::summarize(emptySamples).p50 * 1e6 / EMPTY_JOBS;
+    std::cout << "Empty jobs: " << jobNs << " ns per job" << std::endl;
+    emptyStats.print();
+
+    FrameStats forStats;
+    std::vector<double> forSamples;
+    for (int run = 0; run < runs; run++)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        jobs->parallelFor(WORK_ITEMS, 0, [](size_t, size_t) {});
+        forSamples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        forStats.addCpuSample(forSamples.back());
+    }
+    double forUs = FrameStats::summarize(forSamples).p50 * 1000.0;
+    std::cout << "Empty parallelFor: " << forUs << " us per call" << std::endl;
+    forStats.print();
+
+    report.addField("threads", jobs->getThreadCount());
+    report.addField("emptyJobNs", jobNs);
+    report.addSummaryField("emptyJobs", emptyStats);
+    report.addField("emptyParallelForUs", forUs);
+    report.addSummaryField("emptyParallelFor", forStats);
+
+    // The same compute bound loop on 1..maxThreads threads, restarting the system for each count
+    std::vector<float> results(WORK_ITEMS);
+    auto work = [&results](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+        {
+            float x = (float)i * 0.001f;
+            for (int k = 0; k < 64; k++)
+                x = std::sqrt(x * x + 1.f) * 0.999f;
+            results[i] = x;
+        }
+    };
+
+    double singleThread = 0.0;
+    for (int threads = 1; threads <= maxThreads; threads++)
+    {
+        jobs->stop();
+        jobs->start(threads - 1);
+
+        FrameStats stats;
+        std::vector<double> samples;
+        for (int run = 0; run < runs / 5; run++)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            jobs->parallelFor(WORK_ITEMS, 0, work);
+            samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+            stats.addCpuSample(samples.back());
+        }
+
+        double p50 = FrameStats::summarize(samples).p50;
+        if (threads == 1)
+            singleThread = p50;
+        double speedup = singleThread / p50;
+        std::cout << threads << " threads: " << speedup << "x" << std::endl;
+        stats.print();
+
+        report.beginRun();
+        report.addRunField("threads", threads);
+        report.addRunField("speedup", speedup);
+        report.endRun(stats);
+    }
+
+    jobs->stop();
+    jobs->start(settings.jobWorkers);
+
+    report.close();
+}
+
+void Benchmarks::runCommandBenchmark()
+{
+    static const int drawCounts[] = { 10000, 100000 };
+    const int runs = 20;
+
+    // One real object gives a valid packet, every draw is a copy of it in a different place
+    MainWindow* scene = this->mainWindow;
+    if (!scene->initFrameResources())
+        return;
+    Object* obj = scene->createSceneObject();
+    if (!obj)
+        return;
+    scene->objects.push_back(obj);
+    if (!scene->loadSceneTextures(obj) || !obj->compileShader(scene->getLightingVariant()))
+    {
+        std::cout << "error creating benchmark object" << std::endl;
+        return;
+    }
+    TransformStore::getInstance()->update();
+
+    // Every replay reads this one frame block
+    Camera camera(scene, 0.f, 0.f, -50.f, 45.f);
+    scene->frameUniforms.update(&camera, &scene->lightGrid, 0.f, 0.f);
+
+    RenderQueue queue;
+    queue.begin(glm::mat4(1.0f), 100.f);
+    obj->submit(queue);
+    DrawPacket packet = queue.getPackets()[0];
+    uint16_t materialKey = RenderQueue::getMaterialKey(packet.textures[0], packet.textures[1]);
+
+    BenchmarkReport report;
+    if (!report.open(scene->settings.benchmarkOutput))
+        return;
+    report.addField("renderer", (const char*)glGetString(GL_RENDERER));
+    report.addField("threads", JobSystem::getInstance()->getThreadCount());
+
+    for (int draws : drawCounts)
+    {
+        queue.begin(glm::mat4(1.0f), 100.f);
+        for (int i = 0; i < draws; i++)
+        {
+            packet.model = glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 100), (float)(i / 100 % 100), -(float)(i / 10000) - 1.f));
+            queue.submit(OPAQUE_PASS, materialKey, packet);
+        }
+        queue.sort();
+
+        // Serial recording, parallel recording, then replaying the parallel recording
+        const char* phases[] = { "recordSerial", "recordParallel", "replay" };
+        std::vector<double> medians;
+        for (int phase = 0; phase < 3; phase++)
+        {
+            FrameStats stats;
+            std::vector<double> samples;
+            for (int run = 0; run < runs; run++)
+            {
+                auto begin = std::chrono::steady_clock::now();
+                if (phase < 2)
+                    queue.record(phase == 1);
+                else
+                    queue.execute();
+                samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+                stats.addCpuSample(samples.back());
+
+                // Keep the driver from queueing up replays
+                if (phase == 2)
+                    glFinish();
+            }
+            medians.push_back(FrameStats::summarize(samples).p50);
+
+            std::cout << draws << " draws, " << phases[phase] << std::endl;
+            stats.print();
+
+            report.beginRun();
+            report.addRunField("draws", draws);
+            report.addRunField("phase", phases[phase]);
+            report.endRun(stats);
+        }
+        std::cout << draws << " draws, parallel recording " << medians[0] / medians[1] << "x faster" << std::endl;
+    }
+
+    report.close();
+}
+
+void Benchmarks::runShaderBenchmark()
+{
+    const int runs = 10;
+    const EngineSettings& settings = this->mainWindow->settings;
+
+    // Every program the scene can use with the configured vertex format
+    VertexLayout layout;
+    VertexLayout::fromName(settings.vertexFormat, layout);
+    std::vector<std::string> programs;
+    for (bool clustered : { true, false })
+    {
+        uint32_t variant = ShaderVariants::makeKey(ShaderVariants::NORMAL_MAP | ShaderVariants::SPECULAR, ShaderVariants::getLightingKey(clustered, -1));
+        programs.push_back(Object::getShaderDefines(variant, layout));
+        programs.push_back(InstancedMesh::getShaderDefines(variant, layout));
+    }
+    uint32_t depthVariant = ShaderVariants::getDepthKey(ShaderVariants::NORMAL_MAP | ShaderVariants::SPECULAR);
+    programs.push_back(Object::getShaderDefines(depthVariant, layout));
+    programs.push_back(InstancedMesh::getShaderDefines(depthVariant, layout));
+
+    BenchmarkReport report;
+    if (!report.open(settings.benchmarkOutput))
+        return;
+    report.addField("renderer", (const char*)glGetString(GL_RENDERER));
+    report.addField("programs", programs.size());
+
+    // Ready means every program is linked and reflected, as the first frame needs them
+    auto build = [&programs]() {
+        ShaderProgram::releaseAll();
+        glFinish();
+        auto begin = std::chrono::steady_clock::now();
+        for (const std::string& defines : programs)
+            ShaderProgram::preload(defines);
+        for (const std::string& defines : programs)
+            ShaderProgram::getShared(defines);
+        glFinish();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    };
+
+    for (int warm = 0; warm < 2; warm++)
+    {
+        if (warm && settings.shaderCacheDirectory.empty())
+        {
+            std::cout << "Shader cache disabled, skipping warm builds" << std::endl;
+            break;
+        }
+
+        // Cold builds never see the cache, warm ones load what an untimed build just wrote
+        ShaderProgram::setCacheDirectory(warm ? settings.shaderCacheDirectory : "");
+        if (warm)
+            build();
+
+        for (int threaded = 0; threaded < 2; threaded++)
+        {
+            if (threaded)
+                ShaderCompiler::getInstance()->start(this->mainWindow->window);
+            else
+                ShaderCompiler::getInstance()->stop();
+
+            int hits = ShaderProgram::getCacheHits();
+            FrameStats stats;
+            for (int run = 0; run < runs; run++)
+                stats.addCpuSample(build());
+            hits = ShaderProgram::getCacheHits() - hits;
+
+            const char* mode = warm ? "warm" : "cold";
+            const char* thread = threaded ? "compilerThread" : "renderThread";
+            std::cout << mode << " builds on the " << thread << ", " << hits << " cache hits" << std::endl;
+            stats.print();
+
+            report.beginRun();
+            report.addRunField("cache", mode);
+            report.addRunField("thread", thread);
+            report.addRunField("cacheHits", hits);
+            report.endRun(stats);
+        }
+    }
+
+    ShaderProgram::releaseAll();
+    ShaderProgram::setCacheDirectory(settings.shaderCacheDirectory);
+
+    report.close();
+}
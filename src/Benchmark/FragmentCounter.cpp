@@ -0,0 +1,31 @@
+#include "Benchmark/FragmentCounter.h"
+
+#include <glad/glad.h>
+
+static double readSamplesPassed(const unsigned int* queries)
+{
+    GLuint64 samples = 0;
+    glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &samples);
+    return (double)samples;
+}
+
+bool FragmentCounter::init()
+{
+    return this->ring.init(1, readSamplesPassed, "fragment");
+}
+
+unsigned int FragmentCounter::beginFrame()
+{
+    const unsigned int* queries = this->ring.beginFrame();
+    return queries ? queries[0] : 0;
+}
+
+void FragmentCounter::endFrame()
+{
+    this->ring.endFrame();
+}
+
+void FragmentCounter::collect(std::vector<double>& out, bool wait)
+{
+    this->ring.collect(out, wait);
+}
@@ -0,0 +1,181 @@
+#include "Benchmark/FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+FrameStats::FrameStats()
+{
+}
+
+void FrameStats::reserve(size_t frames)
+{
+    this->cpuSamples.reserve(frames);
+    this->gpuSamples.reserve(frames);
+}
+
+void FrameStats::addCpuSample(double ms)
+{
+    this->cpuSamples.push_back(ms);
+}
+
+void FrameStats::addGpuSample(double ms)
+{
+    this->gpuSamples.push_back(ms);
+}
+
+void FrameStats::setCounter(const std::string& name, double value)
+{
+    for (auto& counter : this->counters)
+    {
+        if (counter.first == name)
+        {
+            counter.second = value;
+            return;
+        }
+    }
+
+    this->counters.push_back(std::make_pair(name, value));
+}
+
+double FrameStats::getCounter(const std::string& name) const
+{
+    for (const auto& counter : this->counters)
+    {
+        if (counter.first == name)
+            return counter.second;
+    }
+    return 0.0;
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    // Nearest-rank percentile
+    size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+    if (rank == 0)
+        rank = 1;
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+FrameStats::Summary FrameStats::summarize(const std::vector<double>& samples)
+{
+    Summary summary = { 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    if (samples.empty())
+        return summary;
+
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    double total = 0.0;
+    for (double ms : sorted)
+        total += ms;
+
+    summary.count = sorted.size();
+    summary.mean = total / sorted.size();
+    summary.p50 = percentile(sorted, 50.0);
+    summary.p95 = percentile(sorted, 95.0);
+    summary.p99 = percentile(sorted, 99.0);
+    summary.max = sorted.back();
+    return summary;
+}
+
+static void printSummary(const char* label, const FrameStats::Summary& summary)
+{
+    if (summary.count == 0)
+    {
+        std::cout << label << ": no samples" << std::endl;
+        return;
+    }
+
+    std::cout << label << " (" << summary.count << " frames) ms:"
+              << " mean " << summary.mean
+              << " p50 " << summary.p50
+              << " p95 " << summary.p95
+              << " p99 " << summary.p99
+              << " max " << summary.max << std::endl;
+}
+
+void FrameStats::print()
+{
+    printSummary("CPU", summarize(this->cpuSamples));
+    printSummary("GPU", summarize(this->gpuSamples));
+
+    for (const auto& counter : this->counters)
+        std::cout << counter.first << ": " << counter.second << std::endl;
+}
+
+static void writeSummary(std::ostream& out, const FrameStats::Summary& summary)
+{
+    out << "{ \"count\": " << summary.count
+        << ", \"mean\": " << summary.mean
+        << ", \"p50\": " << summary.p50
+        << ", \"p95\": " << summary.p95
+        << ", \"p99\": " << summary.p99
+        << ", \"max\": " << summary.max << " }";
+}
+
+static void writeSamples(std::ostream& out, const std::vector<double>& samples)
+{
+    out << "[";
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        if (i != 0)
+            out << ", ";
+        out << samples[i];
+    }
+    out << "]";
+}
+
+void FrameStats::writeSummaryFields(std::ostream& out)
+{
+    out << "\"cpuMs\": ";
+    writeSummary(out, summarize(this->cpuSamples));
+    out << ", \"gpuMs\": ";
+    writeSummary(out, summarize(this->gpuSamples));
+
+    if (!this->counters.empty())
+    {
+        out << ", \"counters\": {";
+        for (size_t i = 0; i < this->counters.size(); i++)
+            out << (i == 0 ? " \"" : ", \"") << escapeJson(this->counters[i].first) << "\": " << this->counters[i].second;
+        out << " }";
+    }
+}
+
+std::string FrameStats::escapeJson(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        if ((unsigned char)c >= 0x20)
+            escaped += c;
+    }
+    return escaped;
+}
+
+bool FrameStats::writeJson(const std::string& path, const std::string& renderer, int warmupFrames)
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        std::cout << "Failed to open benchmark output: " << path << std::endl;
+        return false;
+    }
+
+    out.precision(6);
+    out << "{\n";
+    out << "  \"renderer\": \"" << escapeJson(renderer) << "\",\n";
+    out << "  \"warmupFrames\": " << warmupFrames << ",\n";
+    out << "  \"frames\": " << this->cpuSamples.size() << ",\n  ";
+    writeSummaryFields(out);
+    out << ",\n  \"cpuSamplesMs\": ";
+    writeSamples(out, this->cpuSamples);
+    out << ",\n  \"gpuSamplesMs\": ";
+    writeSamples(out, this->gpuSamples);
+    out << "\n}\n";
+
+    return (bool)out;
+}
@@ -0,0 +1,36 @@
+#include "Benchmark/GpuFrameTimer.h"
+
+#include <glad/glad.h>
+
+static double readFrameTime(const unsigned int* queries)
+{
+    GLuint64 begin = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+    return (double)(end - begin) / 1000000.0;
+}
+
+bool GpuFrameTimer::init()
+{
+    return this->ring.init(2, readFrameTime, "timer");
+}
+
+void GpuFrameTimer::beginFrame()
+{
+    const unsigned int* queries = this->ring.beginFrame();
+    if (queries)
+        glQueryCounter(queries[0], GL_TIMESTAMP);
+}
+
+void GpuFrameTimer::endFrame()
+{
+    const unsigned int* queries = this->ring.endFrame();
+    if (queries)
+        glQueryCounter(queries[1], GL_TIMESTAMP);
+}
+
+void GpuFrameTimer::collect(std::vector<double>& out, bool wait)
+{
+    this->ring.collect(out, wait);
+}
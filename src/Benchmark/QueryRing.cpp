@@ -0,0 +1,88 @@
+#include "Benchmark/QueryRing.h"
+
+#include <glad/glad.h>
+#include <iostream>
+
+QueryRing::QueryRing()
+{
+    this->queriesPerSlot = 0;
+    this->read = nullptr;
+    this->head = 0;
+    this->pending = 0;
+    this->active = false;
+}
+
+QueryRing::~QueryRing()
+{
+    if (!this->queries.empty())
+        glDeleteQueries((GLsizei)this->queries.size(), this->queries.data());
+}
+
+bool QueryRing::init(int queriesPerSlot, ReadFunction read, const char* label)
+{
+    this->queriesPerSlot = queriesPerSlot;
+    this->read = read;
+    this->queries.resize(SLOT_COUNT * queriesPerSlot);
+    glGenQueries((GLsizei)this->queries.size(), this->queries.data());
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cout << "GL Error after generating " << label << " queries" << std::endl;
+        this->queries.clear();
+        return false;
+    }
+
+    return true;
+}
+
+const unsigned int* QueryRing::beginFrame()
+{
+    if (this->queries.empty() || this->active)
+        return nullptr;
+
+    // Every slot still in flight, only happens when the GPU is more than SLOT_COUNT frames behind
+    if (this->pending == SLOT_COUNT)
+        resolve(true);
+
+    this->active = true;
+    return getSlot((this->head + this->pending) % SLOT_COUNT);
+}
+
+const unsigned int* QueryRing::endFrame()
+{
+    if (!this->active)
+        return nullptr;
+
+    const unsigned int* slot = getSlot((this->head + this->pending) % SLOT_COUNT);
+    this->active = false;
+    this->pending++;
+    return slot;
+}
+
+void QueryRing::collect(std::vector<double>& out, bool wait)
+{
+    resolve(wait);
+
+    out.insert(out.end(), this->finished.begin(), this->finished.end());
+    this->finished.clear();
+}
+
+void QueryRing::resolve(bool wait)
+{
+    while (this->pending > 0)
+    {
+        const unsigned int* slot = getSlot(this->head);
+
+        if (!wait)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(slot[this->queriesPerSlot - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return;
+        }
+
+        this->finished.push_back(this->read(slot));
+
+        this->head = (this->head + 1) % SLOT_COUNT;
+        this->pending--;
+    }
+}
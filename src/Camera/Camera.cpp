@@ -17,6 +17,8 @@ Camera::Camera(MainWindow* context)
 
 Camera::Camera(MainWindow* context, float x, float y, float z, float fovY)
 {
+    this->nearClip = 0.1f;
+    this->farClip = 100.0f;
     setLocation(x, y, z);
     setFOVY(fovY);
     this->context = context;
@@ -32,6 +34,17 @@ void Camera::setLocation(float x, float y, float z)
     this->view = glm::translate(glm::mat4(1.0f), glm::vec3(this->x, this->y, this->z)); 
 }
 
+glm::vec3 Camera::getPosition()
+{
+    return glm::vec3(glm::inverse(this->view)[3]);
+}
+
+float Camera::getPixelScale()
+{
+    // projection[1][1] is 1 / tan(fovY / 2), clip space spans 2 units over the viewport height
+    return 0.5f * MainWindow::HEIGHT * this->projection[1][1];
+}
+
 void Camera::setFOVY(float fovY)
 {
     this->fovY = fovY;
@@ -0,0 +1,476 @@
+#include "Jobs/JobSystem.h"
+
+#include <algorithm>
+
+// Yields an idle worker spends looking for work before it sleeps
+static const int IDLE_SPINS = 256;
+// Ranges per thread parallelFor aims for when no grain is given, spare ones balance uneven work
+static const size_t RANGES_PER_THREAD = 4;
+
+// Index of the calling thread in threads, -1 for threads the system doesn't know
+static thread_local int currentThread = -1;
+
+JobSystem* JobSystem::instance = nullptr;
+
+JobSystem* JobSystem::getInstance()
+{
+    if (!instance)
+    {
+        instance = new JobSystem();
+    }
+
+    return instance;
+}
+
+JobSystem::JobSystem()
+{
+    this->running = false;
+    this->pendingJobs = 0;
+    this->sleepingWorkers = 0;
+    this->parkedCount = 0;
+    this->readyCount = 0;
+}
+
+JobSystem::JobQueue::JobQueue()
+{
+    this->top = 0;
+    this->bottom = 0;
+    for (size_t i = 0; i < QUEUE_CAPACITY; i++)
+        this->buffer[i] = nullptr;
+}
+
+bool JobSystem::JobQueue::push(Job* job)
+{
+    int64_t b = this->bottom.load(std::memory_order_relaxed);
+    int64_t t = this->top.load(std::memory_order_acquire);
+    if (b - t >= (int64_t)QUEUE_CAPACITY)
+        return false;
+
+    // Releasing bottom publishes the job's fields to the thief that acquires it
+    this->buffer[b & (QUEUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    this->bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+JobSystem::Job* JobSystem::JobQueue::pop()
+{
+    int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+    this->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = this->top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        // Empty, undo the reservation
+        this->bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = this->buffer[b & (QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (t == b)
+    {
+        // Last job, race the thieves for it
+        if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        this->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+JobSystem::Job* JobSystem::JobQueue::steal()
+{
+    int64_t t = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = this->bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return nullptr;
+
+    Job* job = this->buffer[t & (QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return job;
+}
+
+void JobSystem::start(int workerCount)
+{
+    if (this->running)
+        return;
+
+    // Keep one worker even on a single core, background work only ever runs on workers.
+    // An explicit 0 runs everything on the calling thread.
+    if (workerCount < 0)
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        workerCount = std::max(1, (int)cores - 1);
+    }
+
+    // Thread 0 is the caller, then the workers, then the slots attachThread hands out
+    this->threads.clear();
+    for (int i = 0; i <= workerCount + MAX_ATTACHED_THREADS; i++)
+    {
+        std::unique_ptr<ThreadData> thread(new ThreadData());
+        thread->ring.reset(new Job[QUEUE_CAPACITY]);
+        thread->stealSeed = 2654435761u * (uint32_t)(i + 1);
+        this->threads.push_back(std::move(thread));
+    }
+
+    currentThread = 0;
+    this->pendingJobs = 0;
+    this->running = true;
+    for (int i = 1; i <= workerCount; i++)
+        this->workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+void JobSystem::stop()
+{
+    if (!this->running)
+        return;
+
+    // Help with what is queued, background jobs are left to the workers. Parked jobs are queued
+    // again once their dependency is done.
+    while (this->pendingJobs.load() > 0 || this->parkedCount.load() > 0)
+    {
+        Job* job = currentThread >= 0 ? findJob(currentThread, false) : nullptr;
+        if (job)
+            execute(currentThread, job);
+        else
+            std::this_thread::yield();
+    }
+
+    this->running = false;
+    {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+    }
+    this->wake.notify_all();
+
+    for (std::thread& worker : this->workers)
+        worker.join();
+    this->workers.clear();
+    this->threads.clear();
+    currentThread = -1;
+}
+
+bool JobSystem::attachThread()
+{
+    if (!this->running || currentThread >= 0)
+        return false;
+
+    for (size_t i = this->workers.size() + 1; i < this->threads.size(); i++)
+    {
+        if (!this->threads[i]->attached.exchange(true))
+        {
+            currentThread = (int)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::detachThread()
+{
+    if (currentThread <= (int)this->workers.size())
+        return;
+
+    this->threads[currentThread]->attached = false;
+    currentThread = -1;
+}
+
+void JobSystem::workerLoop(int index)
+{
+    currentThread = index;
+
+    int idle = 0;
+    while (this->running)
+    {
+        Job* job = findJob(index, true);
+        if (job)
+        {
+            execute(index, job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < IDLE_SPINS)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // pendingJobs and sleepingWorkers are both sequentially consistent, a push either sees
+        // this worker sleeping and wakes it or happened early enough for the predicate to see it
+        std::unique_lock<std::mutex> lock(this->sleepMutex);
+        this->sleepingWorkers++;
+        this->wake.wait(lock, [this] { return !this->running || this->pendingJobs.load() > 0; });
+        this->sleepingWorkers--;
+        idle = 0;
+    }
+}
+
+JobSystem::Job* JobSystem::allocate(int index)
+{
+    ThreadData& thread = *this->threads[index];
+    Job* job = &thread.ring[thread.ringCursor & (QUEUE_CAPACITY - 1)];
+
+    // The job from QUEUE_CAPACITY allocations ago is still queued, parked or running. The cursor
+    // stays so the slot is tried again next time, jobs tend to finish in the order queued.
+    if (job->busy.load(std::memory_order_acquire))
+    {
+        job = new Job();
+        job->heap = true;
+        return job;
+    }
+
+    thread.ringCursor++;
+    job->busy.store(true, std::memory_order_relaxed);
+    job->range = nullptr;
+    job->counter = nullptr;
+    job->dependency = nullptr;
+    return job;
+}
+
+void JobSystem::push(int index, Job* job)
+{
+    // A full queue means the thread is far ahead of the workers, doing the job now is the best use of it
+    if (!this->threads[index]->queue.push(job))
+    {
+        execute(index, job);
+        return;
+    }
+
+    this->pendingJobs++;
+    wakeWorkers(1);
+}
+
+void JobSystem::wakeWorkers(int count)
+{
+    if (this->sleepingWorkers.load() == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+    }
+    if (count == 1)
+        this->wake.notify_one();
+    else
+        this->wake.notify_all();
+}
+
+JobSystem::Job* JobSystem::findJob(int index, bool background)
+{
+    Job* job = this->threads[index]->queue.pop();
+
+    if (!job)
+    {
+        // Start at a random victim so thieves spread out
+        ThreadData& thread = *this->threads[index];
+        thread.stealSeed = thread.stealSeed * 1664525u + 1013904223u;
+        size_t count = this->threads.size();
+        size_t first = (thread.stealSeed >> 8) % count;
+        for (size_t i = 0; i < count && !job; i++)
+        {
+            size_t victim = (first + i) % count;
+            if (victim != (size_t)index)
+                job = this->threads[victim]->queue.steal();
+        }
+    }
+
+    if (!job && this->readyCount.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(this->parkedMutex);
+        if (!this->readyJobs.empty())
+        {
+            job = this->readyJobs.front();
+            this->readyJobs.pop_front();
+            this->readyCount--;
+        }
+    }
+
+    if (!job && background)
+    {
+        std::lock_guard<std::mutex> lock(this->backgroundMutex);
+        if (!this->backgroundJobs.empty())
+        {
+            job = this->backgroundJobs.front().release();
+            this->backgroundJobs.pop_front();
+        }
+    }
+
+    if (job)
+        this->pendingJobs--;
+    return job;
+}
+
+void JobSystem::execute(int index, Job* job)
+{
+    // Not ready yet, the job that finishes the dependency queues it again
+    if (job->dependency && job->dependency->load(std::memory_order_acquire) > 0 && park(job))
+        return;
+
+    if (job->range)
+        (*job->range)(job->begin, job->end);
+    else
+        job->task();
+
+    Counter* counter = job->counter;
+    if (job->heap)
+        delete job;
+    else
+    {
+        job->task = nullptr; // Releases captures now rather than when the ring slot is reused
+        job->busy.store(false, std::memory_order_release);
+    }
+
+    if (counter)
+        finish(counter);
+}
+
+bool JobSystem::park(Job* job)
+{
+    std::lock_guard<std::mutex> lock(this->parkedMutex);
+
+    // Counted before the dependency is checked again: a thread taking it to zero either sees
+    // the count and releases the job, or the check sees zero and the job runs now
+    this->parkedCount++;
+    if (job->dependency->load() == 0)
+    {
+        this->parkedCount--;
+        return false;
+    }
+    this->parkedJobs.push_back(job);
+    return true;
+}
+
+void JobSystem::finish(Counter* counter)
+{
+    if (counter->fetch_sub(1) != 1 || this->parkedCount.load() == 0)
+        return;
+
+    // Any thread can take a counter to zero, so released jobs go to a shared list rather than a queue
+    int released = 0;
+    {
+        std::lock_guard<std::mutex> lock(this->parkedMutex);
+        for (size_t i = 0; i < this->parkedJobs.size();)
+        {
+            if (this->parkedJobs[i]->dependency == counter)
+            {
+                this->readyJobs.push_back(this->parkedJobs[i]);
+                this->parkedJobs[i] = this->parkedJobs.back();
+                this->parkedJobs.pop_back();
+                released++;
+            }
+            else
+                i++;
+        }
+        this->readyCount += released;
+        this->pendingJobs += released;
+        this->parkedCount -= released;
+    }
+
+    if (released > 0)
+        wakeWorkers(released);
+}
+
+void JobSystem::run(std::function<void()> task, Counter* counter, const Counter* dependency)
+{
+    if (counter)
+        counter->fetch_add(1);
+
+    // Unknown threads have no queue, they run their own jobs
+    int index = currentThread;
+    if (index < 0 || !this->running)
+    {
+        if (dependency)
+            wait(*dependency);
+        task();
+        if (counter)
+            finish(counter);
+        return;
+    }
+
+    Job* job = allocate(index);
+    job->task = std::move(task);
+    job->counter = counter;
+    job->dependency = dependency;
+    push(index, job);
+}
+
+void JobSystem::runBackground(std::function<void()> task, Counter* counter)
+{
+    if (counter)
+        counter->fetch_add(1);
+
+    if (this->workers.empty())
+    {
+        task();
+        if (counter)
+            finish(counter);
+        return;
+    }
+
+    std::unique_ptr<Job> job(new Job());
+    job->task = std::move(task);
+    job->counter = counter;
+    job->heap = true;
+    {
+        std::lock_guard<std::mutex> lock(this->backgroundMutex);
+        this->backgroundJobs.push_back(std::move(job));
+    }
+
+    this->pendingJobs++;
+    wakeWorkers(1);
+}
+
+void JobSystem::wait(const Counter& counter)
+{
+    // Waiting threads only help with regular jobs, a background job could take far longer than the wait
+    int index = currentThread;
+    while (counter.load(std::memory_order_acquire) > 0)
+    {
+        Job* job = index >= 0 ? findJob(index, false) : nullptr;
+        if (job)
+            execute(index, job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const RangeFunction& body)
+{
+    if (count == 0)
+        return;
+
+    size_t threadCount = (size_t)getThreadCount();
+    if (grain == 0)
+        grain = std::max((size_t)1, count / (std::max((size_t)1, threadCount) * RANGES_PER_THREAD));
+
+    // Keep well inside the job ring, jobs queued before this call may still be waiting
+    size_t ranges = (count + grain - 1) / grain;
+    if (ranges > QUEUE_CAPACITY / 4)
+    {
+        grain = (count + QUEUE_CAPACITY / 4 - 1) / (QUEUE_CAPACITY / 4);
+        ranges = (count + grain - 1) / grain;
+    }
+
+    int index = currentThread;
+    if (index < 0 || !this->running || ranges == 1 || threadCount == 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    // Queue all but the first range, run that one here and then help with the rest
+    Counter counter(0);
+    for (size_t r = 1; r < ranges; r++)
+    {
+        Job* job = allocate(index);
+        job->range = &body;
+        job->begin = r * grain;
+        job->end = std::min(count, job->begin + grain);
+        job->counter = &counter;
+        counter.fetch_add(1);
+        push(index, job);
+    }
+
+    body(0, std::min(count, grain));
+    wait(counter);
+}
@@ -0,0 +1,278 @@
+#include "Lighting/LightClusterGrid.h"
+#include "Lighting/PointLight.h"
+#include "Camera/Camera.h"
+#include "shaders/ShaderProgram.h"
+#include "Jobs/JobSystem.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+enum ClusterBuffer
+{
+    LIGHT_DATA_BUFFER,
+    CLUSTER_GRID_BUFFER,
+    LIGHT_INDEX_BUFFER
+};
+
+// Below this many lights queueing jobs costs more than it saves
+static const int PARALLEL_LIGHT_THRESHOLD = 64;
+
+LightClusterGrid::LightClusterGrid()
+{
+    this->clustered = true;
+    this->lightCount = 0;
+
+    this->sliceScale = 0.f;
+    this->sliceBias = 0.f;
+    this->tileWidth = 1.f;
+    this->tileHeight = 1.f;
+
+    for (int i = 0; i < 3; i++)
+    {
+        this->bufferHandles[i] = 0;
+        this->textureHandles[i] = 0;
+        this->bufferCapacity[i] = 0;
+    }
+
+    this->grid.resize(CLUSTER_COUNT * 2, 0);
+    this->sliceCounts.resize(CLUSTER_COUNT, 0);
+}
+
+LightClusterGrid::~LightClusterGrid()
+{
+    release();
+}
+
+bool LightClusterGrid::init()
+{
+    static const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+
+    glGenBuffers(3, this->bufferHandles);
+    glGenTextures(3, this->textureHandles);
+    for (int i = 0; i < 3; i++)
+    {
+        // Texture buffers can't be empty, start with one texel worth of storage
+        this->bufferCapacity[i] = 16;
+        glBindBuffer(GL_TEXTURE_BUFFER, this->bufferHandles[i]);
+        glBufferData(GL_TEXTURE_BUFFER, this->bufferCapacity[i], nullptr, GL_STREAM_DRAW);
+
+        glBindTexture(GL_TEXTURE_BUFFER, this->textureHandles[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], this->bufferHandles[i]);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cout << "GL Error after creating light cluster buffers" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void LightClusterGrid::release()
+{
+    if (this->bufferHandles[0] != 0)
+    {
+        glDeleteTextures(3, this->textureHandles);
+        glDeleteBuffers(3, this->bufferHandles);
+        for (int i = 0; i < 3; i++)
+        {
+            this->bufferHandles[i] = 0;
+            this->textureHandles[i] = 0;
+        }
+    }
+}
+
+void LightClusterGrid::update(Camera* cam, const std::vector<PointLight*>& lights, int viewportWidth, int viewportHeight)
+{
+    this->lightCount = (int)lights.size();
+
+    // Two RGBA32F texels per light: position + radius, color
+    this->lightData.resize(lights.size() * 8);
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        float* texels = &this->lightData[i * 8];
+        texels[0] = lights[i]->getX();
+        texels[1] = lights[i]->getY();
+        texels[2] = lights[i]->getZ();
+        texels[3] = lights[i]->getRadius();
+        texels[4] = lights[i]->getRed();
+        texels[5] = lights[i]->getGreen();
+        texels[6] = lights[i]->getBlue();
+        texels[7] = 1.f;
+    }
+    upload(LIGHT_DATA_BUFFER, this->lightData.data(), this->lightData.size() * sizeof(float));
+
+    if (this->clustered)
+    {
+        float nearClip = cam->getNearClip();
+        float farClip = cam->getFarClip();
+        float logDepthRange = std::log(farClip / nearClip);
+        this->sliceScale = GRID_Z / logDepthRange;
+        this->sliceBias = -GRID_Z * std::log(nearClip) / logDepthRange;
+        this->tileWidth = (float)viewportWidth / GRID_X;
+        this->tileHeight = (float)viewportHeight / GRID_Y;
+
+        computeRanges(cam, lights);
+
+        // Depth slices share no output, each job takes one
+        if (this->lightCount >= PARALLEL_LIGHT_THRESHOLD)
+            JobSystem::getInstance()->parallelFor(GRID_Z, 1, [this](size_t first, size_t last) { assignSlices((int)first, (int)last); });
+        else
+            assignSlices(0, GRID_Z);
+
+        mergeSlices();
+
+        upload(CLUSTER_GRID_BUFFER, this->grid.data(), this->grid.size() * sizeof(uint32_t));
+        upload(LIGHT_INDEX_BUFFER, this->indices.data(), this->indices.size() * sizeof(uint32_t));
+    }
+
+    glActiveTexture(GL_TEXTURE0 + ShaderProgram::LIGHT_DATA_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, this->textureHandles[LIGHT_DATA_BUFFER]);
+    glActiveTexture(GL_TEXTURE0 + ShaderProgram::CLUSTER_GRID_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, this->textureHandles[CLUSTER_GRID_BUFFER]);
+    glActiveTexture(GL_TEXTURE0 + ShaderProgram::LIGHT_INDEX_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, this->textureHandles[LIGHT_INDEX_BUFFER]);
+}
+
+void LightClusterGrid::computeRanges(Camera* cam, const std::vector<PointLight*>& lights)
+{
+    glm::mat4 view = cam->getView();
+    glm::mat4 projection = cam->getProjection();
+    float nearClip = cam->getNearClip();
+    float farClip = cam->getFarClip();
+
+    this->ranges.resize(lights.size());
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        LightRange& range = this->ranges[i];
+        float radius = lights[i]->getRadius();
+        glm::vec4 center = view * glm::vec4(lights[i]->getX(), lights[i]->getY(), lights[i]->getZ(), 1.f);
+
+        // View space looks down -z, work with positive depths
+        float minDepth = std::max(-center.z - radius, nearClip);
+        float maxDepth = std::min(-center.z + radius, farClip);
+        if (minDepth > maxDepth)
+        {
+            range.minZ = 1;
+            range.maxZ = 0;
+            continue;
+        }
+
+        range.minZ = std::max(0, std::min(GRID_Z - 1, (int)(std::log(minDepth) * this->sliceScale + this->sliceBias)));
+        range.maxZ = std::max(0, std::min(GRID_Z - 1, (int)(std::log(maxDepth) * this->sliceScale + this->sliceBias)));
+
+        // Conservative screen bounds of the sphere's view space box: each edge projects
+        // furthest out at the nearest depth when it lies on the outer side of the axis
+        float minX = center.x - radius;
+        float maxX = center.x + radius;
+        float minY = center.y - radius;
+        float maxY = center.y + radius;
+        float ndcMinX = projection[0][0] * minX / (minX < 0.f ? minDepth : maxDepth);
+        float ndcMaxX = projection[0][0] * maxX / (maxX > 0.f ? minDepth : maxDepth);
+        float ndcMinY = projection[1][1] * minY / (minY < 0.f ? minDepth : maxDepth);
+        float ndcMaxY = projection[1][1] * maxY / (maxY > 0.f ? minDepth : maxDepth);
+
+        range.minX = std::max(0, (int)std::floor((ndcMinX * 0.5f + 0.5f) * GRID_X));
+        range.maxX = std::min(GRID_X - 1, (int)std::floor((ndcMaxX * 0.5f + 0.5f) * GRID_X));
+        range.minY = std::max(0, (int)std::floor((ndcMinY * 0.5f + 0.5f) * GRID_Y));
+        range.maxY = std::min(GRID_Y - 1, (int)std::floor((ndcMaxY * 0.5f + 0.5f) * GRID_Y));
+    }
+}
+
+void LightClusterGrid::assignSlices(int firstSlice, int lastSlice)
+{
+    const int tilesPerSlice = GRID_X * GRID_Y;
+
+    for (int z = firstSlice; z < lastSlice; z++)
+    {
+        std::vector<uint32_t>& lightsInSlice = this->sliceLights[z];
+        lightsInSlice.clear();
+        for (size_t i = 0; i < this->ranges.size(); i++)
+        {
+            const LightRange& range = this->ranges[i];
+            if (range.minZ <= z && z <= range.maxZ && range.minX <= range.maxX && range.minY <= range.maxY)
+                lightsInSlice.push_back((uint32_t)i);
+        }
+
+        // Count, prefix sum into local offsets, then fill
+        uint32_t* counts = &this->sliceCounts[z * tilesPerSlice];
+        uint32_t* offsets = &this->grid[z * tilesPerSlice * 2];
+        std::memset(counts, 0, tilesPerSlice * sizeof(uint32_t));
+
+        for (uint32_t light : lightsInSlice)
+        {
+            const LightRange& range = this->ranges[light];
+            for (int y = range.minY; y <= range.maxY; y++)
+                for (int x = range.minX; x <= range.maxX; x++)
+                    counts[y * GRID_X + x]++;
+        }
+
+        uint32_t total = 0;
+        for (int tile = 0; tile < tilesPerSlice; tile++)
+        {
+            offsets[tile * 2] = total;
+            offsets[tile * 2 + 1] = counts[tile];
+            total += counts[tile];
+            counts[tile] = offsets[tile * 2];
+        }
+
+        std::vector<uint32_t>& sliceList = this->sliceIndices[z];
+        sliceList.resize(total);
+        for (uint32_t light : lightsInSlice)
+        {
+            const LightRange& range = this->ranges[light];
+            for (int y = range.minY; y <= range.maxY; y++)
+                for (int x = range.minX; x <= range.maxX; x++)
+                    sliceList[counts[y * GRID_X + x]++] = light;
+        }
+    }
+}
+
+void LightClusterGrid::mergeSlices()
+{
+    const int tilesPerSlice = GRID_X * GRID_Y;
+
+    size_t total = 0;
+    for (int z = 0; z < GRID_Z; z++)
+        total += this->sliceIndices[z].size();
+    this->indices.resize(std::max<size_t>(total, 1));
+
+    // Slice offsets were local, rebase them onto the flattened index list
+    uint32_t base = 0;
+    for (int z = 0; z < GRID_Z; z++)
+    {
+        uint32_t* offsets = &this->grid[z * tilesPerSlice * 2];
+        for (int tile = 0; tile < tilesPerSlice; tile++)
+            offsets[tile * 2] += base;
+
+        const std::vector<uint32_t>& sliceList = this->sliceIndices[z];
+        if (!sliceList.empty())
+            std::memcpy(&this->indices[base], sliceList.data(), sliceList.size() * sizeof(uint32_t));
+        base += (uint32_t)sliceList.size();
+    }
+}
+
+void LightClusterGrid::upload(int buffer, const void* data, size_t bytes)
+{
+    if (bytes == 0)
+        return;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, this->bufferHandles[buffer]);
+    if (bytes > this->bufferCapacity[buffer])
+    {
+        // Grow geometrically so light count changes don't reallocate every frame
+        this->bufferCapacity[buffer] = std::max(bytes, this->bufferCapacity[buffer] * 2);
+    }
+
+    // Orphan last frame's storage, it may still be read by the GPU
+    glBufferData(GL_TEXTURE_BUFFER, this->bufferCapacity[buffer], nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
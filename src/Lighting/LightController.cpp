@@ -0,0 +1,43 @@
+#include "Lighting/LightController.h"
+#include "Lighting/PointLight.h"
+
+#include <algorithm>
+
+LightController* LightController::instance = nullptr;
+
+LightController::LightController()
+{
+}
+
+LightController* LightController::getInstance()
+{
+    if (!instance)
+    {
+        instance = new LightController();
+    }
+
+    return instance;
+}
+
+void LightController::addLight(PointLight* light)
+{
+    if (light)
+        this->lights.push_back(light);
+}
+
+void LightController::removeLight(PointLight* light)
+{
+    auto it = std::find(this->lights.begin(), this->lights.end(), light);
+    if (it != this->lights.end())
+    {
+        delete *it;
+        this->lights.erase(it);
+    }
+}
+
+void LightController::clear()
+{
+    for (PointLight* light : this->lights)
+        delete light;
+    this->lights.clear();
+}
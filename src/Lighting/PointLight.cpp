@@ -2,12 +2,23 @@
 
 PointLight::PointLight()
 {
+    setLocation(0.f, 0.f, 0.f);
+    setColor(1.f, 1.f, 1.f);
+    setRadius(10.f);
 }
 
 PointLight::PointLight(float x, float y, float z, float r, float g, float b)
 {
     setLocation(x, y, z);
     setColor(r, g, b);
+    setRadius(10.f);
+}
+
+PointLight::PointLight(float x, float y, float z, float r, float g, float b, float radius)
+{
+    setLocation(x, y, z);
+    setColor(r, g, b);
+    setRadius(radius);
 }
 
 void PointLight::setLocation(float x, float y, float z)
@@ -22,4 +33,9 @@ void PointLight::setColor(float r, float g, float b)
     this->r = r;
     this->g = g;
     this->b = b;
+}
+
+void PointLight::setRadius(float radius)
+{
+    this->radius = radius;
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "Meshes/CookedMesh.h"
+#include "Meshes/MeshData.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+static uint64_t align16(uint64_t offset)
+{
+    return (offset + 15) & ~(uint64_t)15;
+}
+
+bool CookedMesh::open(const std::string& path)
+{
+    close();
+    if (!this->file.open(path) || this->file.getSize() < sizeof(CookedMeshHeader))
+        return false;
+
+    const CookedMeshHeader* header = (const CookedMeshHeader*)this->file.getData();
+    uint64_t size = this->file.getSize();
+    bool valid = std::memcmp(header->magic, "OMSH", 4) == 0 && header->version == VERSION
+        && header->lodCount > 0 && sizeof(CookedMeshHeader) + header->lodCount * sizeof(CookedMeshLod) <= header->vertexOffset
+        && header->vertexOffset + header->vertexCount * 5 * sizeof(float) <= size
+        && header->tangentOffset + header->vertexCount * 6 * sizeof(float) <= size
+        && header->indexOffset + header->indexCount * sizeof(unsigned int) <= size;
+    if (valid)
+    {
+        const CookedMeshLod* lods = (const CookedMeshLod*)(this->file.getData() + sizeof(CookedMeshHeader));
+        for (uint32_t i = 0; i < header->lodCount; i++)
+            valid &= (uint64_t)lods[i].firstIndex + lods[i].indexCount <= header->indexCount;
+    }
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+
+    this->header = header;
+    return true;
+}
+
+void CookedMesh::close()
+{
+    this->file.close();
+    this->header = nullptr;
+}
+
+bool CookedMesh::write(const std::string& path, const MeshData& mesh)
+{
+    // A mesh without a chain is its own single level
+    std::vector<CookedMeshLod> lods;
+    for (const MeshLod& lod : mesh.lods)
+        lods.push_back({ (uint32_t)lod.firstIndex, (uint32_t)lod.indexCount, lod.error, 0 });
+    if (lods.empty())
+        lods.push_back({ 0, (uint32_t)mesh.indices.size(), 0.f, 0 });
+
+    CookedMeshHeader header = {};
+    std::memcpy(header.magic, "OMSH", 4);
+    header.version = VERSION;
+    header.vertexCount = mesh.getVertexCount();
+    header.indexCount = mesh.indices.size();
+    header.lodCount = (uint32_t)lods.size();
+    header.vertexOffset = align16(sizeof(CookedMeshHeader) + lods.size() * sizeof(CookedMeshLod));
+    header.tangentOffset = align16(header.vertexOffset + mesh.vertices.size() * sizeof(float));
+    header.indexOffset = align16(header.tangentOffset + mesh.tangents.size() * sizeof(float));
+    for (int i = 0; i < 3; i++)
+    {
+        header.boundsMin[i] = mesh.boundsMin[i];
+        header.boundsMax[i] = mesh.boundsMax[i];
+    }
+
+    // Write beside the destination and rename, a concurrent load never maps a half written file
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        static const char padding[16] = {};
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)lods.data(), lods.size() * sizeof(CookedMeshLod));
+        out.write(padding, header.vertexOffset - (uint64_t)out.tellp());
+        out.write((const char*)mesh.vertices.data(), mesh.vertices.size() * sizeof(float));
+        out.write(padding, header.tangentOffset - (uint64_t)out.tellp());
+        out.write((const char*)mesh.tangents.data(), mesh.tangents.size() * sizeof(float));
+        out.write(padding, header.indexOffset - (uint64_t)out.tellp());
+        out.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+        if (!out)
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
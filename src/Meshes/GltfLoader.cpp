@@ -0,0 +1,634 @@
+#include "Meshes/GltfLoader.h"
+#include "Meshes/MeshData.h"
+#include "Textures/MappedFile.h"
+#include "Jobs/JobSystem.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+// Just enough JSON for glTF documents, numbers are kept as doubles
+struct JsonValue
+{
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type type = NUL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* find(const char* key) const
+    {
+        for (const auto& member : this->members)
+        {
+            if (member.first == key)
+                return &member.second;
+        }
+        return nullptr;
+    }
+
+    double getNumber(const char* key, double fallback) const
+    {
+        const JsonValue* value = find(key);
+        return value && value->type == NUMBER ? value->number : fallback;
+    }
+
+    const JsonValue& operator[](size_t index) const { return this->array[index]; }
+    size_t size() const { return this->array.size(); }
+};
+
+class JsonParser
+{
+public:
+    JsonParser(const char* begin, const char* end) : p(begin), end(end) {}
+
+    bool parse(JsonValue& value)
+    {
+        return parseValue(value, 0) && (skipWhitespace(), this->p == this->end);
+    }
+
+private:
+    const char* p;
+    const char* end;
+
+    void skipWhitespace()
+    {
+        while (this->p < this->end && (*this->p == ' ' || *this->p == '\t' || *this->p == '\n' || *this->p == '\r'))
+            this->p++;
+    }
+
+    bool match(const char* literal)
+    {
+        size_t length = std::strlen(literal);
+        if ((size_t)(this->end - this->p) < length || std::memcmp(this->p, literal, length) != 0)
+            return false;
+        this->p += length;
+        return true;
+    }
+
+    bool parseString(std::string& out)
+    {
+        if (this->p >= this->end || *this->p != '"')
+            return false;
+        this->p++;
+
+        while (this->p < this->end && *this->p != '"')
+        {
+            char c = *this->p++;
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+            if (this->p >= this->end)
+                return false;
+
+            char escaped = *this->p++;
+            switch (escaped)
+            {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u':
+            {
+                // Keys and URIs glTF cares about are ASCII, anything wider is kept as UTF-8 of the BMP code point
+                if (this->end - this->p < 4)
+                    return false;
+                unsigned int code = (unsigned int)std::strtoul(std::string(this->p, 4).c_str(), nullptr, 16);
+                this->p += 4;
+                if (code < 0x80)
+                    out += (char)code;
+                else if (code < 0x800)
+                {
+                    out += (char)(0xC0 | (code >> 6));
+                    out += (char)(0x80 | (code & 0x3F));
+                }
+                else
+                {
+                    out += (char)(0xE0 | (code >> 12));
+                    out += (char)(0x80 | ((code >> 6) & 0x3F));
+                    out += (char)(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: out += escaped; break;
+            }
+        }
+
+        if (this->p >= this->end)
+            return false;
+        this->p++;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth)
+    {
+        skipWhitespace();
+        if (this->p >= this->end || depth > 64)
+            return false;
+
+        char c = *this->p;
+        if (c == '{')
+        {
+            value.type = JsonValue::OBJECT;
+            this->p++;
+            skipWhitespace();
+            if (this->p < this->end && *this->p == '}')
+                return ++this->p, true;
+
+            while (true)
+            {
+                std::pair<std::string, JsonValue> member;
+                skipWhitespace();
+                if (!parseString(member.first))
+                    return false;
+                skipWhitespace();
+                if (this->p >= this->end || *this->p++ != ':')
+                    return false;
+                if (!parseValue(member.second, depth + 1))
+                    return false;
+                value.members.push_back(std::move(member));
+
+                skipWhitespace();
+                if (this->p < this->end && *this->p == ',')
+                    this->p++;
+                else if (this->p < this->end && *this->p == '}')
+                    return ++this->p, true;
+                else
+                    return false;
+            }
+        }
+        if (c == '[')
+        {
+            value.type = JsonValue::ARRAY;
+            this->p++;
+            skipWhitespace();
+            if (this->p < this->end && *this->p == ']')
+                return ++this->p, true;
+
+            while (true)
+            {
+                value.array.emplace_back();
+                if (!parseValue(value.array.back(), depth + 1))
+                    return false;
+
+                skipWhitespace();
+                if (this->p < this->end && *this->p == ',')
+                    this->p++;
+                else if (this->p < this->end && *this->p == ']')
+                    return ++this->p, true;
+                else
+                    return false;
+            }
+        }
+        if (c == '"')
+        {
+            value.type = JsonValue::STRING;
+            return parseString(value.string);
+        }
+        if (match("true"))
+        {
+            value.type = JsonValue::BOOLEAN;
+            value.boolean = true;
+            return true;
+        }
+        if (match("false"))
+        {
+            value.type = JsonValue::BOOLEAN;
+            return true;
+        }
+        if (match("null"))
+            return true;
+
+        // strtod needs a terminated string, numbers are short so copy them out
+        const char* start = this->p;
+        while (this->p < this->end && (std::strchr("+-0123456789.eE", *this->p) != nullptr))
+            this->p++;
+        if (start == this->p)
+            return false;
+        value.type = JsonValue::NUMBER;
+        value.number = std::strtod(std::string(start, this->p).c_str(), nullptr);
+        return true;
+    }
+};
+
+static bool decodeBase64(const char* data, size_t length, std::vector<unsigned char>& out)
+{
+    auto decode = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    };
+
+    out.clear();
+    out.reserve(length * 3 / 4);
+    unsigned int bits = 0;
+    int bitCount = 0;
+    for (size_t i = 0; i < length && data[i] != '='; i++)
+    {
+        int value = decode(data[i]);
+        if (value < 0)
+            return false;
+        bits = (bits << 6) | (unsigned int)value;
+        bitCount += 6;
+        if (bitCount >= 8)
+        {
+            bitCount -= 8;
+            out.push_back((unsigned char)(bits >> bitCount));
+        }
+    }
+    return true;
+}
+
+// A resolved accessor: element i of component c is at data + i * stride + c * componentSize
+struct Accessor
+{
+    const unsigned char* data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    int componentType = 0;
+    int components = 0;
+
+    float readFloat(size_t index, int component) const
+    {
+        float value;
+        std::memcpy(&value, this->data + index * this->stride + component * 4, 4);
+        return value;
+    }
+
+    uint32_t readIndex(size_t index) const
+    {
+        const unsigned char* element = this->data + index * this->stride;
+        switch (this->componentType)
+        {
+        case 5121: return *element;
+        case 5123: { uint16_t value; std::memcpy(&value, element, 2); return value; }
+        default: { uint32_t value; std::memcpy(&value, element, 4); return value; }
+        }
+    }
+};
+
+struct GltfDocument
+{
+    JsonValue json;
+    std::vector<std::vector<unsigned char>> buffers;
+    MappedFile glb;
+};
+
+static int componentCount(const std::string& type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    if (type == "MAT4") return 16;
+    return 0;
+}
+
+static bool resolveAccessor(const GltfDocument& document, int index, Accessor& accessor)
+{
+    const JsonValue* accessors = document.json.find("accessors");
+    const JsonValue* views = document.json.find("bufferViews");
+    if (!accessors || !views || index < 0 || (size_t)index >= accessors->size())
+        return false;
+
+    const JsonValue& description = (*accessors)[index];
+    const JsonValue* type = description.find("type");
+    int viewIndex = (int)description.getNumber("bufferView", -1);
+    if (!type || viewIndex < 0 || (size_t)viewIndex >= views->size() || description.find("sparse"))
+        return false;
+
+    const JsonValue& view = (*views)[viewIndex];
+    int bufferIndex = (int)view.getNumber("buffer", -1);
+    if (bufferIndex < 0 || (size_t)bufferIndex >= document.buffers.size())
+        return false;
+
+    accessor.componentType = (int)description.getNumber("componentType", 0);
+    accessor.components = componentCount(type->string);
+    accessor.count = (size_t)description.getNumber("count", 0);
+    size_t componentSize = accessor.componentType == 5121 || accessor.componentType == 5120 ? 1
+                         : accessor.componentType == 5123 || accessor.componentType == 5122 ? 2 : 4;
+    size_t elementSize = componentSize * accessor.components;
+    accessor.stride = (size_t)view.getNumber("byteStride", 0);
+    if (accessor.stride == 0)
+        accessor.stride = elementSize;
+
+    size_t offset = (size_t)view.getNumber("byteOffset", 0) + (size_t)description.getNumber("byteOffset", 0);
+    const std::vector<unsigned char>& buffer = document.buffers[bufferIndex];
+    if (accessor.components == 0 || (accessor.count > 0 && offset + (accessor.count - 1) * accessor.stride + elementSize > buffer.size()))
+        return false;
+
+    accessor.data = buffer.data() + offset;
+    return true;
+}
+
+static bool loadBuffers(GltfDocument& document, const std::string& directory, const unsigned char* glbBinary, size_t glbBinarySize)
+{
+    const JsonValue* buffers = document.json.find("buffers");
+    if (!buffers)
+        return true;
+
+    document.buffers.resize(buffers->size());
+    for (size_t i = 0; i < buffers->size(); i++)
+    {
+        const JsonValue* uri = (*buffers)[i].find("uri");
+        std::vector<unsigned char>& buffer = document.buffers[i];
+        if (!uri)
+        {
+            // The GLB binary chunk is the first buffer without a URI
+            if (!glbBinary)
+                return false;
+            buffer.assign(glbBinary, glbBinary + glbBinarySize);
+            continue;
+        }
+
+        const std::string& location = uri->string;
+        if (location.compare(0, 5, "data:") == 0)
+        {
+            size_t comma = location.find(";base64,");
+            if (comma == std::string::npos || !decodeBase64(location.data() + comma + 8, location.size() - comma - 8, buffer))
+                return false;
+            continue;
+        }
+
+        std::ifstream file(directory + location, std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+        std::streamsize size = file.tellg();
+        file.seekg(0, std::ios::beg);
+        buffer.resize((size_t)size);
+        if (!file.read((char*)buffer.data(), size))
+            return false;
+    }
+
+    return true;
+}
+
+static glm::mat4 nodeTransform(const JsonValue& node)
+{
+    const JsonValue* matrix = node.find("matrix");
+    if (matrix && matrix->size() == 16)
+    {
+        // Column major, like glm
+        glm::mat4 transform;
+        for (int i = 0; i < 16; i++)
+            transform[i / 4][i % 4] = (float)(*matrix)[i].number;
+        return transform;
+    }
+
+    glm::mat4 transform(1.0f);
+    if (const JsonValue* translation = node.find("translation"))
+        transform = glm::translate(transform, glm::vec3((float)(*translation)[0].number, (float)(*translation)[1].number, (float)(*translation)[2].number));
+    if (const JsonValue* rotation = node.find("rotation"))
+        transform *= glm::mat4_cast(glm::quat((float)(*rotation)[3].number, (float)(*rotation)[0].number, (float)(*rotation)[1].number, (float)(*rotation)[2].number));
+    if (const JsonValue* scale = node.find("scale"))
+        transform = glm::scale(transform, glm::vec3((float)(*scale)[0].number, (float)(*scale)[1].number, (float)(*scale)[2].number));
+    return transform;
+}
+
+struct PrimitiveInstance
+{
+    const JsonValue* primitive;
+    glm::mat4 transform;
+};
+
+static void collectPrimitives(const GltfDocument& document, int nodeIndex, const glm::mat4& parent, std::vector<PrimitiveInstance>& out, int depth)
+{
+    const JsonValue* nodes = document.json.find("nodes");
+    if (!nodes || nodeIndex < 0 || (size_t)nodeIndex >= nodes->size() || depth > 64)
+        return;
+
+    const JsonValue& node = (*nodes)[nodeIndex];
+    glm::mat4 transform = parent * nodeTransform(node);
+
+    const JsonValue* meshes = document.json.find("meshes");
+    int meshIndex = (int)node.getNumber("mesh", -1);
+    if (meshes && meshIndex >= 0 && (size_t)meshIndex < meshes->size())
+    {
+        if (const JsonValue* primitives = (*meshes)[meshIndex].find("primitives"))
+        {
+            for (const JsonValue& primitive : primitives->array)
+                out.push_back({ &primitive, transform });
+        }
+    }
+
+    if (const JsonValue* children = node.find("children"))
+    {
+        for (const JsonValue& child : children->array)
+            collectPrimitives(document, (int)child.number, transform, out, depth + 1);
+    }
+}
+
+static bool convertPrimitive(const GltfDocument& document, const PrimitiveInstance& instance, MeshData& mesh)
+{
+    const JsonValue& primitive = *instance.primitive;
+    const JsonValue* attributes = primitive.find("attributes");
+    // Only triangle lists, mode defaults to 4
+    if (!attributes || primitive.getNumber("mode", 4) != 4)
+        return true;
+
+    Accessor positions, uvs, normals, tangents, indices;
+    const JsonValue* position = attributes->find("POSITION");
+    if (!position || !resolveAccessor(document, (int)position->number, positions) || positions.componentType != 5126 || positions.components != 3)
+        return false;
+
+    const JsonValue* uv = attributes->find("TEXCOORD_0");
+    bool hasUvs = uv && resolveAccessor(document, (int)uv->number, uvs) && uvs.componentType == 5126 && uvs.count == positions.count;
+    const JsonValue* normal = attributes->find("NORMAL");
+    bool hasNormals = normal && resolveAccessor(document, (int)normal->number, normals) && normals.componentType == 5126 && normals.count == positions.count;
+    const JsonValue* tangent = attributes->find("TANGENT");
+    bool hasTangents = hasNormals && tangent && resolveAccessor(document, (int)tangent->number, tangents) && tangents.componentType == 5126 && tangents.count == positions.count;
+
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(instance.transform)));
+    size_t count = positions.count;
+    mesh.vertices.resize(count * 5);
+    std::vector<glm::vec3> vertexNormals(hasNormals ? count : 0);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 p = glm::vec3(instance.transform * glm::vec4(positions.readFloat(i, 0), positions.readFloat(i, 1), positions.readFloat(i, 2), 1.f));
+        float* out = &mesh.vertices[i * 5];
+        out[0] = p.x;
+        out[1] = p.y;
+        out[2] = p.z;
+        // glTF puts the UV origin top left, textures are flipped on load to OpenGL's bottom left
+        out[3] = hasUvs ? uvs.readFloat(i, 0) : 0.f;
+        out[4] = hasUvs ? 1.f - uvs.readFloat(i, 1) : 0.f;
+
+        if (hasNormals)
+            vertexNormals[i] = glm::normalize(normalMatrix * glm::vec3(normals.readFloat(i, 0), normals.readFloat(i, 1), normals.readFloat(i, 2)));
+    }
+
+    int indexAccessor = (int)primitive.getNumber("indices", -1);
+    if (indexAccessor >= 0)
+    {
+        if (!resolveAccessor(document, indexAccessor, indices) || indices.components != 1)
+            return false;
+        mesh.indices.resize(indices.count);
+        for (size_t i = 0; i < indices.count; i++)
+        {
+            mesh.indices[i] = indices.readIndex(i);
+            if (mesh.indices[i] >= count)
+                return false;
+        }
+    }
+    else
+    {
+        mesh.indices.resize(count);
+        for (size_t i = 0; i < count; i++)
+            mesh.indices[i] = (unsigned int)i;
+    }
+    mesh.indices.resize(mesh.indices.size() / 3 * 3);
+
+    // Mirrored transforms flip the winding
+    if (glm::determinant(glm::mat3(instance.transform)) < 0.f)
+    {
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+            std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+    }
+
+    if (!hasTangents)
+    {
+        mesh.generateTangents(hasNormals ? &vertexNormals : nullptr);
+        return true;
+    }
+
+    mesh.tangents.resize(count * 6);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 t = glm::mat3(instance.transform) * glm::vec3(tangents.readFloat(i, 0), tangents.readFloat(i, 1), tangents.readFloat(i, 2));
+        t = glm::normalize(t - vertexNormals[i] * glm::dot(vertexNormals[i], t));
+        // The vertex shader rebuilds the normal as cross(tangent, bitangent)
+        glm::vec3 b = glm::cross(vertexNormals[i], t);
+        float* out = &mesh.tangents[i * 6];
+        out[0] = t.x; out[1] = t.y; out[2] = t.z;
+        out[3] = b.x; out[4] = b.y; out[5] = b.z;
+    }
+    return true;
+}
+
+static bool readDocument(const std::string& path, GltfDocument& document)
+{
+    std::string directory;
+    size_t slash = path.find_last_of("/\\");
+    if (slash != std::string::npos)
+        directory = path.substr(0, slash + 1);
+
+    if (!document.glb.open(path))
+        return false;
+
+    const unsigned char* data = document.glb.getData();
+    size_t size = document.glb.getSize();
+    const char* jsonBegin = (const char*)data;
+    const char* jsonEnd = (const char*)data + size;
+    const unsigned char* binary = nullptr;
+    size_t binarySize = 0;
+
+    // GLB: 12 byte header, then a JSON chunk and an optional BIN chunk
+    if (size >= 20 && std::memcmp(data, "glTF", 4) == 0)
+    {
+        uint32_t jsonLength, jsonType;
+        std::memcpy(&jsonLength, data + 12, 4);
+        std::memcpy(&jsonType, data + 16, 4);
+        if (jsonType != 0x4E4F534A || 20 + (size_t)jsonLength > size)
+            return false;
+        jsonBegin = (const char*)data + 20;
+        jsonEnd = jsonBegin + jsonLength;
+
+        size_t binaryHeader = 20 + (size_t)jsonLength;
+        if (binaryHeader + 8 <= size)
+        {
+            uint32_t binaryLength, binaryType;
+            std::memcpy(&binaryLength, data + binaryHeader, 4);
+            std::memcpy(&binaryType, data + binaryHeader + 4, 4);
+            if (binaryType == 0x004E4942 && binaryHeader + 8 + binaryLength <= size)
+            {
+                binary = data + binaryHeader + 8;
+                binarySize = binaryLength;
+            }
+        }
+    }
+
+    // GLB JSON chunks may be padded with spaces, which the parser skips
+    JsonParser parser(jsonBegin, jsonEnd);
+    if (!parser.parse(document.json) || document.json.type != JsonValue::OBJECT)
+        return false;
+
+    return loadBuffers(document, directory, binary, binarySize);
+}
+
+bool GltfLoader::load(const std::string& path, MeshData& mesh)
+{
+    GltfDocument document;
+    if (!readDocument(path, document))
+    {
+        std::cout << "Failed to read glTF: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<PrimitiveInstance> instances;
+    const JsonValue* scenes = document.json.find("scenes");
+    int sceneIndex = (int)document.json.getNumber("scene", 0);
+    if (scenes && sceneIndex >= 0 && (size_t)sceneIndex < scenes->size())
+    {
+        if (const JsonValue* roots = (*scenes)[sceneIndex].find("nodes"))
+        {
+            for (const JsonValue& root : roots->array)
+                collectPrimitives(document, (int)root.number, glm::mat4(1.0f), instances, 0);
+        }
+    }
+    else if (const JsonValue* meshes = document.json.find("meshes"))
+    {
+        // No scene, take every mesh untransformed
+        for (const JsonValue& gltfMesh : meshes->array)
+        {
+            if (const JsonValue* primitives = gltfMesh.find("primitives"))
+            {
+                for (const JsonValue& primitive : primitives->array)
+                    instances.push_back({ &primitive, glm::mat4(1.0f) });
+            }
+        }
+    }
+
+    // Convert primitives on all cores, each into its own mesh
+    std::vector<MeshData> parts(instances.size());
+    std::vector<char> converted(instances.size(), 0);
+    JobSystem::getInstance()->parallelFor(instances.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+            converted[i] = convertPrimitive(document, instances[i], parts[i]);
+    });
+
+    mesh.clear();
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        if (!converted[i])
+        {
+            std::cout << "Unsupported or malformed primitive in glTF: " << path << std::endl;
+            return false;
+        }
+
+        unsigned int base = (unsigned int)mesh.getVertexCount();
+        mesh.vertices.insert(mesh.vertices.end(), parts[i].vertices.begin(), parts[i].vertices.end());
+        mesh.tangents.insert(mesh.tangents.end(), parts[i].tangents.begin(), parts[i].tangents.end());
+        for (unsigned int index : parts[i].indices)
+            mesh.indices.push_back(index + base);
+        parts[i] = MeshData();
+    }
+
+    mesh.computeBounds();
+    return !mesh.indices.empty();
+}
@@ -0,0 +1,98 @@
+#include "Meshes/MeshData.h"
+
+#include <cmath>
+
+void MeshData::clear()
+{
+    this->vertices.clear();
+    this->tangents.clear();
+    this->indices.clear();
+    this->lods.clear();
+    this->boundsMin = glm::vec3(0.f);
+    this->boundsMax = glm::vec3(0.f);
+}
+
+void MeshData::computeBounds()
+{
+    size_t count = getVertexCount();
+    if (count == 0)
+    {
+        this->boundsMin = this->boundsMax = glm::vec3(0.f);
+        return;
+    }
+
+    this->boundsMin = this->boundsMax = glm::vec3(this->vertices[0], this->vertices[1], this->vertices[2]);
+    for (size_t i = 1; i < count; i++)
+    {
+        glm::vec3 position(this->vertices[i * 5], this->vertices[i * 5 + 1], this->vertices[i * 5 + 2]);
+        this->boundsMin = glm::min(this->boundsMin, position);
+        this->boundsMax = glm::max(this->boundsMax, position);
+    }
+}
+
+static glm::vec3 anyPerpendicular(const glm::vec3& normal)
+{
+    glm::vec3 axis = std::fabs(normal.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f);
+    return glm::normalize(glm::cross(axis, normal));
+}
+
+void MeshData::generateTangents(const std::vector<glm::vec3>* normals)
+{
+    size_t count = getVertexCount();
+    std::vector<glm::vec3> tangentSum(count, glm::vec3(0.f));
+    std::vector<glm::vec3> normalSum;
+    if (!normals)
+        normalSum.assign(count, glm::vec3(0.f));
+
+    auto position = [this](unsigned int i) { return glm::vec3(this->vertices[i * 5], this->vertices[i * 5 + 1], this->vertices[i * 5 + 2]); };
+    auto uv = [this](unsigned int i) { return glm::vec2(this->vertices[i * 5 + 3], this->vertices[i * 5 + 4]); };
+
+    for (size_t t = 0; t + 2 < this->indices.size(); t += 3)
+    {
+        unsigned int i0 = this->indices[t], i1 = this->indices[t + 1], i2 = this->indices[t + 2];
+        glm::vec3 edge1 = position(i1) - position(i0);
+        glm::vec3 edge2 = position(i2) - position(i0);
+        glm::vec2 duv1 = uv(i1) - uv(i0);
+        glm::vec2 duv2 = uv(i2) - uv(i0);
+
+        // Unnormalised sums weight each triangle by its area
+        float determinant = duv1.x * duv2.y - duv2.x * duv1.y;
+        if (std::fabs(determinant) > 1e-12f)
+        {
+            glm::vec3 tangent = (edge1 * duv2.y - edge2 * duv1.y) / determinant;
+            tangentSum[i0] += tangent;
+            tangentSum[i1] += tangent;
+            tangentSum[i2] += tangent;
+        }
+
+        if (!normals)
+        {
+            glm::vec3 faceNormal = glm::cross(edge1, edge2);
+            normalSum[i0] += faceNormal;
+            normalSum[i1] += faceNormal;
+            normalSum[i2] += faceNormal;
+        }
+    }
+
+    this->tangents.resize(count * 6);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 normal = normals ? (*normals)[i] : normalSum[i];
+        normal = glm::dot(normal, normal) > 0.f ? glm::normalize(normal) : glm::vec3(0.f, 0.f, 1.f);
+
+        // Gram-Schmidt against the normal, degenerate UVs get any perpendicular axis
+        glm::vec3 tangent = tangentSum[i] - normal * glm::dot(normal, tangentSum[i]);
+        tangent = glm::dot(tangent, tangent) > 1e-12f ? glm::normalize(tangent) : anyPerpendicular(normal);
+
+        // The vertex shader rebuilds the normal as cross(tangent, bitangent)
+        glm::vec3 bitangent = glm::cross(normal, tangent);
+
+        float* out = &this->tangents[i * 6];
+        out[0] = tangent.x;
+        out[1] = tangent.y;
+        out[2] = tangent.z;
+        out[3] = bitangent.x;
+        out[4] = bitangent.y;
+        out[5] = bitangent.z;
+    }
+}
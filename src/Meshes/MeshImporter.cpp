@@ -0,0 +1,62 @@
+#include "Meshes/MeshImporter.h"
+#include "Meshes/MeshData.h"
+#include "Meshes/CookedMesh.h"
+#include "Meshes/ObjLoader.h"
+#include "Meshes/GltfLoader.h"
+#include "Meshes/MeshOptimizer.h"
+#include "Meshes/MeshSimplifier.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+
+static std::string extensionOf(const std::string& path)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return extension;
+}
+
+bool MeshImporter::import(const std::string& path, MeshData& mesh)
+{
+    std::string extension = extensionOf(path);
+    if (extension == ".obj")
+        return ObjLoader::load(path, mesh);
+    if (extension == ".gltf" || extension == ".glb")
+        return GltfLoader::load(path, mesh);
+
+    std::cout << "Unsupported mesh format: " << path << std::endl;
+    return false;
+}
+
+std::string MeshImporter::getCookedPath(const std::string& source)
+{
+    return source + ".omesh";
+}
+
+bool MeshImporter::load(const std::string& source, CookedMesh& mesh)
+{
+    std::string cooked = getCookedPath(source);
+
+    std::error_code error;
+    auto cookedTime = std::filesystem::last_write_time(cooked, error);
+    bool upToDate = !error && cookedTime >= std::filesystem::last_write_time(source, error);
+    if (upToDate && mesh.open(cooked))
+        return true;
+
+    MeshData data;
+    if (!import(source, data))
+        return false;
+    MeshOptimizer::optimize(data);
+    MeshSimplifier::generateLods(data);
+
+    // Meshes are only handed out mapped, so an unwritable cache directory fails the load
+    if (!CookedMesh::write(cooked, data) || !mesh.open(cooked))
+    {
+        std::cout << "Failed to cache mesh: " << cooked << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,354 @@
+#include "Meshes/MeshOptimizer.h"
+#include "Meshes/MeshData.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+const int MeshOptimizer::CACHE_SIZE;
+const int MeshOptimizer::ANALYSIS_CACHE_SIZE;
+
+// Forsyth's scoring constants, from "Linear-Speed Vertex Cache Optimisation"
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+static const unsigned int VALENCE_TABLE_SIZE = 32;
+
+/*!
+    FIFO cache simulated with timestamps, a vertex is cached while fewer than size misses came after its own
+*/
+struct FifoCache
+{
+    std::vector<uint32_t> timestamps;
+    uint32_t time;
+    uint32_t size;
+
+    FifoCache(size_t vertexCount, int size) : timestamps(vertexCount, 0), time((uint32_t)size + 1), size((uint32_t)size) {}
+
+    // Returns 1 on a miss
+    unsigned int fetch(unsigned int vertex)
+    {
+        if (this->time - this->timestamps[vertex] > this->size)
+        {
+            this->timestamps[vertex] = this->time++;
+            return 1;
+        }
+        return 0;
+    }
+
+    void flush() { this->time += this->size + 1; }
+};
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize)
+{
+    CacheStats stats;
+    if (indexCount < 3 || vertexCount == 0)
+        return stats;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0;
+    size_t uniqueVertices = 0;
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        misses += cache.fetch(indices[i]);
+        if (!referenced[indices[i]])
+        {
+            referenced[indices[i]] = true;
+            uniqueVertices++;
+        }
+    }
+
+    stats.acmr = (float)misses / (float)(indexCount / 3);
+    stats.atvr = (float)misses / (float)uniqueVertices;
+    return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    float cacheScores[CACHE_SIZE];
+    for (int i = 0; i < CACHE_SIZE; i++)
+    {
+        // The last triangle's vertices score the same, no matter which order they were emitted in
+        if (i < 3)
+            cacheScores[i] = LAST_TRIANGLE_SCORE;
+        else
+            cacheScores[i] = std::pow(1.f - (float)(i - 3) / (float)(CACHE_SIZE - 3), CACHE_DECAY_POWER);
+    }
+    float valenceScores[VALENCE_TABLE_SIZE];
+    valenceScores[0] = 0.f;
+    for (unsigned int i = 1; i < VALENCE_TABLE_SIZE; i++)
+        valenceScores[i] = VALENCE_BOOST_SCALE * std::pow((float)i, -VALENCE_BOOST_POWER);
+
+    // Triangles using each vertex, trimmed as they are emitted
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int index : indices)
+        remaining[index]++;
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    auto scoreVertex = [&](unsigned int vertex) {
+        unsigned int uses = remaining[vertex];
+        if (uses == 0)
+            return -1.f;
+        int position = cachePositions[vertex];
+        float score = position >= 0 ? cacheScores[position] : 0.f;
+        return score + (uses < VALENCE_TABLE_SIZE ? valenceScores[uses] : VALENCE_BOOST_SCALE * std::pow((float)uses, -VALENCE_BOOST_POWER));
+    };
+
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScores[v] = scoreVertex((unsigned int)v);
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; t++)
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    unsigned int cache[CACHE_SIZE + 3];
+    unsigned int nextCache[CACHE_SIZE + 3];
+    int cacheCount = 0;
+    size_t cursor = 0;
+
+    // The first triangle is the best one overall, later ones come from the cache
+    size_t best = 0;
+    for (size_t t = 1; t < triangleCount; t++)
+    {
+        if (triangleScores[t] > triangleScores[best])
+            best = t;
+    }
+
+    while (true)
+    {
+        const unsigned int* corners = &indices[best * 3];
+        output.insert(output.end(), corners, corners + 3);
+        emitted[best] = true;
+
+        for (int c = 0; c < 3; c++)
+        {
+            unsigned int vertex = corners[c];
+            unsigned int* begin = &adjacency[offsets[vertex]];
+            unsigned int* end = begin + remaining[vertex];
+            unsigned int* found = std::find(begin, end, (unsigned int)best);
+            if (found != end)
+            {
+                *found = *(end - 1);
+                remaining[vertex]--;
+            }
+        }
+
+        // Most recently used first: this triangle's vertices, then the old cache without them
+        int nextCount = 0;
+        for (int c = 0; c < 3; c++)
+        {
+            if (std::find(nextCache, nextCache + nextCount, corners[c]) == nextCache + nextCount)
+                nextCache[nextCount++] = corners[c];
+        }
+        for (int i = 0; i < cacheCount; i++)
+        {
+            if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2])
+                nextCache[nextCount++] = cache[i];
+        }
+
+        for (int i = 0; i < nextCount; i++)
+        {
+            unsigned int vertex = nextCache[i];
+            cachePositions[vertex] = i < CACHE_SIZE ? i : -1;
+            vertexScores[vertex] = scoreVertex(vertex);
+        }
+
+        // Only triangles around cached vertices changed score, the best of them goes next
+        float bestScore = -1.f;
+        bool found = false;
+        for (int i = 0; i < nextCount; i++)
+        {
+            unsigned int vertex = nextCache[i];
+            for (unsigned int a = offsets[vertex]; a < offsets[vertex] + remaining[vertex]; a++)
+            {
+                unsigned int t = adjacency[a];
+                float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = t;
+                    found = true;
+                }
+            }
+        }
+
+        cacheCount = std::min(nextCount, CACHE_SIZE);
+        std::copy(nextCache, nextCache + cacheCount, cache);
+
+        if (!found)
+        {
+            // Dead end, carry on with the next triangle in input order
+            while (cursor < triangleCount && emitted[cursor])
+                cursor++;
+            if (cursor == triangleCount)
+                break;
+            best = cursor;
+        }
+    }
+
+    indices.swap(output);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& vertices, float threshold)
+{
+    size_t triangleCount = indices.size() / 3;
+    size_t vertexCount = vertices.size() / 5;
+    if (triangleCount < 2)
+        return;
+
+    // Hard boundaries: triangles missing the cache on all three vertices, the cache order restarts there
+    FifoCache cache(vertexCount, ANALYSIS_CACHE_SIZE);
+    std::vector<unsigned int> misses(triangleCount);
+    std::vector<size_t> hardClusters;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        misses[t] = cache.fetch(indices[t * 3]) + cache.fetch(indices[t * 3 + 1]) + cache.fetch(indices[t * 3 + 2]);
+        if (t == 0 || misses[t] == 3)
+            hardClusters.push_back(t);
+    }
+    hardClusters.push_back(triangleCount);
+
+    // Soft boundaries: cut a hard cluster wherever a cold cache restart stays within threshold of its ACMR
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hardClusters.size(); h++)
+    {
+        size_t begin = hardClusters[h];
+        size_t end = hardClusters[h + 1];
+        unsigned int clusterMisses = 0;
+        for (size_t t = begin; t < end; t++)
+            clusterMisses += misses[t];
+        float target = (float)clusterMisses / (float)(end - begin) * threshold;
+
+        clusters.push_back(begin);
+        cache.flush();
+        unsigned int localMisses = 0;
+        for (size_t t = begin; t < end; t++)
+        {
+            localMisses += cache.fetch(indices[t * 3]) + cache.fetch(indices[t * 3 + 1]) + cache.fetch(indices[t * 3 + 2]);
+            if (t + 1 < end && (float)localMisses / (float)(t + 1 - clusters.back()) <= target)
+            {
+                clusters.push_back(t + 1);
+                cache.flush();
+                localMisses = 0;
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    auto position = [&](unsigned int vertex) { return glm::vec3(vertices[vertex * 5], vertices[vertex * 5 + 1], vertices[vertex * 5 + 2]); };
+
+    // Area weighted centroids and normals, the mesh centroid serves as the viewpoint independent "inside"
+    size_t clusterCount = clusters.size() - 1;
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.f));
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.f));
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        float clusterArea = 0.f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            glm::vec3 p0 = position(indices[t * 3]);
+            glm::vec3 p1 = position(indices[t * 3 + 1]);
+            glm::vec3 p2 = position(indices[t * 3 + 2]);
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            centroids[c] += (p0 + p1 + p2) * (area / 3.f);
+            normals[c] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += clusterArea;
+        centroids[c] = clusterArea > 0.f ? centroids[c] / clusterArea : position(indices[clusters[c] * 3]);
+    }
+    if (meshArea > 0.f)
+        meshCentroid /= meshArea;
+
+    std::vector<float> keys(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        float length = glm::length(normals[c]);
+        keys[c] = length > 0.f ? glm::dot(centroids[c] - meshCentroid, normals[c] / length) : 0.f;
+    }
+
+    // Outward facing clusters first, they are the ones most likely to occlude the rest
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (size_t c : order)
+        output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    indices.swap(output);
+}
+
+void MeshOptimizer::optimizeVertexFetch(MeshData& mesh)
+{
+    size_t vertexCount = mesh.getVertexCount();
+    bool hasTangents = mesh.tangents.size() == vertexCount * 6;
+
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertexCount, unused);
+    std::vector<float> vertices;
+    std::vector<float> tangents;
+    vertices.reserve(mesh.vertices.size());
+    if (hasTangents)
+        tangents.reserve(mesh.tangents.size());
+
+    unsigned int next = 0;
+    for (unsigned int& index : mesh.indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = next++;
+            vertices.insert(vertices.end(), &mesh.vertices[index * 5], &mesh.vertices[index * 5] + 5);
+            if (hasTangents)
+                tangents.insert(tangents.end(), &mesh.tangents[index * 6], &mesh.tangents[index * 6] + 6);
+        }
+        index = remap[index];
+    }
+
+    mesh.vertices.swap(vertices);
+    if (hasTangents)
+        mesh.tangents.swap(tangents);
+}
+
+void MeshOptimizer::optimize(MeshData& mesh)
+{
+    auto begin = std::chrono::steady_clock::now();
+    CacheStats before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.getVertexCount());
+
+    optimizeVertexCache(mesh.indices, mesh.getVertexCount());
+    optimizeOverdraw(mesh.indices, mesh.vertices);
+    optimizeVertexFetch(mesh);
+
+    CacheStats after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.getVertexCount());
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "Optimized mesh in " << ms << " ms, ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
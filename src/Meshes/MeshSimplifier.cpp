@@ -0,0 +1,325 @@
+#include "Meshes/MeshSimplifier.h"
+#include "Meshes/MeshData.h"
+#include "Meshes/MeshOptimizer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <unordered_map>
+
+const int MeshSimplifier::MAX_LODS;
+const size_t MeshSimplifier::MIN_LOD_TRIANGLES;
+
+// Largest error a level may reach, relative to the diagonal of the mesh bounds
+static const float MAX_RELATIVE_ERROR = 0.1f;
+// A level removing less than this share of the previous level's triangles ends the chain
+static const float MIN_REDUCTION = 0.2f;
+// Collapses turning a remaining triangle's normal further than this cosine are rejected
+static const double MIN_NORMAL_COSINE = 0.5;
+
+/*!
+    Sum of squared distances to a set of planes, each weighted by the area of the triangle it came from
+*/
+struct Quadric
+{
+    // Upper triangle of the symmetric 4x4 matrix: aa ab ac ad bb bc bd cc cd dd
+    double q[10];
+    double weight;
+
+    Quadric()
+    {
+        std::fill(this->q, this->q + 10, 0.0);
+        this->weight = 0.0;
+    }
+
+    Quadric(const glm::dvec3& normal, double d, double area)
+    {
+        double plane[4] = { normal.x, normal.y, normal.z, d };
+        int k = 0;
+        for (int i = 0; i < 4; i++)
+            for (int j = i; j < 4; j++)
+                this->q[k++] = plane[i] * plane[j] * area;
+        this->weight = area;
+    }
+
+    void add(const Quadric& other)
+    {
+        for (int i = 0; i < 10; i++)
+            this->q[i] += other.q[i];
+        this->weight += other.weight;
+    }
+
+    double evaluate(const glm::dvec3& p) const
+    {
+        const double* q = this->q;
+        return q[0] * p.x * p.x + 2.0 * q[1] * p.x * p.y + 2.0 * q[2] * p.x * p.z + 2.0 * q[3] * p.x
+             + q[4] * p.y * p.y + 2.0 * q[5] * p.y * p.z + 2.0 * q[6] * p.y
+             + q[7] * p.z * p.z + 2.0 * q[8] * p.z
+             + q[9];
+    }
+};
+
+struct PositionKey
+{
+    uint32_t bits[3];
+
+    bool operator==(const PositionKey& other) const { return std::memcmp(this->bits, other.bits, sizeof(this->bits)) == 0; }
+};
+
+struct PositionHash
+{
+    size_t operator()(const PositionKey& key) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t bits : key.bits)
+            hash = (hash ^ bits) * 1099511628211ull;
+        return (size_t)hash;
+    }
+};
+
+struct Collapse
+{
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+float MeshSimplifier::simplify(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, size_t targetIndexCount, float maxError, std::vector<unsigned int>& result)
+{
+    size_t vertexCount = vertices.size() / 5;
+    std::vector<glm::dvec3> positions(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        positions[i] = glm::dvec3(vertices[i * 5], vertices[i * 5 + 1], vertices[i * 5 + 2]);
+
+    // Weld vertices split for their attributes, the first one at a position stands for all of them
+    std::vector<unsigned int> welded(vertexCount);
+    std::vector<unsigned int> wedges(vertexCount, 0);
+    {
+        std::unordered_map<PositionKey, unsigned int, PositionHash> firstAt;
+        firstAt.reserve(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            PositionKey key;
+            std::memcpy(key.bits, &vertices[i * 5], sizeof(key.bits));
+            welded[i] = firstAt.emplace(key, (unsigned int)i).first->second;
+            wedges[welded[i]]++;
+        }
+    }
+
+    // Seams, open borders and non-manifold edges keep their positions: an edge is interior when
+    // it is used exactly once in each direction
+    std::vector<char> locked(vertexCount, 0);
+    {
+        std::unordered_map<uint64_t, unsigned int> edgeUses;
+        edgeUses.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (int e = 0; e < 3; e++)
+            {
+                uint64_t a = welded[indices[i + e]];
+                uint64_t b = welded[indices[i + (e + 1) % 3]];
+                edgeUses[(a << 32) | b]++;
+            }
+        }
+        for (const auto& edge : edgeUses)
+        {
+            uint64_t reverse = (edge.first << 32) | (edge.first >> 32);
+            auto it = edgeUses.find(reverse);
+            if (edge.second != 1 || it == edgeUses.end() || it->second != 1)
+            {
+                locked[edge.first >> 32] = 1;
+                locked[edge.first & 0xFFFFFFFFu] = 1;
+            }
+        }
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            if (wedges[welded[i]] > 1)
+                locked[welded[i]] = 1;
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const glm::dvec3& p0 = positions[indices[i]];
+        glm::dvec3 normal = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+        double length = glm::length(normal);
+        if (length == 0.0)
+            continue;
+
+        normal /= length;
+        Quadric plane(normal, -glm::dot(normal, p0), length * 0.5);
+        for (int c = 0; c < 3; c++)
+            quadrics[welded[indices[i + c]]].add(plane);
+    }
+
+    std::vector<unsigned int> current(indices);
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<char> touched(vertexCount);
+    std::vector<unsigned int> triangleOffsets(vertexCount + 1);
+    std::vector<unsigned int> vertexTriangles;
+    double error = 0.0;
+
+    auto collapseCost = [&](unsigned int from, unsigned int to) {
+        Quadric merged = quadrics[welded[from]];
+        merged.add(quadrics[welded[to]]);
+        if (merged.weight <= 0.0)
+            return 0.0;
+        return std::sqrt(std::max(0.0, merged.evaluate(positions[to]) / merged.weight));
+    };
+
+    // Moving from onto to must not fold over any triangle around from that survives the collapse
+    auto flips = [&](unsigned int from, unsigned int to) {
+        for (unsigned int t = triangleOffsets[from]; t < triangleOffsets[from + 1]; t++)
+        {
+            const unsigned int* triangle = &current[vertexTriangles[t] * 3];
+            if (welded[triangle[0]] == welded[to] || welded[triangle[1]] == welded[to] || welded[triangle[2]] == welded[to])
+                continue;
+
+            glm::dvec3 corners[3] = { positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+            glm::dvec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+            for (int c = 0; c < 3; c++)
+            {
+                if (triangle[c] == from)
+                    corners[c] = positions[to];
+            }
+            glm::dvec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+            double lengths = glm::length(before) * glm::length(after);
+            if (lengths == 0.0 || glm::dot(before, after) < MIN_NORMAL_COSINE * lengths)
+                return true;
+        }
+        return false;
+    };
+
+    // Each pass collapses the cheapest edges whose neighbourhoods don't overlap, then rebuilds
+    while (current.size() > targetIndexCount)
+    {
+        size_t triangleCount = current.size() / 3;
+
+        collapses.clear();
+        for (size_t i = 0; i < current.size(); i += 3)
+        {
+            for (int e = 0; e < 3; e++)
+            {
+                unsigned int a = current[i + e];
+                unsigned int b = current[i + (e + 1) % 3];
+                if (!locked[welded[a]])
+                    collapses.push_back({ a, b, collapseCost(a, b) });
+                if (!locked[welded[b]])
+                    collapses.push_back({ b, a, collapseCost(b, a) });
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (unsigned int index : current)
+            triangleOffsets[index + 1]++;
+        for (size_t i = 0; i < vertexCount; i++)
+            triangleOffsets[i + 1] += triangleOffsets[i];
+        vertexTriangles.resize(current.size());
+        {
+            std::vector<unsigned int> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (size_t i = 0; i < current.size(); i++)
+                vertexTriangles[cursor[current[i]]++] = (unsigned int)(i / 3);
+        }
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t removeTarget = triangleCount - targetIndexCount / 3;
+        size_t removed = 0;
+        size_t collapsed = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (removed >= removeTarget || collapse.cost > maxError)
+                break;
+            // Triangles around from are untouched only while none of its neighbours moved this pass
+            if (touched[collapse.from] || remap[collapse.to] != collapse.to || flips(collapse.from, collapse.to))
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            for (unsigned int t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++)
+            {
+                const unsigned int* triangle = &current[vertexTriangles[t] * 3];
+                bool degenerate = false;
+                for (int c = 0; c < 3; c++)
+                {
+                    touched[triangle[c]] = 1;
+                    degenerate |= welded[triangle[c]] == welded[collapse.to];
+                }
+                if (degenerate)
+                    removed++;
+            }
+            quadrics[welded[collapse.to]].add(quadrics[welded[collapse.from]]);
+            error = std::max(error, collapse.cost);
+            collapsed++;
+        }
+        if (collapsed == 0)
+            break;
+
+        // Drop triangles left with two corners at one position
+        size_t write = 0;
+        for (size_t i = 0; i < current.size(); i += 3)
+        {
+            unsigned int a = remap[current[i]];
+            unsigned int b = remap[current[i + 1]];
+            unsigned int c = remap[current[i + 2]];
+            if (welded[a] == welded[b] || welded[b] == welded[c] || welded[c] == welded[a])
+                continue;
+            current[write++] = a;
+            current[write++] = b;
+            current[write++] = c;
+        }
+        current.resize(write);
+    }
+
+    result.swap(current);
+    return (float)error;
+}
+
+void MeshSimplifier::generateLods(MeshData& mesh)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    mesh.lods.clear();
+    MeshLod full;
+    full.indexCount = mesh.indices.size();
+    mesh.lods.push_back(full);
+
+    // Every level is simplified from full detail so its error is measured against the real surface
+    const std::vector<unsigned int> fullIndices(mesh.indices);
+    float maxError = glm::length(mesh.boundsMax - mesh.boundsMin) * MAX_RELATIVE_ERROR;
+    std::vector<unsigned int> level;
+    while ((int)mesh.lods.size() < MAX_LODS)
+    {
+        MeshLod previous = mesh.lods.back();
+        size_t target = previous.indexCount / 6 * 3;
+        if (target / 3 < MIN_LOD_TRIANGLES)
+            break;
+
+        float error = simplify(mesh.vertices, fullIndices, target, maxError, level);
+        if (level.empty() || level.size() > previous.indexCount * (1.f - MIN_REDUCTION))
+            break;
+        MeshOptimizer::optimizeVertexCache(level, mesh.getVertexCount());
+
+        MeshLod lod;
+        lod.firstIndex = mesh.indices.size();
+        lod.indexCount = level.size();
+        lod.error = std::max(error, previous.error);
+        mesh.indices.insert(mesh.indices.end(), level.begin(), level.end());
+        mesh.lods.push_back(lod);
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "Generated " << mesh.lods.size() << " LODs in " << ms << " ms, triangles";
+    for (const MeshLod& lod : mesh.lods)
+        std::cout << " " << lod.indexCount / 3 << " (" << lod.error << ")";
+    std::cout << std::endl;
+}
@@ -0,0 +1,332 @@
+#include "Meshes/ObjLoader.h"
+#include "Meshes/MeshData.h"
+#include "Textures/MappedFile.h"
+#include "Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// Smallest chunk worth a job, small files parse on the calling thread
+static const size_t MIN_CHUNK_BYTES = 1024 * 1024;
+
+// Flags of ObjCorner::relative, set for references made with negative OBJ indices
+static const uint8_t RELATIVE_POSITION = 1 << 0;
+static const uint8_t RELATIVE_UV = 1 << 1;
+static const uint8_t RELATIVE_NORMAL = 1 << 2;
+
+// Attribute references of one triangle corner, INT32_MIN for none. Absolute ones are global
+// 0-based indices. Relative ones are indices from the start of the chunk, negative when they
+// reach back into earlier chunks, and are resolved once the chunks are merged.
+struct ObjCorner
+{
+    int32_t position;
+    int32_t uv;
+    int32_t normal;
+    uint8_t relative;
+};
+
+struct ObjChunk
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+    std::vector<ObjCorner> corners;
+    bool valid = true;
+};
+
+struct CornerKey
+{
+    int32_t position;
+    int32_t uv;
+    int32_t normal;
+
+    bool operator==(const CornerKey& other) const
+    {
+        return this->position == other.position && this->uv == other.uv && this->normal == other.normal;
+    }
+};
+
+struct CornerHash
+{
+    size_t operator()(const CornerKey& key) const
+    {
+        uint64_t hash = (uint64_t)(uint32_t)key.position * 0x9E3779B97F4A7C15ull;
+        hash ^= ((uint64_t)(uint32_t)key.uv + 0x632BE59BD9B4E019ull) * 0xBF58476D1CE4E5B9ull;
+        hash ^= ((uint64_t)(uint32_t)key.normal + 0x94D049BB133111EBull) * 0xD6E8FEB86659FD93ull;
+        return (size_t)(hash ^ (hash >> 31));
+    }
+};
+
+static inline void skipSpaces(const char*& p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+}
+
+static inline void skipLine(const char*& p, const char* end)
+{
+    while (p < end && *p != '\n')
+        p++;
+    if (p < end)
+        p++;
+}
+
+// strtof is locale dependent and needs a terminated string, the mapping is neither
+static inline float parseFloat(const char*& p, const char* end)
+{
+    skipSpaces(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    double value = 0.0;
+    while (p < end && *p >= '0' && *p <= '9')
+        value = value * 10.0 + (*p++ - '0');
+
+    if (p < end && *p == '.')
+    {
+        p++;
+        double scale = 0.1;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            value += (*p++ - '0') * scale;
+            scale *= 0.1;
+        }
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negativeExponent = *p++ == '-';
+        int exponent = 0;
+        while (p < end && *p >= '0' && *p <= '9')
+            exponent = exponent * 10 + (*p++ - '0');
+        value *= std::pow(10.0, negativeExponent ? -exponent : exponent);
+    }
+
+    return (float)(negative ? -value : value);
+}
+
+static inline bool parseInt(const char*& p, const char* end, int& value)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    if (p >= end || *p < '0' || *p > '9')
+        return false;
+
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        value = value * 10 + (*p++ - '0');
+    if (negative)
+        value = -value;
+    return true;
+}
+
+// OBJ indices are 1-based, negative ones count back from the last element defined so far.
+// Sets flag in relative for those, index 0 is invalid and gives -1, rejected after merging.
+static inline int32_t resolveReference(int value, size_t localCount, uint8_t flag, uint8_t& relative)
+{
+    if (value > 0)
+        return value - 1;
+    if (value == 0)
+        return -1;
+    relative |= flag;
+    return (int32_t)localCount + value;
+}
+
+static void parseChunk(const char* begin, const char* end, ObjChunk& chunk)
+{
+    const char* p = begin;
+    std::vector<ObjCorner> polygon;
+
+    while (p < end)
+    {
+        skipSpaces(p, end);
+        if (p + 1 < end && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            p += 1;
+            float x = parseFloat(p, end);
+            float y = parseFloat(p, end);
+            float z = parseFloat(p, end);
+            chunk.positions.emplace_back(x, y, z);
+        }
+        else if (p + 2 < end && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+        {
+            p += 2;
+            float u = parseFloat(p, end);
+            float v = parseFloat(p, end);
+            chunk.uvs.emplace_back(u, v);
+        }
+        else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+        {
+            p += 2;
+            float x = parseFloat(p, end);
+            float y = parseFloat(p, end);
+            float z = parseFloat(p, end);
+            chunk.normals.emplace_back(x, y, z);
+        }
+        else if (p + 1 < end && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            p += 1;
+            polygon.clear();
+            while (true)
+            {
+                skipSpaces(p, end);
+                int value;
+                if (!parseInt(p, end, value))
+                    break;
+
+                ObjCorner corner = { 0, INT32_MIN, INT32_MIN, 0 };
+                corner.position = resolveReference(value, chunk.positions.size(), RELATIVE_POSITION, corner.relative);
+                if (p < end && *p == '/')
+                {
+                    p++;
+                    if (parseInt(p, end, value))
+                        corner.uv = resolveReference(value, chunk.uvs.size(), RELATIVE_UV, corner.relative);
+                    if (p < end && *p == '/')
+                    {
+                        p++;
+                        if (parseInt(p, end, value))
+                            corner.normal = resolveReference(value, chunk.normals.size(), RELATIVE_NORMAL, corner.relative);
+                    }
+                }
+                polygon.push_back(corner);
+            }
+
+            if (polygon.size() < 3)
+                chunk.valid = false;
+            for (size_t i = 2; i < polygon.size(); i++)
+            {
+                chunk.corners.push_back(polygon[0]);
+                chunk.corners.push_back(polygon[i - 1]);
+                chunk.corners.push_back(polygon[i]);
+            }
+        }
+
+        // Everything else (comments, groups, materials, smoothing) is ignored
+        skipLine(p, end);
+    }
+}
+
+// Relative references reaching back past the first element give -1, which the weld rejects
+static inline int32_t toGlobal(int32_t reference, bool relative, int32_t base)
+{
+    if (reference == INT32_MIN || !relative)
+        return reference;
+    return base + reference >= 0 ? base + reference : -1;
+}
+
+bool ObjLoader::load(const std::string& path, MeshData& mesh)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        std::cout << "Failed to open mesh: " << path << std::endl;
+        return false;
+    }
+
+    const char* data = (const char*)file.getData();
+    size_t size = file.getSize();
+
+    // Split at line starts so no statement spans two chunks
+    JobSystem* jobs = JobSystem::getInstance();
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(jobs->getThreadCount(), size / MIN_CHUNK_BYTES));
+    std::vector<const char*> bounds(chunkCount + 1);
+    bounds[0] = data;
+    bounds[chunkCount] = data + size;
+    for (size_t i = 1; i < chunkCount; i++)
+    {
+        const char* split = std::max(bounds[i - 1], data + size * i / chunkCount);
+        while (split < data + size && split[-1] != '\n')
+            split++;
+        bounds[i] = split;
+    }
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    jobs->parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+            parseChunk(bounds[i], bounds[i + 1], chunks[i]);
+    });
+
+    // Concatenate attributes, relative references resolve against each chunk's base
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+    size_t cornerCount = 0;
+    for (const ObjChunk& chunk : chunks)
+        cornerCount += chunk.corners.size();
+
+    std::vector<ObjCorner> corners;
+    corners.reserve(cornerCount);
+    for (ObjChunk& chunk : chunks)
+    {
+        if (!chunk.valid)
+        {
+            std::cout << "Malformed face in mesh: " << path << std::endl;
+            return false;
+        }
+
+        int32_t positionBase = (int32_t)positions.size();
+        int32_t uvBase = (int32_t)uvs.size();
+        int32_t normalBase = (int32_t)normals.size();
+        for (const ObjCorner& corner : chunk.corners)
+        {
+            corners.push_back({ toGlobal(corner.position, (corner.relative & RELATIVE_POSITION) != 0, positionBase),
+                                toGlobal(corner.uv, (corner.relative & RELATIVE_UV) != 0, uvBase),
+                                toGlobal(corner.normal, (corner.relative & RELATIVE_NORMAL) != 0, normalBase), 0 });
+        }
+
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        // Merged chunks are released as we go, large files would otherwise hold everything twice
+        chunk = ObjChunk();
+    }
+
+    // Weld identical corners into shared vertices
+    mesh.clear();
+    mesh.indices.reserve(corners.size());
+    mesh.vertices.reserve(std::min(corners.size(), positions.size() * 2) * 5);
+
+    std::unordered_map<CornerKey, unsigned int, CornerHash> vertexMap;
+    vertexMap.reserve(std::min(corners.size(), positions.size() * 2));
+    std::vector<glm::vec3> vertexNormals;
+    bool hasNormals = !normals.empty();
+
+    for (const ObjCorner& corner : corners)
+    {
+        if (corner.position < 0 || (size_t)corner.position >= positions.size()
+            || (corner.uv != INT32_MIN && (corner.uv < 0 || (size_t)corner.uv >= uvs.size()))
+            || (corner.normal != INT32_MIN && (corner.normal < 0 || (size_t)corner.normal >= normals.size())))
+        {
+            std::cout << "Face references a missing vertex in mesh: " << path << std::endl;
+            return false;
+        }
+
+        CornerKey key = { corner.position, corner.uv, corner.normal };
+        auto inserted = vertexMap.emplace(key, (unsigned int)mesh.getVertexCount());
+        if (inserted.second)
+        {
+            const glm::vec3& position = positions[corner.position];
+            glm::vec2 uv = corner.uv != INT32_MIN ? uvs[corner.uv] : glm::vec2(0.f);
+            mesh.vertices.insert(mesh.vertices.end(), { position.x, position.y, position.z, uv.x, uv.y });
+
+            if (corner.normal == INT32_MIN)
+                hasNormals = false;
+            else if (hasNormals)
+                vertexNormals.push_back(normals[corner.normal]);
+        }
+        mesh.indices.push_back(inserted.first->second);
+    }
+
+    mesh.generateTangents(hasNormals ? &vertexNormals : nullptr);
+    mesh.computeBounds();
+    return !mesh.indices.empty();
+}
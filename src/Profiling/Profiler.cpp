@@ -0,0 +1,323 @@
+#include "Profiling/Profiler.h"
+
+#ifdef OPTIM_PROFILING
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Trace thread ids, registered threads are numbered after the GPU row
+static const int RENDER_THREAD_ID = 1;
+static const int GPU_THREAD_ID = 2;
+static thread_local int currentThreadId = RENDER_THREAD_ID;
+
+Profiler* Profiler::instance = nullptr;
+
+Profiler::Profiler()
+{
+    this->epochNs = 0;
+    this->epochNs = now();
+    this->frameIndex = 0;
+
+    this->captureFramesLeft = 0;
+    this->gpuFramesPending = 0;
+
+    for (int i = 0; i < GPU_FRAME_LATENCY * MAX_GPU_ZONES_PER_FRAME; i++)
+        this->queries[i] = 0;
+    for (int i = 0; i < GPU_FRAME_LATENCY; i++)
+    {
+        this->gpuFrames[i].frame = 0;
+        this->gpuFrames[i].zoneCount = 0;
+        this->gpuFrames[i].inFlight = false;
+    }
+
+    this->gpuFrameSlot = -1;
+    this->activeGpuZone = -1;
+    this->recordingFrame = false;
+    this->droppedGpuFrames = 0;
+}
+
+Profiler* Profiler::getInstance()
+{
+    if (!instance)
+    {
+        instance = new Profiler();
+    }
+
+    return instance;
+}
+
+uint64_t Profiler::now()
+{
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch());
+    return (uint64_t)ns.count() - this->epochNs;
+}
+
+bool Profiler::initQueries()
+{
+    if (this->queries[0] != 0)
+        return true;
+
+    glGenQueries(GPU_FRAME_LATENCY * MAX_GPU_ZONES_PER_FRAME, this->queries);
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cout << "GL Error after generating profiler queries" << std::endl;
+        this->queries[0] = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void Profiler::startCapture(int frameCount, const std::string& path)
+{
+    if (isCapturing() || frameCount <= 0)
+        return;
+
+    // GPU zones are skipped if queries are unavailable, CPU zones still get captured
+    initQueries();
+
+    {
+        std::lock_guard<std::mutex> lock(this->cpuMutex);
+        this->cpuEvents.clear();
+        this->cpuEvents.reserve(frameCount * 64);
+    }
+    this->gpuEvents.clear();
+    this->gpuEvents.reserve(frameCount * 64);
+    this->droppedGpuFrames = 0;
+
+    this->captureFramesLeft = frameCount;
+    this->capturePath = path;
+    std::cout << "Capturing " << frameCount << " frames to " << path << std::endl;
+}
+
+void Profiler::beginFrame()
+{
+    std::unique_lock<std::mutex> lock(this->cpuMutex);
+    this->frameIndex++;
+    this->recordingFrame = this->captureFramesLeft > 0;
+    lock.unlock();
+
+    resolveGpuFrames(false);
+
+    if (this->captureFramesLeft <= 0)
+        return;
+
+    this->gpuFrameSlot = -1;
+
+    if (this->queries[0] == 0)
+        return;
+
+    // Never wait on the GPU: if the oldest frame's queries are still in flight, this frame goes without GPU zones
+    int slot = this->frameIndex % GPU_FRAME_LATENCY;
+    if (this->gpuFrames[slot].inFlight)
+    {
+        this->droppedGpuFrames++;
+        return;
+    }
+
+    this->gpuFrameSlot = slot;
+    this->gpuFrames[slot].frame = this->frameIndex;
+    this->gpuFrames[slot].zoneCount = 0;
+}
+
+void Profiler::endFrame()
+{
+    if (this->recordingFrame)
+    {
+        if (this->gpuFrameSlot != -1 && this->gpuFrames[this->gpuFrameSlot].zoneCount > 0)
+        {
+            this->gpuFrames[this->gpuFrameSlot].inFlight = true;
+            this->gpuFramesPending++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->cpuMutex);
+            this->recordingFrame = false;
+        }
+        this->gpuFrameSlot = -1;
+        this->captureFramesLeft--;
+    }
+
+    resolveGpuFrames(false);
+
+    if (!this->capturePath.empty() && !isCapturing())
+        completeCapture();
+}
+
+void Profiler::finishCapture()
+{
+    if (this->capturePath.empty())
+        return;
+
+    // Shutting down, blocking on the outstanding queries is fine here
+    this->captureFramesLeft = 0;
+    resolveGpuFrames(true);
+    completeCapture();
+}
+
+void Profiler::completeCapture()
+{
+    if (writeTrace())
+        std::cout << "Wrote profiler capture " << this->capturePath << std::endl;
+    if (this->droppedGpuFrames > 0)
+        std::cout << this->droppedGpuFrames << " frames captured without GPU zones (GPU too far behind)" << std::endl;
+
+    this->capturePath.clear();
+    {
+        std::lock_guard<std::mutex> lock(this->cpuMutex);
+        this->cpuEvents.clear();
+    }
+    this->gpuEvents.clear();
+}
+
+void Profiler::registerThread(const char* name)
+{
+    std::lock_guard<std::mutex> lock(this->cpuMutex);
+
+    // Threads restarted under the same name share a row
+    for (const std::pair<int, const char*>& thread : this->threadNames)
+    {
+        if (std::strcmp(thread.second, name) == 0)
+        {
+            currentThreadId = thread.first;
+            return;
+        }
+    }
+
+    currentThreadId = GPU_THREAD_ID + 1 + (int)this->threadNames.size();
+    this->threadNames.push_back(std::make_pair(currentThreadId, name));
+}
+
+int Profiler::beginCpuZone(const char* name)
+{
+    std::lock_guard<std::mutex> lock(this->cpuMutex);
+    if (!this->recordingFrame)
+        return -1;
+
+    Event event = { name, now(), 0, this->frameIndex, currentThreadId };
+    this->cpuEvents.push_back(event);
+    return (int)this->cpuEvents.size() - 1;
+}
+
+void Profiler::endCpuZone(int zone)
+{
+    if (zone < 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(this->cpuMutex);
+    this->cpuEvents[zone].durationNs = now() - this->cpuEvents[zone].startNs;
+}
+
+int Profiler::beginGpuZone(const char* name)
+{
+    if (this->gpuFrameSlot == -1 || this->activeGpuZone != -1)
+        return -1;
+
+    GpuFrame& frame = this->gpuFrames[this->gpuFrameSlot];
+    if (frame.zoneCount == MAX_GPU_ZONES_PER_FRAME)
+        return -1;
+
+    int zone = frame.zoneCount++;
+    frame.names[zone] = name;
+    frame.issueNs[zone] = now();
+
+    glBeginQuery(GL_TIME_ELAPSED, this->queries[this->gpuFrameSlot * MAX_GPU_ZONES_PER_FRAME + zone]);
+    this->activeGpuZone = zone;
+    return zone;
+}
+
+void Profiler::endGpuZone(int zone)
+{
+    if (zone < 0)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    this->activeGpuZone = -1;
+}
+
+void Profiler::resolveGpuFrames(bool wait)
+{
+    for (int slot = 0; slot < GPU_FRAME_LATENCY && this->gpuFramesPending > 0; slot++)
+    {
+        GpuFrame& frame = this->gpuFrames[slot];
+        if (!frame.inFlight)
+            continue;
+
+        unsigned int* frameQueries = &this->queries[slot * MAX_GPU_ZONES_PER_FRAME];
+
+        if (!wait)
+        {
+            bool available = true;
+            for (int zone = 0; zone < frame.zoneCount && available; zone++)
+            {
+                GLint result = 0;
+                glGetQueryObjectiv(frameQueries[zone], GL_QUERY_RESULT_AVAILABLE, &result);
+                available = result != 0;
+            }
+
+            if (!available)
+                continue;
+        }
+
+        // Only durations are known, lay the zones out back to back starting no earlier than their submission
+        uint64_t gpuCursor = 0;
+        for (int zone = 0; zone < frame.zoneCount; zone++)
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(frameQueries[zone], GL_QUERY_RESULT, &elapsed);
+
+            uint64_t start = frame.issueNs[zone] > gpuCursor ? frame.issueNs[zone] : gpuCursor;
+            Event event = { frame.names[zone], start, (uint64_t)elapsed, frame.frame, GPU_THREAD_ID };
+            this->gpuEvents.push_back(event);
+            gpuCursor = start + elapsed;
+        }
+
+        frame.inFlight = false;
+        this->gpuFramesPending--;
+    }
+}
+
+static void writeEvent(std::ofstream& out, const char* name, uint64_t startNs, uint64_t durationNs, uint32_t frame, int tid, bool& first)
+{
+    if (!first)
+        out << ",\n";
+    first = false;
+
+    out << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+        << ",\"ts\":" << startNs / 1000.0 << ",\"dur\":" << durationNs / 1000.0
+        << ",\"args\":{\"frame\":" << frame << "}}";
+}
+
+bool Profiler::writeTrace()
+{
+    std::ofstream out(this->capturePath);
+    if (!out)
+    {
+        std::cout << "Failed to open profiler capture: " << this->capturePath << std::endl;
+        return false;
+    }
+
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << RENDER_THREAD_ID << ",\"args\":{\"name\":\"Render thread\"}},\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_THREAD_ID << ",\"args\":{\"name\":\"GPU\"}}";
+
+    std::lock_guard<std::mutex> lock(this->cpuMutex);
+    for (const std::pair<int, const char*>& thread : this->threadNames)
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.first << ",\"args\":{\"name\":\"" << thread.second << "\"}}";
+
+    bool first = false;
+    for (const Event& event : this->cpuEvents)
+        writeEvent(out, event.name, event.startNs, event.durationNs, event.frame, event.thread, first);
+    for (const Event& event : this->gpuEvents)
+        writeEvent(out, event.name, event.startNs, event.durationNs, event.frame, event.thread, first);
+
+    out << "\n]}\n";
+    return (bool)out;
+}
+
+#endif // OPTIM_PROFILING
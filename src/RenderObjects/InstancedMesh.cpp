@@ -0,0 +1,239 @@
+#include "RenderObjects/InstancedMesh.h"
+#include "RenderObjects/Object.h"
+#include "Rendering/RenderQueue.h"
+#include "Rendering/GeometryPool.h"
+#include "Rendering/StreamingBuffer.h"
+#include "shaders/ShaderProgram.h"
+#include "Profiling/Profiler.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+// Per-instance mat4 takes four consecutive vec4 attribute slots
+static const unsigned int INSTANCE_ATTRIBUTE = 4;
+
+InstancedMesh::InstancedMesh(Object* prototype)
+{
+    this->prototype = prototype;
+    this->shader = nullptr;
+    this->depthShader = nullptr;
+
+    this->attributeHandle = 0;
+    this->depthAttributeHandle = 0;
+    this->instanceHandle = 0;
+    this->instanceCapacity = 0;
+
+    this->dirtyBegin = 0;
+    this->dirtyEnd = 0;
+    this->copiedCount = 0;
+    this->materialKey = -1;
+}
+
+InstancedMesh::~InstancedMesh()
+{
+    if (this->attributeHandle != 0)
+        glDeleteVertexArrays(1, &this->attributeHandle);
+    if (this->depthAttributeHandle != 0)
+        glDeleteVertexArrays(1, &this->depthAttributeHandle);
+    if (this->instanceHandle != 0)
+        glDeleteBuffers(1, &this->instanceHandle);
+}
+
+std::string InstancedMesh::getShaderDefines(uint32_t variant, const VertexLayout& layout)
+{
+    return Object::getShaderDefines(variant, layout) + "#define INSTANCED\n";
+}
+
+bool InstancedMesh::compileShader(uint32_t lighting)
+{
+    uint32_t variant = ShaderVariants::makeKey(this->prototype->getMaterialFeatures(), lighting);
+    this->shader = ShaderProgram::getShared(getShaderDefines(variant, this->prototype->getVertexLayout()));
+    uint32_t depthVariant = ShaderVariants::getDepthKey(this->prototype->getMaterialFeatures());
+    this->depthShader = ShaderProgram::getShared(getShaderDefines(depthVariant, this->prototype->getVertexLayout()));
+    return this->shader != nullptr;
+}
+
+bool InstancedMesh::build()
+{
+    uint32_t geometry = this->prototype->getGeometry();
+    if (geometry == GeometryPool::INVALID)
+    {
+        std::cout << "Instanced mesh prototype has no geometry" << std::endl;
+        return false;
+    }
+    GeometryPool* pool = GeometryPool::getInstance();
+
+    glGenVertexArrays(1, &this->attributeHandle);
+    glGenVertexArrays(1, &this->depthAttributeHandle);
+    glGenBuffers(1, &this->instanceHandle);
+
+    // The depth vertex array only fetches positions, unless alpha testing needs the uvs too
+    bool alphaTest = (this->prototype->getMaterialFeatures() & ShaderVariants::ALPHA_TEST) != 0;
+    unsigned int vertexArrays[2] = { this->attributeHandle, this->depthAttributeHandle };
+    for (int i = 0; i < 2; i++)
+    {
+        glBindVertexArray(vertexArrays[i]);
+
+        // Same per-vertex layout as the prototype, sourced from its pooled buffers, draws add its base vertex
+        glBindBuffer(GL_ARRAY_BUFFER, pool->getVertexBuffer(geometry));
+        if (i == 0 || alphaTest)
+            this->prototype->getVertexLayout().apply();
+        else
+            this->prototype->getVertexLayout().applyPositions();
+
+        glBindBuffer(GL_ARRAY_BUFFER, this->instanceHandle);
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            glVertexAttribPointer(INSTANCE_ATTRIBUTE + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + column);
+            glVertexAttribDivisor(INSTANCE_ATTRIBUTE + column, 1);
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->getElementBuffer(geometry));
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cout << "GL Error after building instanced mesh" << std::endl;
+        return false;
+    }
+
+    // Anything added before build still needs uploading
+    this->dirtyBegin = 0;
+    this->dirtyEnd = this->transforms.size();
+    return true;
+}
+
+void InstancedMesh::reserve(size_t count)
+{
+    this->transforms.reserve(count);
+}
+
+size_t InstancedMesh::addInstance(const glm::mat4& transform)
+{
+    size_t instance = this->transforms.size();
+    this->transforms.push_back(transform);
+    this->originBounds.add(glm::vec3(transform[3]));
+
+    if (this->dirtyBegin == this->dirtyEnd)
+        this->dirtyBegin = instance;
+    this->dirtyEnd = instance + 1;
+    return instance;
+}
+
+void InstancedMesh::setTransform(size_t instance, const glm::mat4& transform)
+{
+    this->transforms[instance] = transform;
+    this->originBounds.add(glm::vec3(transform[3]));
+
+    if (this->dirtyBegin == this->dirtyEnd)
+    {
+        this->dirtyBegin = instance;
+        this->dirtyEnd = instance + 1;
+    }
+    else
+    {
+        this->dirtyBegin = std::min(this->dirtyBegin, instance);
+        this->dirtyEnd = std::max(this->dirtyEnd, instance + 1);
+    }
+}
+
+size_t InstancedMesh::copyChangedInstances(std::vector<glm::mat4>& out, size_t& first)
+{
+    // A grown buffer is reallocated, everything in it has to be written again
+    if (this->transforms.size() > this->copiedCount)
+    {
+        this->dirtyBegin = 0;
+        this->dirtyEnd = this->transforms.size();
+        this->copiedCount = this->transforms.size();
+    }
+
+    first = this->dirtyBegin;
+    size_t count = this->dirtyEnd - this->dirtyBegin;
+    size_t offset = out.size();
+    out.insert(out.end(), this->transforms.begin() + this->dirtyBegin, this->transforms.begin() + this->dirtyEnd);
+
+    // Quantized prototypes need their dequantizing transform applied after each instance's
+    const glm::mat4& positionTransform = this->prototype->getPositionTransform();
+    if (positionTransform != glm::mat4(1.0f))
+    {
+        for (size_t i = offset; i < out.size(); i++)
+            out[i] = out[i] * positionTransform;
+    }
+
+    this->dirtyBegin = 0;
+    this->dirtyEnd = 0;
+    return count;
+}
+
+void InstancedMesh::uploadInstances(size_t first, const glm::mat4* matrices, size_t count, StreamingBuffer& stream)
+{
+    PROFILE_ZONE("InstancedMesh upload");
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->instanceHandle);
+    if (first + count > this->instanceCapacity)
+    {
+        // Reallocate with headroom, the copy covers every instance whenever the count grew
+        this->instanceCapacity = std::max(first + count, this->instanceCapacity * 2);
+        glBufferData(GL_COPY_WRITE_BUFFER, this->instanceCapacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    // The GPU copies out of the ring in order with the draws, writing the instance buffer
+    // directly would wait for last frame's draws reading it
+    size_t offset;
+    if (stream.write(matrices, count * sizeof(glm::mat4), sizeof(glm::vec4), offset))
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, stream.getHandle());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, this->instanceHandle);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, first * sizeof(glm::mat4), count * sizeof(glm::mat4));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    else
+    {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, first * sizeof(glm::mat4), count * sizeof(glm::mat4), matrices);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void InstancedMesh::getWorldSphere(glm::vec3& center, float& radius)
+{
+    // Instance transforms only rotate and translate, so the prototype's radius covers each one
+    center = this->originBounds.getCenter();
+    radius = this->originBounds.getRadius() + this->prototype->getBoundingRadius();
+    if (this->originBounds.isEmpty())
+        radius = -1.f;
+}
+
+void InstancedMesh::submit(RenderQueue& queue)
+{
+    const std::vector<unsigned int>& textures = this->prototype->getTextures();
+    if (!this->shader || this->attributeHandle == 0 || this->transforms.empty() || textures.empty())
+        return;
+
+    unsigned int normalMap = textures.size() > 1 ? textures[1] : 0;
+    if (this->materialKey == -1)
+        this->materialKey = RenderQueue::getMaterialKey(textures[0], normalMap);
+
+    DrawPacket packet;
+    packet.program = this->shader;
+    packet.textures[0] = textures[0];
+    packet.textures[1] = normalMap;
+    packet.vertexArray = this->attributeHandle;
+    packet.elementCount = (unsigned int)this->prototype->getElementCount();
+    packet.indexType = this->prototype->getIndexType();
+    packet.baseVertex = GeometryPool::getInstance()->getBaseVertex(this->prototype->getGeometry());
+    packet.indexOffset = (unsigned int)GeometryPool::getInstance()->getIndexOffset(this->prototype->getGeometry());
+    packet.instanceCount = (unsigned int)this->transforms.size();
+    packet.model = glm::mat4(1.0f);
+
+    bool alphaTest = (this->prototype->getMaterialFeatures() & ShaderVariants::ALPHA_TEST) != 0;
+    packet.depthProgram = this->depthShader;
+    packet.depthVertexArray = this->depthAttributeHandle;
+    packet.depthTexture = alphaTest ? textures[0] : 0;
+
+    queue.submit(OPAQUE_PASS, (uint16_t)this->materialKey, packet);
+}
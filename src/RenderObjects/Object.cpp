@@ -1,30 +1,39 @@
 #include "RenderObjects/Object.h"
-#include "shaders/VertexShader.h"
-#include "shaders/FragmentShader.h"
-#include "windowing/Mainwindow.h"
-#include "Lighting/PointLight.h"
-#include "Camera/CameraController.h"
-#include "Camera/Camera.h"
+#include "shaders/ShaderProgram.h"
+#include "Rendering/RenderQueue.h"
+#include "Rendering/GeometryPool.h"
+#include "Textures/TextureManager.h"
+#include "Scene/TransformStore.h"
 
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <stb_image.h>
+#include <algorithm>
 #include <iostream>
 
+// Share of the error limit a coarser level has to stay under before it is taken
+static const float LOD_HYSTERESIS = 0.25f;
+
 Object::Object()
 {
     this->vData = nullptr;
     this->elementBufferData = nullptr;
     this->tangentData = nullptr;
 
-    this->attributeHandle = 0;
-    this->vDataHandle = 0;
-    this->elementHandle = 0;
-    this->tangentHandle = 0;
-    this->shaderProgramHandle = 0;
+    this->geometry = GeometryPool::INVALID;
+    this->indexType = GL_UNSIGNED_INT;
+    this->lod = 0;
+    this->layout = VertexLayout::compact();
+    this->positionTransform = glm::mat4(1.0f);
+    this->boundingRadius = 0.f;
+    this->occluder = nullptr;
+    this->shader = nullptr;
+    this->depthShader = nullptr;
+    this->shaderVariant = 0;
+    this->materialFeatures = ShaderVariants::SPECULAR;
+    this->materialKey = -1;
+
+    this->transform = TransformStore::getInstance()->create();
 
     this->dataSize = 0;
     this->elementSize = 0;
@@ -40,11 +49,20 @@ Object::Object(float* vcData, unsigned int* elementData, float* tangentData, siz
     this->elementSize = eSize;
     this->tangentSize = tangentSize;
 
-    this->attributeHandle = 0;
-    this->vDataHandle = 0;
-    this->elementHandle = 0;
-    this->tangentHandle = 0;
-    this->shaderProgramHandle = 0;
+    this->geometry = GeometryPool::INVALID;
+    this->indexType = GL_UNSIGNED_INT;
+    this->lod = 0;
+    this->layout = VertexLayout::compact();
+    this->positionTransform = glm::mat4(1.0f);
+    this->boundingRadius = 0.f;
+    this->occluder = nullptr;
+    this->shader = nullptr;
+    this->depthShader = nullptr;
+    this->shaderVariant = 0;
+    this->materialFeatures = ShaderVariants::SPECULAR;
+    this->materialKey = -1;
+
+    this->transform = TransformStore::getInstance()->create();
 }
 
 Object::~Object()
@@ -56,264 +74,188 @@ Object::~Object()
     if (this->tangentData)
         delete this->tangentData;
 
-    if (this->attributeHandle != 0)
-        glDeleteVertexArrays(1, &this->attributeHandle);
-    if (this->vDataHandle != 0)
-        glDeleteBuffers(1, &this->vDataHandle);
-    if (this->elementHandle != 0)
-        glDeleteBuffers(1, &this->elementHandle);
-    if (this->tangentHandle != 0)
-        glDeleteBuffers(1, &this->tangentHandle);
-    if (this->shaderProgramHandle != 0)
-        glDeleteProgram(this->shaderProgramHandle);
+    GeometryPool::getInstance()->free(this->geometry);
 
     for (unsigned int handle : this->textureHandles)
-    {
-        if (handle != 0)
-            glDeleteTextures(1, &handle);
-    }
-
-    for (PointLight* light : this->affectingLights)
-    {
-        delete light;
-    }
+        TextureManager::getInstance()->release(handle);
+    TransformStore::getInstance()->destroy(this->transform);
 }
 
-void Object::addAffectingLight(PointLight* light)
+void Object::setLocation(float x, float y, float z)
 {
-    this->affectingLights.push_back(light);
+    TransformStore::getInstance()->setPosition(this->transform, glm::vec3(x, y, z));
 }
 
-bool Object::loadTexture(const char* path) {
-    this->textureHandles.push_back(0);
-    unsigned int* textureHandle = &this->textureHandles[this->textureHandles.size() - 1];
-    glGenTextures(1, textureHandle);
-    glBindTexture(GL_TEXTURE_2D, *textureHandle);
-
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // Trilinear filtering
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // Load image using stb_image
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true); // Flip texture vertically
-    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-    if (data) {
-        GLenum format = (nrChannels == 3) ? GL_RGB : GL_RGBA;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        std::cout << "Failed to load texture: " << path << std::endl;
+bool Object::loadTexture(const char* path, bool normalMap)
+{
+    unsigned int handle = TextureManager::getInstance()->acquire(path, normalMap ? TextureManager::NORMAL_TEXTURE : TextureManager::COLOR_TEXTURE);
+    if (handle == 0)
         return false;
-    }
 
-    stbi_image_free(data);
+    this->textureHandles.push_back(handle);
+    if (normalMap)
+        this->materialFeatures |= ShaderVariants::NORMAL_MAP;
+    this->materialKey = -1;
     return true;
 }
 
-bool Object::compileShader()
+void Object::setSpecular(bool specular)
 {
-    if (!vertexShader || !fragmentShader) {
-        std::cout << "Shader source is null" << std::endl;
-        return false;
-    }
-
-    // Compile vertex shader
-    unsigned int vertexShaderHandle = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShaderHandle, 1, &vertexShader, nullptr);
-    glCompileShader(vertexShaderHandle);
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShaderHandle, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShaderHandle, 512, nullptr, infoLog);
-        std::cout << "Vertex Shader compilation failed: " << infoLog << std::endl;
-        return false;
-    }
+    if (specular)
+        this->materialFeatures |= ShaderVariants::SPECULAR;
+    else
+        this->materialFeatures &= ~(uint32_t)ShaderVariants::SPECULAR;
+}
 
-    // Compile fragment shader
-    unsigned int fragmentShaderHandle = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShaderHandle, 1, &fragmentShader, nullptr);
-    glCompileShader(fragmentShaderHandle);
-    glGetShaderiv(fragmentShaderHandle, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShaderHandle, 512, nullptr, infoLog);
-        std::cout << "Fragment Shader compilation failed: " << infoLog << std::endl;
-        return false;
-    }
+void Object::setAlphaTest(bool alphaTest)
+{
+    if (alphaTest)
+        this->materialFeatures |= ShaderVariants::ALPHA_TEST;
+    else
+        this->materialFeatures &= ~(uint32_t)ShaderVariants::ALPHA_TEST;
+}
 
-    // Link shaders into program
-    this->shaderProgramHandle = glCreateProgram();
-    glAttachShader( this->shaderProgramHandle, vertexShaderHandle);
-    glAttachShader( this->shaderProgramHandle, fragmentShaderHandle);
-    glLinkProgram( this->shaderProgramHandle);
-    glGetProgramiv( this->shaderProgramHandle, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog( this->shaderProgramHandle, 512, nullptr, infoLog);
-        std::cout << "Shader Program linking failed: " << infoLog << std::endl;
-        return false;
-    }
-    glDeleteShader(vertexShaderHandle);
-    glDeleteShader(fragmentShaderHandle);
+std::string Object::getShaderDefines(uint32_t variant, const VertexLayout& layout)
+{
+    // Depth-only programs read nothing the layout changes, every layout shares them
+    if (variant & ShaderVariants::DEPTH_ONLY)
+        return ShaderVariants::getDefines(variant);
+    return ShaderVariants::getDefines(variant) + layout.getDefines();
+}
 
-    return true;
+bool Object::compileShader(uint32_t lighting)
+{
+    // Programs are shared per define set, so a variant compiles once for every object using it
+    this->shaderVariant = ShaderVariants::makeKey(this->materialFeatures, lighting);
+    this->shader = ShaderProgram::getShared(getShaderDefines(this->shaderVariant, this->layout));
+    this->depthShader = ShaderProgram::getShared(getShaderDefines(ShaderVariants::getDepthKey(this->materialFeatures), this->layout));
+    return this->shader != nullptr;
 }
 
 bool Object::buildGeometry()
 {
     if (this->vData && this->dataSize > 0 && this->elementBufferData && this->elementSize > 0)
-    {
-        glGenVertexArrays(1, &this->attributeHandle);
-        glGenBuffers(1, &this->vDataHandle);
-        glGenBuffers(1, &this->elementHandle);
-        glGenBuffers(1, &this->tangentHandle);
-        if (glGetError() != GL_NO_ERROR)
-        {
-            std::cout << "GL Error after generating buffers" << std::endl;
-            return false;
-        }
-
-        glBindVertexArray(this->attributeHandle);
-
-        // Bind and fill interleaved vertices
-        glBindBuffer(GL_ARRAY_BUFFER, this->vDataHandle);
-        glBufferData(GL_ARRAY_BUFFER, this->dataSize * sizeof(float), this->vData, GL_STATIC_DRAW);
-        if (glGetError() != GL_NO_ERROR)
-        {
-            std::cout << "GL Error after setting VBO data" << std::endl;
-            return false;
-        }
-
-        // Position attribute
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        if (glGetError() != GL_NO_ERROR)
-        {
-            std::cout << "GL Error after setting position attribute" << std::endl;
-            return false;
-        }
-
-        // TexCoord attribute
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        if (glGetError() != GL_NO_ERROR)
-        {
-            std::cout << "GL Error after setting UV attribute" << std::endl;
-            return false;
-        }
-
-        // Setup tangent buffer
-        glBindBuffer(GL_ARRAY_BUFFER, this->tangentHandle);
-        glBufferData(GL_ARRAY_BUFFER, this->tangentSize * sizeof(float), this->tangentData, GL_STATIC_DRAW);
-        if (glGetError() != GL_NO_ERROR)
-        {
-            std::cout << "GL Error after setting tangent data" << std::endl;
-            return false;
-        }
-
-        // Tangent attribute
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(2);
-        if (glGetError() != GL_NO_ERROR)
-        {
-            std::cout << "GL Error after setting tangent attribute" << std::endl;
-            return false;
-        }
-
-        // Bitangent attribute
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(3);
-        if (glGetError() != GL_NO_ERROR)
-        {
-            std::cout << "GL Error after setting bi-tangent attribute" << std::endl;
-            return false;
-        }
-
-        // Bind and fill element buffer
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->elementHandle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->elementSize * sizeof(unsigned int), this->elementBufferData, GL_STATIC_DRAW);
-        if (glGetError() != GL_NO_ERROR)
-        {
-            std::cout << "GL Error after setting EBO data" << std::endl;
-            return false;
-        }
-
-        // Reset binds
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-
-        return true;
-    }
+        return buildGeometry(this->vData, this->dataSize, this->tangentData, this->tangentSize, this->elementBufferData, this->elementSize);
     else
         return false;
 }
 
-void Object::render()
+bool Object::buildGeometry(const float* vertices, size_t vertexSize, const float* tangents, size_t tangentSize, const unsigned int* elements, size_t elementCount,
+                           const MeshLod* lods, size_t lodCount)
 {
-    if (glfwGetCurrentContext() == nullptr) {
-        std::cout << "No valid OpenGL context" << std::endl;
-        return;
+    size_t vertexCount = vertexSize / 5;
+    if (tangentSize != vertexCount * 6)
+    {
+        std::cout << "Tangent data doesn't match the vertex count" << std::endl;
+        return false;
     }
+    this->elementSize = elementCount;
 
-    if (this->shaderProgramHandle != 0 && this->attributeHandle != 0 && this->vDataHandle != 0 && this->elementHandle != 0)
+    this->lods.assign(lods, lods + lodCount);
+    if (this->lods.empty())
     {
-        glUseProgram(this->shaderProgramHandle);
-        if (glGetError() != GL_NO_ERROR) std::cout << "GL Error after use program" << std::endl;
-
-        bindTexturesForRender();
-
-        setLightingInShader();
-
-        glm::mat4 model = glm::rotate(glm::mat4(1.0f), (float)glfwGetTime(), glm::vec3(0.5f, 1.0f, 0.0f));
-
-        // TODO: Set view and projection of camera to UBO (universal buffer object)?
-        Camera* cam = CameraController::getInstance()->getActiveCamera();
-
-        // Pass matrices to shader
-        glUniformMatrix4fv(glGetUniformLocation(this->shaderProgramHandle, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(glGetUniformLocation(this->shaderProgramHandle, "view"), 1, GL_FALSE, glm::value_ptr(cam->getView()));
-        glUniformMatrix4fv(glGetUniformLocation(this->shaderProgramHandle, "projection"), 1, GL_FALSE, glm::value_ptr(cam->getProjection()));
+        MeshLod full;
+        full.indexCount = elementCount;
+        this->lods.push_back(full);
+    }
+    this->lod = 0;
 
-        glBindVertexArray(this->attributeHandle);
-        if (glGetError() != GL_NO_ERROR) std::cout << "GL Error after bind VAO" << std::endl;
+    this->localBounds = Bounds();
+    this->boundingRadius = 0.f;
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        glm::vec3 position(vertices[i * 5], vertices[i * 5 + 1], vertices[i * 5 + 2]);
+        this->localBounds.add(position);
+        this->boundingRadius = std::max(this->boundingRadius, glm::length(position));
+    }
 
-        glDrawElements(GL_TRIANGLES, this->elementSize, GL_UNSIGNED_INT, 0);
-        if (glGetError() != GL_NO_ERROR) std::cout << "GL Error after draw" << std::endl;
+    // Everything goes into one interleaved stream in the object's layout
+    std::vector<unsigned char> packedVertices;
+    this->layout.encode(vertices, tangents, vertexCount, packedVertices, this->positionTransform);
 
+    // Indices are relative to the mesh's base vertex, 16 bit whenever every vertex is addressable with it
+    GeometryPool::getInstance()->free(this->geometry);
+    if (vertexCount <= 65536)
+    {
+        std::vector<uint16_t> shortElements(elements, elements + elementCount);
+        this->geometry = GeometryPool::getInstance()->allocate(this->layout, packedVertices.data(), vertexCount, shortElements.data(), elementCount * sizeof(uint16_t));
+        this->indexType = GL_UNSIGNED_SHORT;
     }
+    else
+    {
+        this->geometry = GeometryPool::getInstance()->allocate(this->layout, packedVertices.data(), vertexCount, elements, elementCount * sizeof(unsigned int));
+        this->indexType = GL_UNSIGNED_INT;
+    }
+
+    return this->geometry != GeometryPool::INVALID;
 }
 
-void Object::bindTexturesForRender()
+void Object::getWorldSphere(glm::vec3& center, float& radius)
 {
-    // Bind textures
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, this->textureHandles[0]);
-    glUniform1i(glGetUniformLocation(this->shaderProgramHandle, "texture1"), 0);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, this->textureHandles[1]);
-    glUniform1i(glGetUniformLocation(this->shaderProgramHandle, "normalMap"), 1);
+    // As of the last TransformStore update
+    const glm::mat4& world = TransformStore::getInstance()->getWorld(this->transform);
+    float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+    center = glm::vec3(world[3]);
+    radius = this->boundingRadius * scale;
 }
 
-void Object::setLightingInShader()
+void Object::selectLod(const glm::vec3& eye, float pixelScale, float maxErrorPixels)
 {
-    // Set lighting uniforms
-    std::vector<glm::vec3> lightPositions;
-    for (PointLight* light : this->affectingLights)
-    {
-        lightPositions.push_back(glm::vec3(light->getX(), light->getY(), light->getZ()));
-    }
+    glm::vec3 center;
+    float radius;
+    getWorldSphere(center, radius);
 
-    std::vector<glm::vec3> lightColors;
-    for (PointLight* light : this->affectingLights)
+    // From the nearest point of the bounds, inside them nothing but full detail is safe
+    float distance = glm::length(center - eye) - radius;
+    if (this->lods.size() < 2 || maxErrorPixels <= 0.f || distance <= 0.f)
     {
-        lightColors.push_back(glm::vec3(light->getRed(), light->getGreen(), light->getBlue()));
+        this->lod = 0;
+        return;
     }
-    
-    glm::vec3 viewPos(0.0f, 0.0f, 3.0f);
-    glUniform3fv(glGetUniformLocation(this->shaderProgramHandle, "lightPositions"), this->affectingLights.size(), &lightPositions[0][0]);
-    glUniform3fv(glGetUniformLocation(this->shaderProgramHandle, "lightColors"), this->affectingLights.size(), &lightColors[0][0]);
-    glUniform1i(glGetUniformLocation(this->shaderProgramHandle, "numLights"), (int)this->affectingLights.size());
-    glUniform3fv(glGetUniformLocation(this->shaderProgramHandle, "viewPos"), 1, glm::value_ptr(viewPos));
-}
\ No newline at end of file
+
+    // Errors are in mesh units, the world matrix scales them along with the bounding radius
+    float scale = this->boundingRadius > 0.f ? radius / this->boundingRadius : 1.f;
+    float pixelsPerUnit = pixelScale * scale / distance;
+
+    size_t level = this->lod;
+    while (level + 1 < this->lods.size() && this->lods[level + 1].error * pixelsPerUnit <= maxErrorPixels * (1.f - LOD_HYSTERESIS))
+        level++;
+    while (level > 0 && this->lods[level].error * pixelsPerUnit > maxErrorPixels)
+        level--;
+    this->lod = level;
+}
+
+void Object::submit(RenderQueue& queue)
+{
+    if (!this->shader || this->geometry == GeometryPool::INVALID || this->textureHandles.empty())
+        return;
+
+    // A material without a normal map binds no texture to that unit
+    unsigned int normalMap = this->textureHandles.size() > 1 ? this->textureHandles[1] : 0;
+    if (this->materialKey == -1)
+        this->materialKey = RenderQueue::getMaterialKey(this->textureHandles[0], normalMap);
+
+    DrawPacket packet;
+    packet.program = this->shader;
+    packet.textures[0] = this->textureHandles[0];
+    packet.textures[1] = normalMap;
+    GeometryPool* pool = GeometryPool::getInstance();
+    packet.vertexArray = pool->getVertexArray(this->geometry);
+    const MeshLod& lod = this->lods[this->lod];
+    size_t indexSize = this->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    packet.elementCount = (unsigned int)lod.indexCount;
+    packet.indexType = this->indexType;
+    packet.baseVertex = pool->getBaseVertex(this->geometry);
+    packet.indexOffset = (unsigned int)(pool->getIndexOffset(this->geometry) + lod.firstIndex * indexSize);
+    packet.instanceCount = 0;
+
+    // Alpha-tested depth draws need the uvs, so only the others use the position-only vertex array
+    bool alphaTest = (this->materialFeatures & ShaderVariants::ALPHA_TEST) != 0;
+    packet.depthProgram = this->depthShader;
+    packet.depthVertexArray = alphaTest ? packet.vertexArray : pool->getDepthVertexArray(this->geometry);
+    packet.depthTexture = alphaTest ? packet.textures[0] : 0;
+
+    packet.model = TransformStore::getInstance()->getWorld(this->transform) * this->positionTransform;
+
+    queue.submit(OPAQUE_PASS, (uint16_t)this->materialKey, packet);
+}
@@ -0,0 +1,88 @@
+#include "Rendering/CommandList.h"
+
+#include <cstring>
+
+// Commands hold pointers, keep every one of them 8 byte aligned
+static const size_t COMMAND_ALIGNMENT = 8;
+static const size_t INITIAL_CAPACITY = 16 * 1024;
+
+CommandList::CommandList()
+{
+    this->capacity = 0;
+    this->used = 0;
+}
+
+template <typename T> T* CommandList::allocate(CommandType type)
+{
+    size_t size = (sizeof(T) + COMMAND_ALIGNMENT - 1) & ~(COMMAND_ALIGNMENT - 1);
+    if (this->used + size > this->capacity)
+    {
+        // Commands are plain data, growing is a copy
+        size_t capacity = this->capacity == 0 ? INITIAL_CAPACITY : this->capacity * 2;
+        while (capacity < this->used + size)
+            capacity *= 2;
+
+        std::unique_ptr<uint8_t[]> memory(new uint8_t[capacity]);
+        if (this->used > 0)
+            std::memcpy(memory.get(), this->memory.get(), this->used);
+        this->memory = std::move(memory);
+        this->capacity = capacity;
+    }
+
+    T* command = reinterpret_cast<T*>(this->memory.get() + this->used);
+    command->header.type = type;
+    command->header.size = (uint16_t)size;
+    this->used += size;
+    return command;
+}
+
+void CommandList::bindProgram(ShaderProgram* program)
+{
+    allocate<BindProgramCommand>(BIND_PROGRAM_COMMAND)->program = program;
+}
+
+void CommandList::bindUniformBlock(uint32_t binding, uint32_t buffer)
+{
+    BindUniformBlockCommand* command = allocate<BindUniformBlockCommand>(BIND_UNIFORM_BLOCK_COMMAND);
+    command->binding = binding;
+    command->buffer = buffer;
+}
+
+void CommandList::bindTexture(uint32_t unit, uint32_t texture)
+{
+    BindTextureCommand* command = allocate<BindTextureCommand>(BIND_TEXTURE_COMMAND);
+    command->unit = unit;
+    command->texture = texture;
+}
+
+void CommandList::bindVertexArray(uint32_t vertexArray)
+{
+    allocate<BindVertexArrayCommand>(BIND_VERTEX_ARRAY_COMMAND)->vertexArray = vertexArray;
+}
+
+void CommandList::setModel(int32_t location, const float* model)
+{
+    SetModelCommand* command = allocate<SetModelCommand>(SET_MODEL_COMMAND);
+    command->location = location;
+    std::memcpy(command->model, model, sizeof(command->model));
+}
+
+void CommandList::setPassState(uint32_t pass, uint32_t depthFunc, bool depthWrite, bool colorWrite, bool additiveBlend)
+{
+    SetPassStateCommand* command = allocate<SetPassStateCommand>(SET_PASS_STATE_COMMAND);
+    command->pass = pass;
+    command->depthFunc = depthFunc;
+    command->depthWrite = depthWrite ? 1 : 0;
+    command->colorWrite = colorWrite ? 1 : 0;
+    command->additiveBlend = additiveBlend ? 1 : 0;
+}
+
+void CommandList::draw(uint32_t elementCount, uint32_t indexType, int32_t baseVertex, uint32_t indexOffset, uint32_t instanceCount)
+{
+    DrawCommand* command = allocate<DrawCommand>(DRAW_COMMAND);
+    command->elementCount = elementCount;
+    command->indexType = indexType;
+    command->baseVertex = baseVertex;
+    command->indexOffset = indexOffset;
+    command->instanceCount = instanceCount;
+}
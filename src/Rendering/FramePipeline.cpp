@@ -0,0 +1,136 @@
+#include "Rendering/FramePipeline.h"
+#include "Jobs/JobSystem.h"
+#include "Profiling/Profiler.h"
+
+#include <algorithm>
+
+const int FramePipeline::MAX_DEPTH;
+
+FramePipeline::FramePipeline()
+{
+    this->depth = 0;
+    this->nextFrame = 0;
+    this->finished = true;
+    this->stopping = false;
+}
+
+FramePipeline::~FramePipeline()
+{
+    stop();
+}
+
+void FramePipeline::start(int depth, SimulateFunction simulate)
+{
+    stop();
+
+    this->depth = std::max(0, std::min(MAX_DEPTH, depth));
+    this->simulate = simulate;
+    this->nextFrame = 0;
+    this->finished = false;
+    this->stopping = false;
+
+    while ((int)this->snapshots.size() < this->depth + 1)
+        this->snapshots.emplace_back(new FrameSnapshot());
+
+    this->freeFrames.clear();
+    this->readyFrames.clear();
+    for (int i = 0; i <= this->depth; i++)
+        this->freeFrames.push_back(this->snapshots[i].get());
+
+    if (this->depth > 0)
+        this->simulationThread = std::thread(&FramePipeline::simulationLoop, this);
+}
+
+void FramePipeline::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->frameFree.notify_all();
+
+    if (this->simulationThread.joinable())
+        this->simulationThread.join();
+
+    this->finished = true;
+    this->readyFrames.clear();
+    this->freeFrames.clear();
+}
+
+FrameSnapshot* FramePipeline::acquire()
+{
+    if (this->depth == 0)
+    {
+        if (this->finished)
+            return nullptr;
+
+        FrameSnapshot* frame = this->snapshots[0].get();
+        frame->frame = this->nextFrame++;
+        if (!this->simulate(*frame))
+        {
+            this->finished = true;
+            return nullptr;
+        }
+        return frame;
+    }
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->frameReady.wait(lock, [this] { return !this->readyFrames.empty() || this->finished; });
+    if (this->readyFrames.empty())
+        return nullptr;
+
+    FrameSnapshot* frame = this->readyFrames.front();
+    this->readyFrames.pop_front();
+    return frame;
+}
+
+void FramePipeline::release(FrameSnapshot* frame)
+{
+    if (this->depth == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->freeFrames.push_back(frame);
+    }
+    this->frameFree.notify_one();
+}
+
+void FramePipeline::simulationLoop()
+{
+    // Parallel scene work queues jobs from here like it would from the GL thread
+    bool attached = JobSystem::getInstance()->attachThread();
+    PROFILE_THREAD("Simulation thread");
+
+    while (true)
+    {
+        FrameSnapshot* frame;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->frameFree.wait(lock, [this] { return !this->freeFrames.empty() || this->stopping; });
+            if (this->stopping)
+                break;
+
+            frame = this->freeFrames.front();
+            this->freeFrames.pop_front();
+        }
+
+        frame->frame = this->nextFrame++;
+        bool simulated = this->simulate(*frame);
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (simulated)
+                this->readyFrames.push_back(frame);
+            else
+                this->finished = true;
+        }
+        this->frameReady.notify_one();
+
+        if (!simulated)
+            break;
+    }
+
+    if (attached)
+        JobSystem::getInstance()->detachThread();
+}
@@ -0,0 +1,66 @@
+#include "Rendering/FrameUniformBuffer.h"
+#include "Camera/Camera.h"
+#include "Lighting/LightClusterGrid.h"
+#include "Rendering/StreamingBuffer.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <iostream>
+
+// std140 layout of the FrameData block, every member is 16 byte aligned
+struct FrameUniformData
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 cameraPosition;
+    glm::vec4 frameTime;
+    glm::ivec4 lightCount;
+    glm::ivec4 clusterDims;
+    glm::vec4 clusterParams;
+};
+
+static_assert(sizeof(FrameUniformData) == 3 * 64 + 5 * 16, "FrameUniformData does not match std140 layout");
+
+FrameUniformBuffer::FrameUniformBuffer()
+{
+    this->stream = nullptr;
+    this->alignment = 1;
+}
+
+bool FrameUniformBuffer::init(StreamingBuffer* stream)
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cout << "GL Error after querying uniform buffer alignment" << std::endl;
+        return false;
+    }
+
+    this->stream = stream;
+    this->alignment = alignment > 0 ? (size_t)alignment : 1;
+    return true;
+}
+
+void FrameUniformBuffer::update(Camera* cam, LightClusterGrid* lightGrid, float time, float deltaTime)
+{
+    FrameUniformData data;
+    data.view = cam->getView();
+    data.projection = cam->getProjection();
+    data.viewProjection = data.projection * data.view;
+    data.cameraPosition = glm::vec4(cam->getPosition(), 1.0f);
+    data.frameTime = glm::vec4(time, deltaTime, 0.0f, 0.0f);
+    data.lightCount = glm::ivec4(lightGrid->getLightCount(), 0, 0, 0);
+    data.clusterDims = glm::ivec4(LightClusterGrid::GRID_X, LightClusterGrid::GRID_Y, LightClusterGrid::GRID_Z, 0);
+    data.clusterParams = glm::vec4(lightGrid->getSliceScale(), lightGrid->getSliceBias(), lightGrid->getTileWidth(), lightGrid->getTileHeight());
+
+    // A fresh range every frame, frames still in flight keep reading theirs
+    size_t offset;
+    if (!this->stream->write(&data, sizeof(FrameUniformData), this->alignment, offset))
+    {
+        std::cout << "No streaming buffer space for frame uniforms" << std::endl;
+        return;
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, BINDING_POINT, this->stream->getHandle(), offset, sizeof(FrameUniformData));
+}
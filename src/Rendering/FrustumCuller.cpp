@@ -0,0 +1,215 @@
+#include "Rendering/FrustumCuller.h"
+#include "Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUMCULLER_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRUSTUMCULLER_SSE2
+#endif
+
+// Kernel width, the arrays are padded to it
+static const size_t BATCH = 8;
+// Below this many spheres one thread finishes before jobs would be picked up
+static const size_t PARALLEL_SPHERE_THRESHOLD = 65536;
+// Spheres per job, a multiple of BATCH so ranges never split a kernel iteration
+static const size_t SPHERES_PER_JOB = 16384;
+// Padding spheres fail every plane test
+static const float NEVER_VISIBLE_RADIUS = -1e30f;
+
+// Spreads a 4 bit lane mask to one 0/1 byte per lane (bit i lands on bit 8i), stored little endian
+static inline void storeLanes(uint8_t* out, int mask)
+{
+    uint32_t bytes = ((uint32_t)mask * 0x00204081u) & 0x01010101u;
+    std::memcpy(out, &bytes, 4);
+}
+
+void Bounds::add(const glm::vec3& point)
+{
+    this->min = glm::min(this->min, point);
+    this->max = glm::max(this->max, point);
+}
+
+void Bounds::add(const Bounds& other)
+{
+    if (other.isEmpty())
+        return;
+    add(other.min);
+    add(other.max);
+}
+
+void FrustumCuller::setFrustum(const glm::mat4& viewProjection)
+{
+    // glm is column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+    // Left, right, bottom, top, near, far
+    this->planes[0] = rows[3] + rows[0];
+    this->planes[1] = rows[3] - rows[0];
+    this->planes[2] = rows[3] + rows[1];
+    this->planes[3] = rows[3] - rows[1];
+    this->planes[4] = rows[3] + rows[2];
+    this->planes[5] = rows[3] - rows[2];
+
+    for (int i = 0; i < 6; i++)
+        this->planes[i] /= glm::length(glm::vec3(this->planes[i]));
+}
+
+void FrustumCuller::clear()
+{
+    resize(0);
+}
+
+void FrustumCuller::resize(size_t count)
+{
+    size_t padded = (count + BATCH - 1) / BATCH * BATCH;
+
+    // Entries past the old count may be stale padding, reset them before they become real
+    size_t keep = std::min(this->count, count);
+    this->centerX.resize(keep);
+    this->centerY.resize(keep);
+    this->centerZ.resize(keep);
+    this->radius.resize(keep);
+
+    this->centerX.resize(padded, 0.f);
+    this->centerY.resize(padded, 0.f);
+    this->centerZ.resize(padded, 0.f);
+    this->radius.resize(padded, NEVER_VISIBLE_RADIUS);
+    this->visibility.resize(padded, 0);
+    this->count = count;
+}
+
+size_t FrustumCuller::add(const glm::vec3& center, float radius)
+{
+    size_t i = this->count;
+    resize(i + 1);
+    set(i, center, radius);
+    return i;
+}
+
+void FrustumCuller::set(size_t i, const glm::vec3& center, float radius)
+{
+    this->centerX[i] = center.x;
+    this->centerY[i] = center.y;
+    this->centerZ[i] = center.z;
+    this->radius[i] = radius;
+}
+
+size_t FrustumCuller::cull()
+{
+    size_t padded = this->radius.size();
+    if (this->count < PARALLEL_SPHERE_THRESHOLD)
+    {
+        cullRange(0, padded);
+        return countVisible(0, this->count);
+    }
+
+    std::atomic<size_t> visible(0);
+    size_t batches = padded / BATCH;
+    JobSystem::getInstance()->parallelFor(batches, SPHERES_PER_JOB / BATCH, [this, &visible](size_t first, size_t last) {
+        cullRange(first * BATCH, last * BATCH);
+        visible += countVisible(first * BATCH, std::min(last * BATCH, this->count));
+    });
+    return visible.load();
+}
+
+void FrustumCuller::cullRange(size_t begin, size_t end)
+{
+#if defined(FRUSTUMCULLER_AVX)
+    __m256 px[6], py[6], pz[6], pw[6];
+    for (int p = 0; p < 6; p++)
+    {
+        px[p] = _mm256_set1_ps(this->planes[p].x);
+        py[p] = _mm256_set1_ps(this->planes[p].y);
+        pz[p] = _mm256_set1_ps(this->planes[p].z);
+        pw[p] = _mm256_set1_ps(this->planes[p].w);
+    }
+
+    const __m256 signBit = _mm256_set1_ps(-0.f);
+    for (size_t i = begin; i < end; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(&this->centerX[i]);
+        __m256 y = _mm256_loadu_ps(&this->centerY[i]);
+        __m256 z = _mm256_loadu_ps(&this->centerZ[i]);
+        __m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(&this->radius[i]), signBit);
+
+        // Same operation order as cullScalar, so both round identically
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], x), _mm256_mul_ps(py[p], y)), _mm256_mul_ps(pz[p], z)), pw[p]);
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(visible);
+        storeLanes(&this->visibility[i], mask & 0xF);
+        storeLanes(&this->visibility[i + 4], mask >> 4);
+    }
+#elif defined(FRUSTUMCULLER_SSE2)
+    __m128 px[6], py[6], pz[6], pw[6];
+    for (int p = 0; p < 6; p++)
+    {
+        px[p] = _mm_set1_ps(this->planes[p].x);
+        py[p] = _mm_set1_ps(this->planes[p].y);
+        pz[p] = _mm_set1_ps(this->planes[p].z);
+        pw[p] = _mm_set1_ps(this->planes[p].w);
+    }
+
+    const __m128 signBit = _mm_set1_ps(-0.f);
+    for (size_t i = begin; i < end; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&this->centerX[i]);
+        __m128 y = _mm_loadu_ps(&this->centerY[i]);
+        __m128 z = _mm_loadu_ps(&this->centerZ[i]);
+        __m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(&this->radius[i]), signBit);
+
+        // Same operation order as cullScalar, so both round identically
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)), _mm_mul_ps(pz[p], z)), pw[p]);
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        storeLanes(&this->visibility[i], _mm_movemask_ps(visible));
+    }
+#else
+    cullScalarRange(begin, end);
+#endif
+}
+
+size_t FrustumCuller::cullScalar()
+{
+    cullScalarRange(0, this->radius.size());
+    return countVisible(0, this->count);
+}
+
+void FrustumCuller::cullScalarRange(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        bool visible = true;
+        for (int p = 0; p < 6; p++)
+        {
+            const glm::vec4& plane = this->planes[p];
+            float distance = plane.x * this->centerX[i] + plane.y * this->centerY[i] + plane.z * this->centerZ[i] + plane.w;
+            visible = visible && distance >= -this->radius[i];
+        }
+        this->visibility[i] = visible ? 1 : 0;
+    }
+}
+
+size_t FrustumCuller::countVisible(size_t begin, size_t end)
+{
+    size_t visible = 0;
+    for (size_t i = begin; i < end; i++)
+        visible += this->visibility[i];
+    return visible;
+}
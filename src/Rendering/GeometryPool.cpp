@@ -0,0 +1,344 @@
+#include "Rendering/GeometryPool.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+// Size of a new buffer pair, meshes larger than this get a pair of their own size
+static const size_t VERTEX_BUFFER_BYTES = 32 * 1024 * 1024;
+static const size_t INDEX_BUFFER_BYTES = 16 * 1024 * 1024;
+// Keeps 32 bit indices aligned, 16 bit ones waste at most two bytes per mesh
+static const size_t INDEX_ALIGNMENT = 4;
+
+GeometryPool* GeometryPool::instance = nullptr;
+
+GeometryPool* GeometryPool::getInstance()
+{
+    if (!instance)
+    {
+        instance = new GeometryPool();
+    }
+
+    return instance;
+}
+
+void GeometryPool::FreeList::reset(size_t capacity, size_t used)
+{
+    this->capacity = capacity;
+    this->ranges.clear();
+    if (used < capacity)
+        this->ranges.push_back({ used, capacity - used });
+}
+
+bool GeometryPool::FreeList::allocate(size_t size, size_t alignment, size_t& offset)
+{
+    for (size_t i = 0; i < this->ranges.size(); i++)
+    {
+        Range range = this->ranges[i];
+        size_t aligned = (range.offset + alignment - 1) / alignment * alignment;
+        if (aligned + size > range.offset + range.size)
+            continue;
+
+        // What is left on either side stays free
+        size_t end = range.offset + range.size;
+        size_t tail = end - aligned - size;
+        if (aligned > range.offset)
+        {
+            this->ranges[i].size = aligned - range.offset;
+            if (tail > 0)
+                this->ranges.insert(this->ranges.begin() + i + 1, { aligned + size, tail });
+        }
+        else if (tail > 0)
+            this->ranges[i] = { aligned + size, tail };
+        else
+            this->ranges.erase(this->ranges.begin() + i);
+
+        offset = aligned;
+        return true;
+    }
+    return false;
+}
+
+void GeometryPool::FreeList::release(size_t offset, size_t size)
+{
+    auto next = std::lower_bound(this->ranges.begin(), this->ranges.end(), offset,
+                                 [](const Range& range, size_t offset) { return range.offset < offset; });
+
+    // Merge into the neighbours where they touch
+    bool joinsPrevious = next != this->ranges.begin() && (next - 1)->offset + (next - 1)->size == offset;
+    bool joinsNext = next != this->ranges.end() && offset + size == next->offset;
+    if (joinsPrevious && joinsNext)
+    {
+        (next - 1)->size += size + next->size;
+        this->ranges.erase(next);
+    }
+    else if (joinsPrevious)
+        (next - 1)->size += size;
+    else if (joinsNext)
+    {
+        next->offset = offset;
+        next->size += size;
+    }
+    else
+        this->ranges.insert(next, { offset, size });
+}
+
+size_t GeometryPool::FreeList::getFree()
+{
+    size_t free = 0;
+    for (const Range& range : this->ranges)
+        free += range.size;
+    return free;
+}
+
+size_t GeometryPool::FreeList::getLargest()
+{
+    size_t largest = 0;
+    for (const Range& range : this->ranges)
+        largest = std::max(largest, range.size);
+    return largest;
+}
+
+GeometryPool::Buffer* GeometryPool::createBuffer(const VertexLayout& layout, size_t vertexCapacity, size_t indexCapacity)
+{
+    std::unique_ptr<Buffer> buffer(new Buffer());
+    buffer->layout = layout;
+    buffer->vertices.reset(vertexCapacity, 0);
+    buffer->indices.reset(indexCapacity, 0);
+
+    glGenVertexArrays(1, &buffer->vertexArray);
+    glGenVertexArrays(1, &buffer->depthVertexArray);
+    glGenBuffers(1, &buffer->vertexBuffer);
+    glGenBuffers(1, &buffer->elementBuffer);
+
+    glBindVertexArray(buffer->vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer->vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertexCapacity * layout.getStride(), nullptr, GL_STATIC_DRAW);
+    layout.apply();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->elementBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity, nullptr, GL_STATIC_DRAW);
+
+    // Fetching only positions keeps vertex fetch of the depth pre-pass to the first attribute
+    glBindVertexArray(buffer->depthVertexArray);
+    layout.applyPositions();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->elementBuffer);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cout << "GL Error after creating geometry buffers" << std::endl;
+        glDeleteVertexArrays(1, &buffer->vertexArray);
+        glDeleteVertexArrays(1, &buffer->depthVertexArray);
+        glDeleteBuffers(1, &buffer->vertexBuffer);
+        glDeleteBuffers(1, &buffer->elementBuffer);
+        return nullptr;
+    }
+
+    this->buffers.push_back(std::move(buffer));
+    return this->buffers.back().get();
+}
+
+uint32_t GeometryPool::allocate(const VertexLayout& layout, const void* vertices, size_t vertexCount, const void* indices, size_t indexBytes)
+{
+    Allocation allocation;
+    allocation.vertexCount = vertexCount;
+    allocation.indexBytes = indexBytes;
+    allocation.live = true;
+
+    auto place = [&](uint32_t index) {
+        Buffer& buffer = *this->buffers[index];
+        if (!buffer.vertices.allocate(vertexCount, 1, allocation.firstVertex))
+            return false;
+        if (!buffer.indices.allocate(indexBytes, INDEX_ALIGNMENT, allocation.indexOffset))
+        {
+            buffer.vertices.release(allocation.firstVertex, vertexCount);
+            return false;
+        }
+        allocation.buffer = index;
+        return true;
+    };
+
+    // Any buffer of the layout with room, then one that has it once compacted, then a new one
+    bool placed = false;
+    for (uint32_t i = 0; i < this->buffers.size() && !placed; i++)
+        placed = this->buffers[i]->layout == layout && place(i);
+
+    for (uint32_t i = 0; i < this->buffers.size() && !placed; i++)
+    {
+        Buffer& buffer = *this->buffers[i];
+        if (buffer.layout == layout && buffer.vertices.getFree() >= vertexCount && buffer.indices.getFree() >= indexBytes + INDEX_ALIGNMENT)
+        {
+            defragment(i);
+            placed = place(i);
+        }
+    }
+
+    if (!placed)
+    {
+        size_t vertexCapacity = std::max(VERTEX_BUFFER_BYTES / layout.getStride(), vertexCount);
+        size_t indexCapacity = std::max(INDEX_BUFFER_BYTES, indexBytes);
+        if (!createBuffer(layout, vertexCapacity, indexCapacity) || !place((uint32_t)this->buffers.size() - 1))
+            return INVALID;
+    }
+
+    // Copy targets leave whatever vertex array is bound untouched
+    Buffer& buffer = *this->buffers[allocation.buffer];
+    size_t stride = layout.getStride();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.firstVertex * stride, vertexCount * stride, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.elementBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, indexBytes, indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cout << "GL Error after uploading pooled geometry" << std::endl;
+        buffer.vertices.release(allocation.firstVertex, vertexCount);
+        buffer.indices.release(allocation.indexOffset, indexBytes);
+        return INVALID;
+    }
+
+    uint32_t geometry;
+    if (!this->freeAllocations.empty())
+    {
+        geometry = this->freeAllocations.back();
+        this->freeAllocations.pop_back();
+        this->allocations[geometry] = allocation;
+    }
+    else
+    {
+        geometry = (uint32_t)this->allocations.size();
+        this->allocations.push_back(allocation);
+    }
+    return geometry;
+}
+
+void GeometryPool::free(uint32_t geometry)
+{
+    if (geometry >= this->allocations.size() || !this->allocations[geometry].live)
+        return;
+
+    Allocation& allocation = this->allocations[geometry];
+    Buffer& buffer = *this->buffers[allocation.buffer];
+    buffer.vertices.release(allocation.firstVertex, allocation.vertexCount);
+    buffer.indices.release(allocation.indexOffset, allocation.indexBytes);
+    allocation.live = false;
+    this->freeAllocations.push_back(geometry);
+}
+
+void GeometryPool::defragment(uint32_t index)
+{
+    Buffer& buffer = *this->buffers[index];
+    size_t stride = buffer.layout.getStride();
+
+    std::vector<Allocation*> byVertex;
+    for (Allocation& allocation : this->allocations)
+    {
+        if (allocation.live && allocation.buffer == index)
+            byVertex.push_back(&allocation);
+    }
+    std::vector<Allocation*> byIndex = byVertex;
+    std::sort(byVertex.begin(), byVertex.end(), [](Allocation* a, Allocation* b) { return a->firstVertex < b->firstVertex; });
+    std::sort(byIndex.begin(), byIndex.end(), [](Allocation* a, Allocation* b) { return a->indexOffset < b->indexOffset; });
+
+    // Packed positions, in the order the ranges already have so nothing moves up
+    std::vector<size_t> firstVertices;
+    std::vector<size_t> indexOffsets;
+    size_t vertexCount = 0;
+    size_t indexBytes = 0;
+    for (Allocation* allocation : byVertex)
+    {
+        firstVertices.push_back(vertexCount);
+        vertexCount += allocation->vertexCount;
+    }
+    for (Allocation* allocation : byIndex)
+    {
+        indexBytes = (indexBytes + INDEX_ALIGNMENT - 1) / INDEX_ALIGNMENT * INDEX_ALIGNMENT;
+        indexOffsets.push_back(indexBytes);
+        indexBytes += allocation->indexBytes;
+    }
+
+    // Ranges may overlap their new place, so everything goes through a staging buffer and back
+    if (vertexCount > 0)
+    {
+        size_t vertexBytes = vertexCount * stride;
+        size_t stagingIndexOffset = (vertexBytes + INDEX_ALIGNMENT - 1) / INDEX_ALIGNMENT * INDEX_ALIGNMENT;
+        unsigned int staging;
+        glGenBuffers(1, &staging);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, staging);
+        glBufferData(GL_COPY_WRITE_BUFFER, stagingIndexOffset + indexBytes, nullptr, GL_STREAM_COPY);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer.vertexBuffer);
+        for (size_t i = 0; i < byVertex.size(); i++)
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, byVertex[i]->firstVertex * stride, firstVertices[i] * stride, byVertex[i]->vertexCount * stride);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer.elementBuffer);
+        for (size_t i = 0; i < byIndex.size(); i++)
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, byIndex[i]->indexOffset, stagingIndexOffset + indexOffsets[i], byIndex[i]->indexBytes);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, staging);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.vertexBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, vertexBytes);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.elementBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stagingIndexOffset, 0, indexBytes);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &staging);
+        if (glGetError() != GL_NO_ERROR)
+            std::cout << "GL Error after defragmenting geometry" << std::endl;
+    }
+
+    for (size_t i = 0; i < byVertex.size(); i++)
+        byVertex[i]->firstVertex = firstVertices[i];
+    for (size_t i = 0; i < byIndex.size(); i++)
+        byIndex[i]->indexOffset = indexOffsets[i];
+    buffer.vertices.reset(buffer.vertices.capacity, vertexCount);
+    buffer.indices.reset(buffer.indices.capacity, indexBytes);
+}
+
+void GeometryPool::defragment()
+{
+    for (uint32_t i = 0; i < this->buffers.size(); i++)
+        defragment(i);
+}
+
+GeometryPool::Stats GeometryPool::getStats()
+{
+    Stats stats = {};
+    stats.buffers = this->buffers.size();
+    stats.allocations = this->allocations.size() - this->freeAllocations.size();
+
+    size_t free = 0;
+    size_t largest = 0;
+    for (const std::unique_ptr<Buffer>& buffer : this->buffers)
+    {
+        size_t stride = buffer->layout.getStride();
+        size_t vertexFree = buffer->vertices.getFree();
+        size_t indexFree = buffer->indices.getFree();
+        stats.vertexCapacity += buffer->vertices.capacity * stride;
+        stats.vertexBytes += (buffer->vertices.capacity - vertexFree) * stride;
+        stats.indexCapacity += buffer->indices.capacity;
+        stats.indexBytes += buffer->indices.capacity - indexFree;
+        stats.freeRanges += buffer->vertices.ranges.size() + buffer->indices.ranges.size();
+
+        free += vertexFree * stride + indexFree;
+        largest += buffer->vertices.getLargest() * stride + buffer->indices.getLargest();
+    }
+    stats.fragmentation = free > 0 ? 1.f - (float)largest / (float)free : 0.f;
+    return stats;
+}
+
+void GeometryPool::clear()
+{
+    for (const std::unique_ptr<Buffer>& buffer : this->buffers)
+    {
+        glDeleteVertexArrays(1, &buffer->vertexArray);
+        glDeleteVertexArrays(1, &buffer->depthVertexArray);
+        glDeleteBuffers(1, &buffer->vertexBuffer);
+        glDeleteBuffers(1, &buffer->elementBuffer);
+    }
+    this->buffers.clear();
+    this->allocations.clear();
+    this->freeAllocations.clear();
+}
@@ -0,0 +1,460 @@
+#include "Rendering/OcclusionCuller.h"
+#include "Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define OCCLUSIONCULLER_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSIONCULLER_SSE2
+#endif
+
+const int OcclusionCuller::WIDTH;
+const int OcclusionCuller::HEIGHT;
+const int OcclusionCuller::TILE_SIZE;
+const int OcclusionCuller::BLOCK_SIZE;
+
+// Pixels per kernel iteration, rows of a triangle start on a multiple of it
+#if defined(OCCLUSIONCULLER_AVX)
+static const int LANES = 8;
+#elif defined(OCCLUSIONCULLER_SSE2)
+static const int LANES = 4;
+#else
+static const int LANES = 1;
+#endif
+
+static const int TILES_X = OcclusionCuller::WIDTH / OcclusionCuller::TILE_SIZE;
+static const int TILES_Y = OcclusionCuller::HEIGHT / OcclusionCuller::TILE_SIZE;
+static const int TILE_PIXELS = OcclusionCuller::TILE_SIZE * OcclusionCuller::TILE_SIZE;
+static const int BLOCKS_X = OcclusionCuller::WIDTH / OcclusionCuller::BLOCK_SIZE;
+static const int BLOCKS_Y = OcclusionCuller::HEIGHT / OcclusionCuller::BLOCK_SIZE;
+static const int BLOCKS_PER_TILE = OcclusionCuller::TILE_SIZE / OcclusionCuller::BLOCK_SIZE;
+// Depth of pixels no occluder covers
+static const float FAR_DEPTH = 1.f;
+// Below this many boxes one thread finishes before jobs would be picked up
+static const size_t PARALLEL_BOX_THRESHOLD = 4096;
+static const size_t BOXES_PER_JOB = 2048;
+
+void OccluderMesh::set(const float* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+    this->positions.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        this->positions[i] = glm::vec3(vertices[i * 5], vertices[i * 5 + 1], vertices[i * 5 + 2]);
+    this->indices.assign(indices, indices + indexCount);
+}
+
+void OccluderMesh::setBox(const Bounds& bounds)
+{
+    // Corner c takes max on the axes whose bit is set, x = 1, y = 2, z = 4
+    static const uint32_t boxIndices[36] = {
+        4, 5, 7, 7, 6, 4,  // +z
+        1, 0, 2, 2, 3, 1,  // -z
+        5, 1, 3, 3, 7, 5,  // +x
+        0, 4, 6, 6, 2, 0,  // -x
+        6, 7, 3, 3, 2, 6,  // +y
+        0, 1, 5, 5, 4, 0   // -y
+    };
+
+    this->positions.resize(8);
+    for (int c = 0; c < 8; c++)
+        this->positions[c] = glm::vec3((c & 1) ? bounds.max.x : bounds.min.x, (c & 2) ? bounds.max.y : bounds.min.y, (c & 4) ? bounds.max.z : bounds.min.z);
+    this->indices.assign(boxIndices, boxIndices + 36);
+}
+
+void OccluderMesh::clear()
+{
+    this->positions.clear();
+    this->indices.clear();
+}
+
+OcclusionCuller::OcclusionCuller()
+{
+    this->viewProjection = glm::mat4(1.0f);
+    this->bins.resize(TILES_X * TILES_Y);
+    this->depth.assign(WIDTH * HEIGHT, FAR_DEPTH);
+    this->blockMax.assign(BLOCKS_X * BLOCKS_Y, FAR_DEPTH);
+    this->tileMax.assign(TILES_X * TILES_Y, FAR_DEPTH);
+}
+
+void OcclusionCuller::begin(const glm::mat4& viewProjection)
+{
+    this->viewProjection = viewProjection;
+    this->triangles.clear();
+    for (std::vector<uint32_t>& bin : this->bins)
+        bin.clear();
+}
+
+size_t OcclusionCuller::addOccluder(const OccluderMesh& mesh, const glm::mat4& model)
+{
+    glm::mat4 transform = this->viewProjection * model;
+    this->clipPositions.resize(mesh.positions.size());
+    for (size_t i = 0; i < mesh.positions.size(); i++)
+        this->clipPositions[i] = transform * glm::vec4(mesh.positions[i], 1.f);
+
+    size_t before = this->triangles.size();
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        const glm::vec4* corners[3] = { &this->clipPositions[mesh.indices[i]], &this->clipPositions[mesh.indices[i + 1]], &this->clipPositions[mesh.indices[i + 2]] };
+        int inFront = 0;
+        for (int c = 0; c < 3; c++)
+            inFront += corners[c]->z >= -corners[c]->w ? 1 : 0;
+
+        if (inFront == 3)
+            addTriangle(*corners[0], *corners[1], *corners[2]);
+        if (inFront == 0 || inFront == 3)
+            continue;
+
+        // Cut at the near plane (z = -w), leaving a triangle or a quad
+        glm::vec4 polygon[4];
+        int count = 0;
+        for (int c = 0; c < 3; c++)
+        {
+            const glm::vec4& p = *corners[c];
+            const glm::vec4& q = *corners[(c + 1) % 3];
+            float dp = p.z + p.w;
+            float dq = q.z + q.w;
+            if (dp >= 0.f)
+                polygon[count++] = p;
+            if ((dp >= 0.f) != (dq >= 0.f))
+                polygon[count++] = p + (q - p) * (dp / (dp - dq));
+        }
+        for (int k = 1; k + 1 < count; k++)
+            addTriangle(polygon[0], polygon[k], polygon[k + 1]);
+    }
+    return this->triangles.size() - before;
+}
+
+void OcclusionCuller::addTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2)
+{
+    // To depth buffer pixels, y up like the viewport, and window depth in [0, 1]
+    const glm::vec4* clip[3] = { &v0, &v1, &v2 };
+    float x[3], y[3], z[3];
+    for (int i = 0; i < 3; i++)
+    {
+        if (clip[i]->w <= 0.f)
+            return;
+        float invW = 1.f / clip[i]->w;
+        x[i] = (clip[i]->x * invW * 0.5f + 0.5f) * WIDTH;
+        y[i] = (clip[i]->y * invW * 0.5f + 0.5f) * HEIGHT;
+        z[i] = clip[i]->z * invW * 0.5f + 0.5f;
+    }
+
+    // Counter-clockwise on screen is front facing, back faces and slivers cover nothing
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(area > 0.f))
+        return;
+
+    // Pixels whose centers fall inside the triangle's bounds
+    float left = std::max(std::ceil(std::min(x[0], std::min(x[1], x[2])) - 0.5f), 0.f);
+    float right = std::min(std::floor(std::max(x[0], std::max(x[1], x[2])) - 0.5f), WIDTH - 1.f);
+    float bottom = std::max(std::ceil(std::min(y[0], std::min(y[1], y[2])) - 0.5f), 0.f);
+    float top = std::min(std::floor(std::max(y[0], std::max(y[1], y[2])) - 0.5f), HEIGHT - 1.f);
+    if (left > right || bottom > top)
+        return;
+
+    Triangle triangle;
+    for (int i = 0; i < 3; i++)
+    {
+        int j = (i + 1) % 3;
+        triangle.edgeA[i] = y[i] - y[j];
+        triangle.edgeB[i] = x[j] - x[i];
+        triangle.edgeC[i] = x[i] * y[j] - y[i] * x[j];
+    }
+    triangle.depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    triangle.depthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+    triangle.depthC = z[0] - triangle.depthA * x[0] - triangle.depthB * y[0];
+    triangle.minX = (int)left;
+    triangle.maxX = (int)right;
+    triangle.minY = (int)bottom;
+    triangle.maxY = (int)top;
+
+    uint32_t index = (uint32_t)this->triangles.size();
+    this->triangles.push_back(triangle);
+    for (int ty = triangle.minY / TILE_SIZE; ty <= triangle.maxY / TILE_SIZE; ty++)
+    {
+        for (int tx = triangle.minX / TILE_SIZE; tx <= triangle.maxX / TILE_SIZE; tx++)
+            this->bins[ty * TILES_X + tx].push_back(index);
+    }
+}
+
+void OcclusionCuller::rasterize(bool parallel)
+{
+    size_t tileCount = TILES_X * TILES_Y;
+    if (!parallel)
+    {
+        for (size_t tile = 0; tile < tileCount; tile++)
+            rasterizeTile(tile);
+        return;
+    }
+
+    JobSystem::getInstance()->parallelFor(tileCount, 1, [this](size_t first, size_t last) {
+        for (size_t tile = first; tile < last; tile++)
+            rasterizeTile(tile);
+    });
+}
+
+void OcclusionCuller::rasterizeTile(size_t tile)
+{
+#if defined(OCCLUSIONCULLER_AVX) || defined(OCCLUSIONCULLER_SSE2)
+    int tileX = (int)(tile % TILES_X) * TILE_SIZE;
+    int tileY = (int)(tile / TILES_X) * TILE_SIZE;
+    float* tileDepth = &this->depth[tile * TILE_PIXELS];
+    std::fill(tileDepth, tileDepth + TILE_PIXELS, FAR_DEPTH);
+
+    for (uint32_t index : this->bins[tile])
+    {
+        const Triangle& triangle = this->triangles[index];
+        // Rows start on a kernel boundary, the tile is a whole number of kernels wide
+        int x0 = std::max(triangle.minX, tileX) & ~(LANES - 1);
+        int x1 = std::min(triangle.maxX, tileX + TILE_SIZE - 1);
+        int y0 = std::max(triangle.minY, tileY);
+        int y1 = std::min(triangle.maxY, tileY + TILE_SIZE - 1);
+
+#if defined(OCCLUSIONCULLER_AVX)
+        const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        const __m256 zero = _mm256_setzero_ps();
+        __m256 a0 = _mm256_set1_ps(triangle.edgeA[0]);
+        __m256 a1 = _mm256_set1_ps(triangle.edgeA[1]);
+        __m256 a2 = _mm256_set1_ps(triangle.edgeA[2]);
+        __m256 c0 = _mm256_set1_ps(triangle.edgeC[0]);
+        __m256 c1 = _mm256_set1_ps(triangle.edgeC[1]);
+        __m256 c2 = _mm256_set1_ps(triangle.edgeC[2]);
+        __m256 depthA = _mm256_set1_ps(triangle.depthA);
+        __m256 depthC = _mm256_set1_ps(triangle.depthC);
+        for (int y = y0; y <= y1; y++)
+        {
+            float py = (float)y + 0.5f;
+            __m256 b0 = _mm256_set1_ps(triangle.edgeB[0] * py);
+            __m256 b1 = _mm256_set1_ps(triangle.edgeB[1] * py);
+            __m256 b2 = _mm256_set1_ps(triangle.edgeB[2] * py);
+            __m256 depthB = _mm256_set1_ps(triangle.depthB * py);
+            float* row = tileDepth + (y - tileY) * TILE_SIZE;
+            for (int x = x0; x <= x1; x += LANES)
+            {
+                // Same operation order as rasterizeTileScalar, so both round identically
+                __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+                __m256 e0 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a0, px), b0), c0);
+                __m256 e1 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a1, px), b1), c1);
+                __m256 e2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a2, px), b2), c2);
+                __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+                                              _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+                __m256 z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(depthA, px), depthB), depthC);
+                __m256 current = _mm256_loadu_ps(row + (x - tileX));
+                _mm256_storeu_ps(row + (x - tileX), _mm256_blendv_ps(current, _mm256_min_ps(current, z), inside));
+            }
+        }
+#else
+        const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 a0 = _mm_set1_ps(triangle.edgeA[0]);
+        __m128 a1 = _mm_set1_ps(triangle.edgeA[1]);
+        __m128 a2 = _mm_set1_ps(triangle.edgeA[2]);
+        __m128 c0 = _mm_set1_ps(triangle.edgeC[0]);
+        __m128 c1 = _mm_set1_ps(triangle.edgeC[1]);
+        __m128 c2 = _mm_set1_ps(triangle.edgeC[2]);
+        __m128 depthA = _mm_set1_ps(triangle.depthA);
+        __m128 depthC = _mm_set1_ps(triangle.depthC);
+        for (int y = y0; y <= y1; y++)
+        {
+            float py = (float)y + 0.5f;
+            __m128 b0 = _mm_set1_ps(triangle.edgeB[0] * py);
+            __m128 b1 = _mm_set1_ps(triangle.edgeB[1] * py);
+            __m128 b2 = _mm_set1_ps(triangle.edgeB[2] * py);
+            __m128 depthB = _mm_set1_ps(triangle.depthB * py);
+            float* row = tileDepth + (y - tileY) * TILE_SIZE;
+            for (int x = x0; x <= x1; x += LANES)
+            {
+                // Same operation order as rasterizeTileScalar, so both round identically
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+                __m128 e0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, px), b0), c0);
+                __m128 e1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a1, px), b1), c1);
+                __m128 e2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a2, px), b2), c2);
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(depthA, px), depthB), depthC);
+                __m128 current = _mm_loadu_ps(row + (x - tileX));
+                __m128 nearer = _mm_min_ps(current, z);
+                _mm_storeu_ps(row + (x - tileX), _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+            }
+        }
+#endif
+    }
+
+    updateMaxima(tile);
+#else
+    rasterizeTileScalar(tile);
+#endif
+}
+
+void OcclusionCuller::rasterizeScalar()
+{
+    for (size_t tile = 0; tile < (size_t)(TILES_X * TILES_Y); tile++)
+        rasterizeTileScalar(tile);
+}
+
+void OcclusionCuller::rasterizeTileScalar(size_t tile)
+{
+    int tileX = (int)(tile % TILES_X) * TILE_SIZE;
+    int tileY = (int)(tile / TILES_X) * TILE_SIZE;
+    float* tileDepth = &this->depth[tile * TILE_PIXELS];
+    std::fill(tileDepth, tileDepth + TILE_PIXELS, FAR_DEPTH);
+
+    for (uint32_t index : this->bins[tile])
+    {
+        const Triangle& triangle = this->triangles[index];
+        // Covers the same pixels as the kernel, whole kernels from a kernel boundary
+        int x0 = std::max(triangle.minX, tileX) & ~(LANES - 1);
+        int x1 = std::min(triangle.maxX, tileX + TILE_SIZE - 1);
+        int xEnd = x0 + (x1 - x0 + LANES) / LANES * LANES;
+        int y0 = std::max(triangle.minY, tileY);
+        int y1 = std::min(triangle.maxY, tileY + TILE_SIZE - 1);
+        for (int y = y0; y <= y1; y++)
+        {
+            float py = (float)y + 0.5f;
+            float* row = tileDepth + (y - tileY) * TILE_SIZE;
+            for (int x = x0; x < xEnd; x++)
+            {
+                float px = (float)x + 0.5f;
+                bool inside = true;
+                for (int e = 0; e < 3; e++)
+                    inside = inside && (triangle.edgeA[e] * px + triangle.edgeB[e] * py) + triangle.edgeC[e] >= 0.f;
+                float z = (triangle.depthA * px + triangle.depthB * py) + triangle.depthC;
+                if (inside)
+                    row[x - tileX] = std::min(row[x - tileX], z);
+            }
+        }
+    }
+
+    updateMaxima(tile);
+}
+
+void OcclusionCuller::updateMaxima(size_t tile)
+{
+    int blockX = (int)(tile % TILES_X) * BLOCKS_PER_TILE;
+    int blockY = (int)(tile / TILES_X) * BLOCKS_PER_TILE;
+    const float* tileDepth = &this->depth[tile * TILE_PIXELS];
+
+    float farthest = 0.f;
+    for (int by = 0; by < BLOCKS_PER_TILE; by++)
+    {
+        for (int bx = 0; bx < BLOCKS_PER_TILE; bx++)
+        {
+            float blockFarthest = 0.f;
+            for (int y = 0; y < BLOCK_SIZE; y++)
+            {
+                const float* row = tileDepth + (by * BLOCK_SIZE + y) * TILE_SIZE + bx * BLOCK_SIZE;
+                for (int x = 0; x < BLOCK_SIZE; x++)
+                    blockFarthest = std::max(blockFarthest, row[x]);
+            }
+            this->blockMax[(blockY + by) * BLOCKS_X + blockX + bx] = blockFarthest;
+            farthest = std::max(farthest, blockFarthest);
+        }
+    }
+    this->tileMax[tile] = farthest;
+}
+
+bool OcclusionCuller::isVisible(const Bounds& bounds, const glm::mat4& model) const
+{
+    if (bounds.isEmpty())
+        return true;
+
+    // Screen rectangle and nearest depth of the box's corners
+    glm::mat4 transform = this->viewProjection * model;
+    float left = 1e30f, right = -1e30f, bottom = 1e30f, top = -1e30f;
+    float nearest = 1e30f;
+    for (int c = 0; c < 8; c++)
+    {
+        glm::vec3 corner((c & 1) ? bounds.max.x : bounds.min.x, (c & 2) ? bounds.max.y : bounds.min.y, (c & 4) ? bounds.max.z : bounds.min.z);
+        glm::vec4 clip = transform * glm::vec4(corner, 1.f);
+        if (clip.w <= 0.f || clip.z < -clip.w)
+            return true;
+
+        float invW = 1.f / clip.w;
+        float x = (clip.x * invW * 0.5f + 0.5f) * WIDTH;
+        float y = (clip.y * invW * 0.5f + 0.5f) * HEIGHT;
+        left = std::min(left, x);
+        right = std::max(right, x);
+        bottom = std::min(bottom, y);
+        top = std::max(top, y);
+        nearest = std::min(nearest, clip.z * invW * 0.5f + 0.5f);
+    }
+
+    // Depths are sampled at pixel centers, so the rectangle reaches the nearest center beyond each
+    // edge: a box corner between two centers is only hidden if the occluder covers both
+    float x0 = std::max(std::floor(left - 0.5f), 0.f);
+    float x1 = std::min(std::floor(right + 0.5f), WIDTH - 1.f);
+    float y0 = std::max(std::floor(bottom - 0.5f), 0.f);
+    float y1 = std::min(std::floor(top + 0.5f), HEIGHT - 1.f);
+    if (x0 > x1 || y0 > y1)
+        return true;
+    int minX = (int)x0, maxX = (int)x1, minY = (int)y0, maxY = (int)y1;
+
+    // Whole tiles behind the box are skipped, the rest is checked block by block
+    for (int ty = minY / TILE_SIZE; ty <= maxY / TILE_SIZE; ty++)
+    {
+        for (int tx = minX / TILE_SIZE; tx <= maxX / TILE_SIZE; tx++)
+        {
+            if (this->tileMax[ty * TILES_X + tx] < nearest)
+                continue;
+
+            int bx0 = std::max(minX, tx * TILE_SIZE) / BLOCK_SIZE;
+            int bx1 = std::min(maxX, tx * TILE_SIZE + TILE_SIZE - 1) / BLOCK_SIZE;
+            int by0 = std::max(minY, ty * TILE_SIZE) / BLOCK_SIZE;
+            int by1 = std::min(maxY, ty * TILE_SIZE + TILE_SIZE - 1) / BLOCK_SIZE;
+            for (int by = by0; by <= by1; by++)
+            {
+                for (int bx = bx0; bx <= bx1; bx++)
+                {
+                    if (this->blockMax[by * BLOCKS_X + bx] >= nearest)
+                        return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void OcclusionCuller::resize(size_t count)
+{
+    this->boxes.resize(count);
+    this->occluded.resize(count, 0);
+}
+
+void OcclusionCuller::set(size_t i, const Bounds& bounds, const glm::mat4& model)
+{
+    this->boxes[i].bounds = bounds;
+    this->boxes[i].model = model;
+}
+
+size_t OcclusionCuller::cull(const uint8_t* candidates)
+{
+    auto cullRange = [this, candidates](size_t begin, size_t end) {
+        size_t count = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            bool hidden = (!candidates || candidates[i]) && !isVisible(this->boxes[i].bounds, this->boxes[i].model);
+            this->occluded[i] = hidden ? 1 : 0;
+            count += hidden ? 1 : 0;
+        }
+        return count;
+    };
+
+    size_t count = this->boxes.size();
+    if (count < PARALLEL_BOX_THRESHOLD)
+        return cullRange(0, count);
+
+    std::atomic<size_t> occluded(0);
+    JobSystem::getInstance()->parallelFor(count, BOXES_PER_JOB, [&occluded, &cullRange](size_t first, size_t last) {
+        occluded += cullRange(first, last);
+    });
+    return occluded.load();
+}
+
+float OcclusionCuller::getDepth(int x, int y) const
+{
+    size_t tile = (size_t)((y / TILE_SIZE) * TILES_X + x / TILE_SIZE);
+    return this->depth[tile * TILE_PIXELS + (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE];
+}
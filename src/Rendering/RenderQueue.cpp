@@ -0,0 +1,389 @@
+#include "Rendering/RenderQueue.h"
+#include "shaders/ShaderProgram.h"
+#include "Jobs/JobSystem.h"
+#include "Profiling/Profiler.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstring>
+
+// Key layout, most significant first
+static const int PASS_SHIFT = 60;       // 4 bits
+static const int PROGRAM_SHIFT = 48;    // 12 bits
+static const int MATERIAL_SHIFT = 32;   // 16 bits
+static const int VERTEX_ARRAY_SHIFT = 16; // 16 bits
+                                        // 16 bits depth
+
+const size_t RenderQueue::PACKETS_PER_LIST;
+
+std::mutex RenderQueue::materialKeyMutex;
+std::unordered_map<uint64_t, uint16_t> RenderQueue::materialKeys;
+
+// Texture units of DrawPacket::textures
+static const int textureUnits[2] = { ShaderProgram::ALBEDO_UNIT, ShaderProgram::NORMAL_MAP_UNIT };
+
+RenderQueue::RenderQueue()
+{
+    this->view = glm::mat4(1.0f);
+    this->farClip = 1.0f;
+    std::memset(&this->stats, 0, sizeof(Stats));
+    this->depthPrepass = false;
+    this->overdrawView = false;
+    this->depthPackets = 0;
+    this->fragmentQuery = 0;
+    this->hasUniformBlock = false;
+    this->uniformBinding = 0;
+    this->uniformBuffer = 0;
+    this->listCount = 0;
+    this->recorded = false;
+}
+
+uint16_t RenderQueue::getMaterialKey(unsigned int albedo, unsigned int normalMap)
+{
+    std::lock_guard<std::mutex> lock(materialKeyMutex);
+
+    uint64_t pair = ((uint64_t)albedo << 32) | normalMap;
+    auto it = materialKeys.find(pair);
+    if (it != materialKeys.end())
+        return it->second;
+
+    uint16_t key = (uint16_t)materialKeys.size();
+    materialKeys[pair] = key;
+    return key;
+}
+
+void RenderQueue::begin(const glm::mat4& view, float farClip)
+{
+    this->packets.clear();
+    this->items.clear();
+    this->view = view;
+    this->farClip = farClip;
+    this->listCount = 0;
+    this->recorded = false;
+    this->depthPackets = 0;
+}
+
+void RenderQueue::setUniformBlock(uint32_t binding, uint32_t buffer)
+{
+    this->hasUniformBlock = true;
+    this->uniformBinding = binding;
+    this->uniformBuffer = buffer;
+}
+
+void RenderQueue::submit(RenderPass pass, uint16_t materialKey, const DrawPacket& packet)
+{
+    // Opaque geometry goes front to back so early depth testing rejects hidden fragments
+    float depth = -(this->view * packet.model[3]).z / this->farClip;
+    depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+    uint64_t depthKey = (uint64_t)(depth * 65535.0f);
+
+    DrawPacket depthPacket;
+    bool depthOnly = pass == OPAQUE_PASS && packet.depthProgram != nullptr;
+    if (depthOnly)
+    {
+        depthPacket = packet;
+        depthPacket.program = packet.depthProgram;
+        depthPacket.vertexArray = packet.depthVertexArray;
+        depthPacket.textures[0] = packet.depthTexture;
+        depthPacket.textures[1] = 0;
+    }
+
+    if (depthOnly && this->depthPrepass)
+    {
+        // Textures only matter to alpha-tested depth programs, the rest share material 0
+        uint16_t depthMaterial = packet.depthTexture != 0 ? materialKey : 0;
+        uint64_t key = ((uint64_t)DEPTH_PASS << PASS_SHIFT)
+            | ((uint64_t)(depthPacket.program->getId() & 0xFFF) << PROGRAM_SHIFT)
+            | ((uint64_t)depthMaterial << MATERIAL_SHIFT)
+            | ((uint64_t)(depthPacket.vertexArray & 0xFFFF) << VERTEX_ARRAY_SHIFT)
+            | depthKey;
+
+        SortItem item = { key, (uint32_t)this->packets.size() };
+        this->items.push_back(item);
+        this->packets.push_back(depthPacket);
+        this->depthPackets++;
+    }
+
+    const DrawPacket& drawn = depthOnly && this->overdrawView ? depthPacket : packet;
+    uint64_t key = ((uint64_t)pass << PASS_SHIFT)
+        | ((uint64_t)(drawn.program->getId() & 0xFFF) << PROGRAM_SHIFT)
+        | ((uint64_t)materialKey << MATERIAL_SHIFT)
+        | ((uint64_t)(drawn.vertexArray & 0xFFFF) << VERTEX_ARRAY_SHIFT)
+        | depthKey;
+
+    SortItem item = { key, (uint32_t)this->packets.size() };
+    this->items.push_back(item);
+    this->packets.push_back(drawn);
+}
+
+void RenderQueue::sort()
+{
+    PROFILE_ZONE("RenderQueue::sort");
+
+    size_t count = this->items.size();
+    if (count < 2)
+        return;
+
+    // One pass over the keys builds the histograms for all eight byte positions
+    std::memset(this->histograms, 0, sizeof(this->histograms));
+    for (const SortItem& item : this->items)
+    {
+        for (int byte = 0; byte < 8; byte++)
+            this->histograms[byte][(item.key >> (byte * 8)) & 0xFF]++;
+    }
+
+    this->scratch.resize(count);
+    SortItem* source = this->items.data();
+    SortItem* destination = this->scratch.data();
+
+    // LSD radix sort, skipping byte positions every key agrees on (common for pass and program)
+    for (int byte = 0; byte < 8; byte++)
+    {
+        size_t* histogram = this->histograms[byte];
+        if (histogram[(source[0].key >> (byte * 8)) & 0xFF] == count)
+            continue;
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++)
+        {
+            size_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; i++)
+            destination[histogram[(source[i].key >> (byte * 8)) & 0xFF]++] = source[i];
+
+        SortItem* swap = source;
+        source = destination;
+        destination = swap;
+    }
+
+    if (source != this->items.data())
+        this->items.swap(this->scratch);
+}
+
+void RenderQueue::record(bool parallel)
+{
+    PROFILE_ZONE("RenderQueue::record");
+
+    size_t count = this->items.size();
+    this->listCount = std::max((size_t)1, (count + PACKETS_PER_LIST - 1) / PACKETS_PER_LIST);
+    while (this->lists.size() < this->listCount)
+        this->lists.emplace_back(new CommandList());
+    this->listStats.resize(this->listCount);
+
+    if (parallel && this->listCount > 1)
+    {
+        JobSystem::getInstance()->parallelFor(this->listCount, 1, [this, count](size_t first, size_t last) {
+            for (size_t list = first; list < last; list++)
+                recordRange(list, list * PACKETS_PER_LIST, std::min(count, (list + 1) * PACKETS_PER_LIST));
+        });
+    }
+    else
+    {
+        for (size_t list = 0; list < this->listCount; list++)
+            recordRange(list, list * PACKETS_PER_LIST, std::min(count, (list + 1) * PACKETS_PER_LIST));
+    }
+
+    std::memset(&this->stats, 0, sizeof(Stats));
+    this->stats.packets = count;
+    for (size_t list = 0; list < this->listCount; list++)
+    {
+        const Stats& listStats = this->listStats[list];
+        this->stats.drawCalls += listStats.drawCalls;
+        this->stats.instances += listStats.instances;
+        this->stats.triangles += listStats.triangles;
+        this->stats.programSwitches += listStats.programSwitches;
+        this->stats.textureBinds += listStats.textureBinds;
+        this->stats.vertexArrayBinds += listStats.vertexArrayBinds;
+        this->stats.depthDraws += listStats.depthDraws;
+    }
+    this->recorded = true;
+}
+
+void RenderQueue::recordPassState(CommandList& commands, uint32_t pass)
+{
+    // With a pre-pass the opaque pass only shades the fragments that laid down the final depth
+    bool prepassed = this->depthPackets > 0;
+    if (pass == DEPTH_PASS)
+        commands.setPassState(pass, GL_LESS, true, false, false);
+    else if (pass == OPAQUE_PASS)
+        commands.setPassState(pass, prepassed ? GL_LEQUAL : GL_LESS, !prepassed, true, this->overdrawView);
+    else
+        commands.setPassState(pass, GL_LESS, true, true, false);
+}
+
+void RenderQueue::recordRange(size_t list, size_t begin, size_t end)
+{
+    CommandList& commands = *this->lists[list];
+    Stats& stats = this->listStats[list];
+    commands.reset();
+    std::memset(&stats, 0, sizeof(Stats));
+
+    // Bound state is unknown at the start of the frame, the first packet binds everything.
+    // Later lists continue from the state the previous packet left, as if recorded in one go.
+    ShaderProgram* currentProgram = nullptr;
+    unsigned int currentTextures[2] = { 0, 0 };
+    unsigned int currentVertexArray = 0;
+    uint32_t currentPass = PASS_COUNT;
+    if (begin == 0)
+    {
+        if (this->hasUniformBlock)
+            commands.bindUniformBlock(this->uniformBinding, this->uniformBuffer);
+    }
+    else
+    {
+        const DrawPacket& previous = this->packets[this->items[begin - 1].packet];
+        currentProgram = previous.program;
+        currentTextures[0] = previous.textures[0];
+        currentTextures[1] = previous.textures[1];
+        currentVertexArray = previous.vertexArray;
+        currentPass = (uint32_t)(this->items[begin - 1].key >> PASS_SHIFT);
+    }
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const DrawPacket& packet = this->packets[this->items[i].packet];
+
+        uint32_t pass = (uint32_t)(this->items[i].key >> PASS_SHIFT);
+        if (pass != currentPass)
+        {
+            recordPassState(commands, pass);
+            currentPass = pass;
+        }
+        if (pass == DEPTH_PASS)
+            stats.depthDraws++;
+
+        if (packet.program != currentProgram)
+        {
+            commands.bindProgram(packet.program);
+            currentProgram = packet.program;
+            stats.programSwitches++;
+        }
+
+        for (int t = 0; t < 2; t++)
+        {
+            if (packet.textures[t] != currentTextures[t])
+            {
+                commands.bindTexture(textureUnits[t], packet.textures[t]);
+                currentTextures[t] = packet.textures[t];
+                stats.textureBinds++;
+            }
+        }
+
+        if (packet.vertexArray != currentVertexArray)
+        {
+            commands.bindVertexArray(packet.vertexArray);
+            currentVertexArray = packet.vertexArray;
+            stats.vertexArrayBinds++;
+        }
+
+        stats.triangles += (size_t)(packet.elementCount / 3) * std::max(packet.instanceCount, 1u);
+        if (packet.instanceCount > 0)
+            stats.instances += packet.instanceCount;
+        else
+        {
+            commands.setModel(packet.program->getLocation(ShaderProgram::MODEL), glm::value_ptr(packet.model));
+            stats.instances++;
+        }
+        commands.draw(packet.elementCount, packet.indexType, packet.baseVertex, packet.indexOffset, packet.instanceCount);
+        stats.drawCalls++;
+    }
+
+    // Leave no vertex array bound behind the frame, and depth writes on so the next clear clears depth
+    if (end == this->items.size() && currentVertexArray != 0)
+        commands.bindVertexArray(0);
+    if (end == this->items.size() && currentPass != PASS_COUNT)
+        recordPassState(commands, PASS_COUNT);
+}
+
+void RenderQueue::execute()
+{
+    if (!this->recorded)
+        record();
+
+    PROFILE_ZONE("RenderQueue::execute");
+
+    bool counting = false;
+    for (size_t list = 0; list < this->listCount; list++)
+    {
+        const uint8_t* command = this->lists[list]->getBegin();
+        const uint8_t* end = this->lists[list]->getEnd();
+        while (command < end)
+        {
+            const CommandHeader* header = reinterpret_cast<const CommandHeader*>(command);
+            switch (header->type)
+            {
+            case BIND_PROGRAM_COMMAND:
+                reinterpret_cast<const BindProgramCommand*>(command)->program->bind();
+                break;
+            case BIND_UNIFORM_BLOCK_COMMAND:
+            {
+                const BindUniformBlockCommand* bind = reinterpret_cast<const BindUniformBlockCommand*>(command);
+                glBindBufferBase(GL_UNIFORM_BUFFER, bind->binding, bind->buffer);
+                break;
+            }
+            case BIND_TEXTURE_COMMAND:
+            {
+                const BindTextureCommand* bind = reinterpret_cast<const BindTextureCommand*>(command);
+                glActiveTexture(GL_TEXTURE0 + bind->unit);
+                glBindTexture(GL_TEXTURE_2D, bind->texture);
+                break;
+            }
+            case BIND_VERTEX_ARRAY_COMMAND:
+                glBindVertexArray(reinterpret_cast<const BindVertexArrayCommand*>(command)->vertexArray);
+                break;
+            case SET_MODEL_COMMAND:
+            {
+                const SetModelCommand* set = reinterpret_cast<const SetModelCommand*>(command);
+                glUniformMatrix4fv(set->location, 1, GL_FALSE, set->model);
+                break;
+            }
+            case SET_PASS_STATE_COMMAND:
+            {
+                const SetPassStateCommand* set = reinterpret_cast<const SetPassStateCommand*>(command);
+                glDepthFunc(set->depthFunc);
+                glDepthMask(set->depthWrite ? GL_TRUE : GL_FALSE);
+                GLboolean color = set->colorWrite ? GL_TRUE : GL_FALSE;
+                glColorMask(color, color, color, color);
+                if (set->additiveBlend)
+                {
+                    glEnable(GL_BLEND);
+                    glBlendFunc(GL_ONE, GL_ONE);
+                }
+                else
+                    glDisable(GL_BLEND);
+
+                if (this->fragmentQuery != 0 && set->pass == OPAQUE_PASS && !counting)
+                {
+                    glBeginQuery(GL_SAMPLES_PASSED, this->fragmentQuery);
+                    counting = true;
+                }
+                break;
+            }
+            case DRAW_COMMAND:
+            {
+                const DrawCommand* draw = reinterpret_cast<const DrawCommand*>(command);
+                void* indices = (void*)(uintptr_t)draw->indexOffset;
+                if (draw->instanceCount > 0)
+                    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, draw->elementCount, draw->indexType, indices, draw->instanceCount, draw->baseVertex);
+                else
+                    glDrawElementsBaseVertex(GL_TRIANGLES, draw->elementCount, draw->indexType, indices, draw->baseVertex);
+                break;
+            }
+            }
+            command += header->size;
+        }
+    }
+
+    // A frame without opaque draws still ends its query, with a result of 0
+    if (this->fragmentQuery != 0)
+    {
+        if (!counting)
+            glBeginQuery(GL_SAMPLES_PASSED, this->fragmentQuery);
+        glEndQuery(GL_SAMPLES_PASSED);
+        this->fragmentQuery = 0;
+    }
+}
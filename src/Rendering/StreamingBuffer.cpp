@@ -0,0 +1,170 @@
+#include "Rendering/StreamingBuffer.h"
+#include "Profiling/Profiler.h"
+
+#include <glad/glad.h>
+#include <cstring>
+#include <iostream>
+
+// Slice a stalled allocation waits in before checking its fence again
+static const GLuint64 WAIT_TIMEOUT_NS = 1000000;
+
+StreamingBuffer::StreamingBuffer()
+{
+    this->bufferHandle = 0;
+    this->capacity = 0;
+    this->head = 0;
+    this->tail = 0;
+    this->frameBegin = 0;
+    this->stallCount = 0;
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+    release();
+}
+
+void StreamingBuffer::release()
+{
+    for (FrameFence& frame : this->frames)
+        glDeleteSync(frame.fence);
+    this->frames.clear();
+
+    if (this->bufferHandle != 0)
+    {
+        glDeleteBuffers(1, &this->bufferHandle);
+        this->bufferHandle = 0;
+    }
+    this->capacity = 0;
+    this->head = 0;
+    this->tail = 0;
+    this->frameBegin = 0;
+}
+
+bool StreamingBuffer::init(size_t capacity)
+{
+    glGenBuffers(1, &this->bufferHandle);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->bufferHandle);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cout << "GL Error after creating streaming buffer" << std::endl;
+        return false;
+    }
+
+    this->capacity = capacity;
+    return true;
+}
+
+bool StreamingBuffer::fits(size_t offset, size_t size)
+{
+    // head never catches up with tail exactly, equal means empty
+    if (this->head >= this->tail)
+        return offset + size <= this->capacity;
+    return offset + size < this->tail;
+}
+
+bool StreamingBuffer::retireOldest()
+{
+    if (this->frames.empty())
+        return false;
+
+    FrameFence& frame = this->frames.front();
+    GLenum status = glClientWaitSync(frame.fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        PROFILE_ZONE("Streaming buffer wait");
+        this->stallCount++;
+        do
+            status = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT_NS);
+        while (status == GL_TIMEOUT_EXPIRED);
+    }
+    if (status == GL_WAIT_FAILED)
+        std::cout << "Streaming buffer fence wait failed" << std::endl;
+
+    this->tail = frame.end;
+    glDeleteSync(frame.fence);
+    this->frames.pop_front();
+    return true;
+}
+
+void* StreamingBuffer::map(size_t size, size_t alignment, size_t& offset)
+{
+    if (this->bufferHandle == 0 || size + alignment > this->capacity)
+        return nullptr;
+
+    while (true)
+    {
+        // Nothing in flight, start over at the front so large allocations need no wrap
+        if (this->head == this->tail)
+        {
+            this->head = 0;
+            this->tail = 0;
+            this->frameBegin = 0;
+        }
+
+        offset = (this->head + alignment - 1) / alignment * alignment;
+        if (fits(offset, size))
+            break;
+
+        // Skip the rest of the buffer and continue from the front, the skipped bytes free up with this frame
+        if (this->head >= this->tail && size < this->tail)
+        {
+            offset = 0;
+            break;
+        }
+
+        if (!retireOldest())
+            return nullptr;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->bufferHandle);
+    void* memory = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!memory)
+    {
+        std::cout << "Failed to map streaming buffer range" << std::endl;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return nullptr;
+    }
+
+    this->head = offset + size;
+    return memory;
+}
+
+void StreamingBuffer::unmap()
+{
+    if (!glUnmapBuffer(GL_COPY_WRITE_BUFFER))
+        std::cout << "Streaming buffer contents were lost while mapped" << std::endl;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+bool StreamingBuffer::write(const void* data, size_t size, size_t alignment, size_t& offset)
+{
+    void* memory = map(size, alignment, offset);
+    if (!memory)
+        return false;
+
+    std::memcpy(memory, data, size);
+    unmap();
+    return true;
+}
+
+void StreamingBuffer::endFrame()
+{
+    if (this->head != this->frameBegin)
+    {
+        FrameFence frame;
+        frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame.end = this->head;
+        this->frames.push_back(frame);
+        this->frameBegin = this->head;
+    }
+
+    // Drop fences the GPU is already past so only frames actually in flight keep one
+    while (!this->frames.empty() && glClientWaitSync(this->frames.front().fence, 0, 0) != GL_TIMEOUT_EXPIRED)
+    {
+        this->tail = this->frames.front().end;
+        glDeleteSync(this->frames.front().fence);
+        this->frames.pop_front();
+    }
+}
@@ -0,0 +1,187 @@
+#include "Rendering/VertexLayout.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+VertexLayout::VertexLayout(PositionEncoding position, UvEncoding uv, TangentEncoding tangent)
+{
+    this->position = position;
+    this->uv = uv;
+    this->tangent = tangent;
+
+    // 16 bit positions are padded to 8 bytes to keep every attribute 4 byte aligned
+    size_t positionSize = position == POSITION_FLOAT ? 12 : 8;
+    size_t uvSize = uv == UV_FLOAT ? 8 : 4;
+    size_t tangentSize = tangent == TANGENT_FLOAT ? 24 : 8;
+
+    this->uvOffset = positionSize;
+    this->tangentOffset = positionSize + uvSize;
+    this->stride = positionSize + uvSize + tangentSize;
+}
+
+bool VertexLayout::fromName(const std::string& name, VertexLayout& layout)
+{
+    if (name == "full")
+        layout = full();
+    else if (name == "compact")
+        layout = compact();
+    else if (name == "quantized")
+        layout = quantized();
+    else
+        return false;
+    return true;
+}
+
+std::string VertexLayout::getDefines() const
+{
+    return this->tangent == TANGENT_PACKED ? "#define PACKED_TANGENT_FRAME\n" : "";
+}
+
+void VertexLayout::applyPositions() const
+{
+    GLsizei stride = (GLsizei)this->stride;
+
+    if (this->position == POSITION_FLOAT)
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    else
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+    glEnableVertexAttribArray(0);
+}
+
+void VertexLayout::apply() const
+{
+    GLsizei stride = (GLsizei)this->stride;
+
+    // Position attribute
+    this->applyPositions();
+
+    // TexCoord attribute
+    glVertexAttribPointer(1, 2, this->uv == UV_FLOAT ? GL_FLOAT : GL_HALF_FLOAT, GL_FALSE, stride, (void*)this->uvOffset);
+    glEnableVertexAttribArray(1);
+
+    // Tangent frame, tangent + bitangent or normal + signed tangent
+    if (this->tangent == TANGENT_FLOAT)
+    {
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)this->tangentOffset);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)(this->tangentOffset + 12));
+    }
+    else
+    {
+        glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)this->tangentOffset);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)(this->tangentOffset + 4));
+    }
+    glEnableVertexAttribArray(2);
+    glEnableVertexAttribArray(3);
+}
+
+static uint16_t toHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7C00);
+    if (exponent <= 0)
+    {
+        // Subnormal half, or zero below its range
+        if (exponent < -10)
+            return (uint16_t)sign;
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+            half++;
+        return (uint16_t)(sign | half);
+    }
+
+    // Round to nearest, a carry into the exponent is still the right result
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+        half++;
+    return (uint16_t)half;
+}
+
+static uint32_t packSnorm1010102(const glm::vec3& v, float w)
+{
+    auto component = [](float value, float scale, uint32_t mask) {
+        int32_t quantized = (int32_t)std::lround(std::clamp(value, -1.f, 1.f) * scale);
+        return (uint32_t)quantized & mask;
+    };
+
+    return component(v.x, 511.f, 0x3FF)
+        | (component(v.y, 511.f, 0x3FF) << 10)
+        | (component(v.z, 511.f, 0x3FF) << 20)
+        | (component(w, 1.f, 0x3) << 30);
+}
+
+void VertexLayout::encode(const float* vertices, const float* tangents, size_t count, std::vector<unsigned char>& out, glm::mat4& positionTransform) const
+{
+    out.assign(count * this->stride, 0);
+    positionTransform = glm::mat4(1.0f);
+
+    glm::vec3 origin(0.f);
+    float scale = 1.f;
+    if (this->position == POSITION_UNORM16 && count > 0)
+    {
+        glm::vec3 boundsMin(vertices[0], vertices[1], vertices[2]);
+        glm::vec3 boundsMax = boundsMin;
+        for (size_t i = 1; i < count; i++)
+        {
+            glm::vec3 p(vertices[i * 5], vertices[i * 5 + 1], vertices[i * 5 + 2]);
+            boundsMin = glm::min(boundsMin, p);
+            boundsMax = glm::max(boundsMax, p);
+        }
+
+        glm::vec3 extent = boundsMax - boundsMin;
+        origin = boundsMin;
+        scale = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+        positionTransform = glm::scale(glm::translate(glm::mat4(1.0f), origin), glm::vec3(scale));
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned char* vertex = out.data() + i * this->stride;
+        const float* source = vertices + i * 5;
+
+        if (this->position == POSITION_FLOAT)
+            std::memcpy(vertex, source, 12);
+        else
+        {
+            uint16_t quantized[3];
+            for (int c = 0; c < 3; c++)
+                quantized[c] = (uint16_t)std::lround(std::clamp((source[c] - origin[c]) / scale, 0.f, 1.f) * 65535.f);
+            std::memcpy(vertex, quantized, 6);
+        }
+
+        if (this->uv == UV_FLOAT)
+            std::memcpy(vertex + this->uvOffset, source + 3, 8);
+        else
+        {
+            uint16_t half[2] = { toHalf(source[3]), toHalf(source[4]) };
+            std::memcpy(vertex + this->uvOffset, half, 4);
+        }
+
+        const float* frame = tangents + i * 6;
+        if (this->tangent == TANGENT_FLOAT)
+            std::memcpy(vertex + this->tangentOffset, frame, 24);
+        else
+        {
+            // Same frame the float layout gives the shader: normal = cross(tangent, bitangent).
+            // Deriving the normal from the frame makes it right-handed, so the sign is always +1.
+            glm::vec3 t(frame[0], frame[1], frame[2]);
+            glm::vec3 b(frame[3], frame[4], frame[5]);
+            glm::vec3 n = glm::cross(t, b);
+            n = glm::dot(n, n) > 0.f ? glm::normalize(n) : glm::vec3(0.f, 0.f, 1.f);
+
+            uint32_t packed[2] = { packSnorm1010102(n, 0.f), packSnorm1010102(glm::normalize(t), 1.f) };
+            std::memcpy(vertex + this->tangentOffset, packed, 8);
+        }
+    }
+}
@@ -0,0 +1,384 @@
+#include "Scene/TransformStore.h"
+#include "Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+
+// Below this many nodes scheduling jobs costs more than it saves
+static const size_t PARALLEL_NODE_THRESHOLD = 16384;
+// Subtrees per worker wanted at the split depth, so uneven subtrees still balance
+static const size_t SUBTREES_PER_WORKER = 4;
+
+const uint32_t TransformStore::INVALID;
+TransformStore* TransformStore::instance = nullptr;
+
+TransformStore* TransformStore::getInstance()
+{
+    if (!instance)
+    {
+        instance = new TransformStore();
+    }
+
+    return instance;
+}
+
+TransformStore::TransformStore()
+{
+    this->nodeCount = 0;
+    this->deadCount = 0;
+    this->updatedCount = 0;
+    this->planValid = false;
+    this->anyDirty = false;
+}
+
+// parent * translation * rotation * scale, without building the local matrices. Every
+// matrix in the store is affine, so only the parent's first three columns scale the local axes.
+static inline void composeWorld(glm::mat4& out, const glm::mat4& parent, const glm::vec3& t, const glm::quat& q, const glm::vec3& s)
+{
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    glm::vec3 axisX = glm::vec3(1.f - 2.f * (yy + zz), 2.f * (xy + wz), 2.f * (xz - wy)) * s.x;
+    glm::vec3 axisY = glm::vec3(2.f * (xy - wz), 1.f - 2.f * (xx + zz), 2.f * (yz + wx)) * s.y;
+    glm::vec3 axisZ = glm::vec3(2.f * (xz + wy), 2.f * (yz - wx), 1.f - 2.f * (xx + yy)) * s.z;
+
+    glm::vec4 p0 = parent[0], p1 = parent[1], p2 = parent[2], p3 = parent[3];
+    out[0] = p0 * axisX.x + p1 * axisX.y + p2 * axisX.z;
+    out[1] = p0 * axisY.x + p1 * axisY.y + p2 * axisY.z;
+    out[2] = p0 * axisZ.x + p1 * axisZ.y + p2 * axisZ.z;
+    out[3] = p0 * t.x + p1 * t.y + p2 * t.z + p3;
+}
+
+static const glm::mat4 IDENTITY = glm::mat4(1.0f);
+
+uint32_t TransformStore::create(uint32_t parent)
+{
+    uint32_t slot;
+    uint32_t depth = 0;
+    uint32_t parentSlot = INVALID;
+    if (parent == INVALID)
+        slot = (uint32_t)this->positions.size();
+    else
+    {
+        parentSlot = this->slots[parent];
+        slot = parentSlot + this->subtreeSizes[parentSlot];
+        depth = this->depths[parentSlot] + 1;
+
+        // Ancestors sit before the new slot, so their slots survive the insert
+        for (uint32_t ancestor = parentSlot; ancestor != INVALID; ancestor = this->parents[ancestor])
+            this->subtreeSizes[ancestor]++;
+    }
+
+    insertSlot(slot);
+
+    uint32_t handle;
+    if (!this->freeHandles.empty())
+    {
+        handle = this->freeHandles.back();
+        this->freeHandles.pop_back();
+    }
+    else
+    {
+        handle = (uint32_t)this->slots.size();
+        this->slots.push_back(INVALID);
+    }
+
+    this->positions[slot] = glm::vec3(0.f);
+    this->rotations[slot] = glm::quat(1.f, 0.f, 0.f, 0.f);
+    this->scales[slot] = glm::vec3(1.f);
+    this->worlds[slot] = glm::mat4(1.0f);
+    this->parents[slot] = parentSlot;
+    this->subtreeSizes[slot] = 1;
+    this->depths[slot] = depth;
+    this->handles[slot] = handle;
+    this->dirty[slot] = 1;
+    this->changed[slot] = 0;
+    this->alive[slot] = 1;
+    this->anyDirty = true;
+    this->slots[handle] = slot;
+
+    this->nodeCount++;
+    this->planValid = false;
+    return handle;
+}
+
+void TransformStore::insertSlot(uint32_t slot)
+{
+    size_t oldSize = this->positions.size();
+    this->positions.insert(this->positions.begin() + slot, glm::vec3(0.f));
+    this->rotations.insert(this->rotations.begin() + slot, glm::quat(1.f, 0.f, 0.f, 0.f));
+    this->scales.insert(this->scales.begin() + slot, glm::vec3(1.f));
+    this->worlds.insert(this->worlds.begin() + slot, glm::mat4(1.0f));
+    this->parents.insert(this->parents.begin() + slot, INVALID);
+    this->subtreeSizes.insert(this->subtreeSizes.begin() + slot, 1);
+    this->depths.insert(this->depths.begin() + slot, 0);
+    this->handles.insert(this->handles.begin() + slot, INVALID);
+    this->dirty.insert(this->dirty.begin() + slot, 0);
+    this->changed.insert(this->changed.begin() + slot, 0);
+    this->alive.insert(this->alive.begin() + slot, 0);
+
+    // Appending, the common case while a hierarchy is built depth first, moves nothing
+    if (slot == oldSize)
+        return;
+
+    for (size_t i = 0; i < this->parents.size(); i++)
+    {
+        if (this->parents[i] != INVALID && this->parents[i] >= slot)
+            this->parents[i]++;
+    }
+    for (size_t i = slot + 1; i < this->handles.size(); i++)
+    {
+        if (this->handles[i] != INVALID)
+            this->slots[this->handles[i]] = (uint32_t)i;
+    }
+}
+
+void TransformStore::destroy(uint32_t handle)
+{
+    if (handle >= this->slots.size() || this->slots[handle] == INVALID)
+        return;
+
+    // Dead slots keep their place until the next update compacts them, subtrees stay contiguous
+    uint32_t slot = this->slots[handle];
+    for (uint32_t i = slot; i < slot + this->subtreeSizes[slot]; i++)
+    {
+        if (!this->alive[i])
+            continue;
+        this->alive[i] = 0;
+        this->slots[this->handles[i]] = INVALID;
+        this->freeHandles.push_back(this->handles[i]);
+        this->handles[i] = INVALID;
+        this->nodeCount--;
+        this->deadCount++;
+    }
+    this->planValid = false;
+}
+
+void TransformStore::clear()
+{
+    this->positions.clear();
+    this->rotations.clear();
+    this->scales.clear();
+    this->worlds.clear();
+    this->parents.clear();
+    this->subtreeSizes.clear();
+    this->depths.clear();
+    this->handles.clear();
+    this->dirty.clear();
+    this->changed.clear();
+    this->alive.clear();
+    this->slots.clear();
+    this->freeHandles.clear();
+
+    this->nodeCount = 0;
+    this->deadCount = 0;
+    this->planValid = false;
+    this->anyDirty = false;
+}
+
+void TransformStore::setPosition(uint32_t handle, const glm::vec3& position)
+{
+    uint32_t slot = this->slots[handle];
+    this->positions[slot] = position;
+    this->dirty[slot] = 1;
+    this->anyDirty = true;
+}
+
+void TransformStore::setRotation(uint32_t handle, const glm::quat& rotation)
+{
+    uint32_t slot = this->slots[handle];
+    this->rotations[slot] = rotation;
+    this->dirty[slot] = 1;
+    this->anyDirty = true;
+}
+
+void TransformStore::setScale(uint32_t handle, const glm::vec3& scale)
+{
+    uint32_t slot = this->slots[handle];
+    this->scales[slot] = scale;
+    this->dirty[slot] = 1;
+    this->anyDirty = true;
+}
+
+uint32_t TransformStore::getParent(uint32_t handle)
+{
+    uint32_t parentSlot = this->parents[this->slots[handle]];
+    return parentSlot == INVALID ? INVALID : this->handles[parentSlot];
+}
+
+void TransformStore::compact()
+{
+    size_t size = this->positions.size();
+    std::vector<uint32_t> remap(size, INVALID);
+    size_t next = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (!this->alive[i])
+            continue;
+
+        remap[i] = (uint32_t)next;
+        this->positions[next] = this->positions[i];
+        this->rotations[next] = this->rotations[i];
+        this->scales[next] = this->scales[i];
+        this->worlds[next] = this->worlds[i];
+        // Parents come first, so theirs is already remapped, and a live node's parent is always live
+        this->parents[next] = this->parents[i] == INVALID ? INVALID : remap[this->parents[i]];
+        this->depths[next] = this->depths[i];
+        this->handles[next] = this->handles[i];
+        this->dirty[next] = this->dirty[i];
+        this->alive[next] = 1;
+        this->slots[this->handles[i]] = (uint32_t)next;
+        next++;
+    }
+
+    this->positions.resize(next);
+    this->rotations.resize(next);
+    this->scales.resize(next);
+    this->worlds.resize(next);
+    this->parents.resize(next);
+    this->depths.resize(next);
+    this->handles.resize(next);
+    this->dirty.resize(next);
+    this->changed.assign(next, 0);
+    this->alive.resize(next);
+
+    // Children come after their parents, so a reverse pass totals every subtree
+    this->subtreeSizes.assign(next, 1);
+    for (size_t i = next; i-- > 0;)
+    {
+        if (this->parents[i] != INVALID)
+            this->subtreeSizes[this->parents[i]] += this->subtreeSizes[i];
+    }
+    this->deadCount = 0;
+}
+
+void TransformStore::buildPlan(int workerCount)
+{
+    size_t size = this->positions.size();
+    std::vector<size_t> nodesAtDepth;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (this->depths[i] >= nodesAtDepth.size())
+            nodesAtDepth.resize(this->depths[i] + 1, 0);
+        nodesAtDepth[this->depths[i]]++;
+    }
+
+    // Shallowest depth with enough subtrees to keep every worker busy, else the widest one
+    size_t wanted = (size_t)workerCount * SUBTREES_PER_WORKER;
+    uint32_t splitDepth = 0;
+    for (size_t depth = 0; depth < nodesAtDepth.size(); depth++)
+    {
+        if (nodesAtDepth[depth] >= wanted)
+        {
+            splitDepth = (uint32_t)depth;
+            break;
+        }
+        if (nodesAtDepth[depth] > nodesAtDepth[splitDepth])
+            splitDepth = (uint32_t)depth;
+    }
+
+    this->shallowSlots.clear();
+    this->splitRoots.clear();
+    for (size_t i = 0; i < size; i++)
+    {
+        if (this->depths[i] < splitDepth)
+            this->shallowSlots.push_back((uint32_t)i);
+        else if (this->depths[i] == splitDepth)
+            this->splitRoots.push_back((uint32_t)i);
+    }
+
+    // Contiguous runs of subtrees with roughly equal node counts
+    size_t splitNodes = size - this->shallowSlots.size();
+    size_t perWorker = (splitNodes + workerCount - 1) / workerCount;
+    this->workerRoots.assign(1, 0);
+    size_t nodes = 0;
+    for (size_t r = 0; r < this->splitRoots.size(); r++)
+    {
+        nodes += this->subtreeSizes[this->splitRoots[r]];
+        if (nodes >= perWorker && (int)this->workerRoots.size() < workerCount)
+        {
+            this->workerRoots.push_back(r + 1);
+            nodes = 0;
+        }
+    }
+    if (this->workerRoots.back() != this->splitRoots.size())
+        this->workerRoots.push_back(this->splitRoots.size());
+
+    this->planValid = true;
+}
+
+size_t TransformStore::updateSlots(size_t begin, size_t end)
+{
+    size_t updated = 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        uint32_t parent = this->parents[i];
+        bool parentChanged = parent != INVALID && this->changed[parent];
+        if (!this->dirty[i] && !parentChanged)
+        {
+            this->changed[i] = 0;
+            continue;
+        }
+
+        composeWorld(this->worlds[i], parent != INVALID ? this->worlds[parent] : IDENTITY, this->positions[i], this->rotations[i], this->scales[i]);
+        this->dirty[i] = 0;
+        this->changed[i] = 1;
+        updated++;
+    }
+    return updated;
+}
+
+size_t TransformStore::updateSubtrees(size_t firstRoot, size_t lastRoot)
+{
+    size_t updated = 0;
+    for (size_t r = firstRoot; r < lastRoot; r++)
+    {
+        uint32_t root = this->splitRoots[r];
+        updated += updateSlots(root, root + this->subtreeSizes[root]);
+    }
+    return updated;
+}
+
+void TransformStore::update()
+{
+    if (this->deadCount > 0)
+        compact();
+
+    // Nothing moved, every world matrix is current. Stale changed flags are fine, each pass rewrites them parents first.
+    if (!this->anyDirty)
+    {
+        this->updatedCount = 0;
+        return;
+    }
+    this->anyDirty = false;
+
+    size_t size = this->positions.size();
+    if (size < PARALLEL_NODE_THRESHOLD)
+    {
+        this->updatedCount = updateSlots(0, size);
+        return;
+    }
+
+    JobSystem* jobs = JobSystem::getInstance();
+    int workerCount = jobs->getThreadCount();
+    if (!this->planValid)
+        buildPlan(workerCount);
+
+    size_t updated = 0;
+    for (uint32_t slot : this->shallowSlots)
+        updated += updateSlots(slot, slot + 1);
+
+    // Subtrees below the split share no slots, each job walks its own run in order
+    size_t runs = this->workerRoots.size() - 1;
+    std::atomic<size_t> subtreeUpdated(0);
+    jobs->parallelFor(runs, 1, [this, &subtreeUpdated](size_t first, size_t last) {
+        size_t count = 0;
+        for (size_t run = first; run < last; run++)
+            count += updateSubtrees(this->workerRoots[run], this->workerRoots[run + 1]);
+        subtreeUpdated += count;
+    });
+
+    updated += subtreeUpdated.load();
+    this->updatedCount = updated;
+}
@@ -0,0 +1,60 @@
+#include "Textures/CookedTexture.h"
+
+#include <cstring>
+#include <fstream>
+
+static bool validHeader(const CookedTextureHeader& header)
+{
+    return std::memcmp(header.magic, "OTEX", 4) == 0 && header.version == CookedTexture::VERSION
+        && header.width > 0 && header.height > 0 && header.levelCount > 0 && header.levelCount <= 32;
+}
+
+bool CookedTexture::readHeader(const std::string& path, CookedTextureHeader& header)
+{
+    std::ifstream file(path, std::ios::binary);
+    return file.read((char*)&header, sizeof(header)) && validHeader(header);
+}
+
+bool CookedTexture::open(const std::string& path)
+{
+    close();
+    if (!this->file.open(path) || this->file.getSize() < sizeof(CookedTextureHeader))
+        return false;
+
+    this->header = (const CookedTextureHeader*)this->file.getData();
+    size_t tableEnd = sizeof(CookedTextureHeader) + this->header->levelCount * sizeof(CookedTextureLevel);
+    if (!validHeader(*this->header) || this->file.getSize() < tableEnd)
+    {
+        close();
+        return false;
+    }
+
+    this->levels = (const CookedTextureLevel*)(this->file.getData() + sizeof(CookedTextureHeader));
+    for (unsigned int i = 0; i < this->header->levelCount; i++)
+    {
+        // A truncated file would otherwise hand GL a pointer past the mapping
+        if (this->levels[i].offset + this->levels[i].size > this->file.getSize())
+        {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void CookedTexture::close()
+{
+    this->file.close();
+    this->header = nullptr;
+    this->levels = nullptr;
+}
+
+void CookedTexture::prefetch()
+{
+    const size_t pageSize = 4096;
+    volatile unsigned char sink = 0;
+    const unsigned char* data = this->file.getData();
+    for (size_t offset = 0; offset < this->file.getSize(); offset += pageSize)
+        sink = sink + data[offset];
+}
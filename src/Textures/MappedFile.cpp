@@ -0,0 +1,120 @@
+#include "Textures/MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+    this->data = nullptr;
+    this->size = 0;
+#ifdef _WIN32
+    this->fileHandle = nullptr;
+    this->mappingHandle = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    this->fileHandle = file;
+    this->mappingHandle = mapping;
+    this->data = (const unsigned char*)view;
+    this->size = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (this->data)
+        UnmapViewOfFile(this->data);
+    if (this->mappingHandle)
+        CloseHandle((HANDLE)this->mappingHandle);
+    if (this->fileHandle)
+        CloseHandle((HANDLE)this->fileHandle);
+
+    this->data = nullptr;
+    this->size = 0;
+    this->fileHandle = nullptr;
+    this->mappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // The mapping keeps the file alive on its own
+    ::close(file);
+    if (view == MAP_FAILED)
+        return false;
+
+    madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+    this->data = (const unsigned char*)view;
+    this->size = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (this->data)
+        munmap((void*)this->data, this->size);
+
+    this->data = nullptr;
+    this->size = 0;
+}
+
+#endif
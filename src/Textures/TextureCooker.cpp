@@ -0,0 +1,251 @@
+#include "Textures/TextureCooker.h"
+#include "Textures/CookedTexture.h"
+
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXTURECOOKER_SSE2
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+struct CookedLevel
+{
+    std::vector<unsigned char> data;
+    int width;
+    int height;
+};
+
+std::string TextureCooker::getCookedPath(const std::string& source)
+{
+    return source + ".otex";
+}
+
+bool TextureCooker::isUpToDate(const std::string& source, const std::string& cooked)
+{
+    std::error_code error;
+    auto cookedTime = std::filesystem::last_write_time(cooked, error);
+    if (error)
+        return false;
+    auto sourceTime = std::filesystem::last_write_time(source, error);
+    return error || cookedTime >= sourceTime;
+}
+
+bool TextureCooker::supportsCompression()
+{
+    static int supported = -1;
+    if (supported == -1)
+    {
+        supported = 0;
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount; i++)
+        {
+            const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+                supported = 1;
+        }
+    }
+    return supported == 1;
+}
+
+void TextureCooker::downsample(const unsigned char* source, int width, int height, unsigned char* destination)
+{
+    int outWidth = std::max(1, width / 2);
+    int outHeight = std::max(1, height / 2);
+
+    for (int y = 0; y < outHeight; y++)
+    {
+        const unsigned char* row0 = source + (size_t)std::min(y * 2, height - 1) * width * 4;
+        const unsigned char* row1 = source + (size_t)std::min(y * 2 + 1, height - 1) * width * 4;
+        unsigned char* out = destination + (size_t)y * outWidth * 4;
+        int x = 0;
+
+#ifdef TEXTURECOOKER_SSE2
+        // Four output texels per step: split even and odd source texels, widen to 16 bits and average exactly
+        if (width >= 2)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i rounding = _mm_set1_epi16(2);
+            for (; x + 4 <= outWidth; x += 4)
+            {
+                __m128 a0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(row0 + x * 8)));
+                __m128 a1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16)));
+                __m128 b0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(row1 + x * 8)));
+                __m128 b1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16)));
+
+                __m128i evenA = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+                __m128i oddA = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+                __m128i evenB = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+                __m128i oddB = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+                __m128i low = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(evenA, zero), _mm_unpacklo_epi8(oddA, zero)),
+                                            _mm_add_epi16(_mm_unpacklo_epi8(evenB, zero), _mm_unpacklo_epi8(oddB, zero)));
+                __m128i high = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(evenA, zero), _mm_unpackhi_epi8(oddA, zero)),
+                                             _mm_add_epi16(_mm_unpackhi_epi8(evenB, zero), _mm_unpackhi_epi8(oddB, zero)));
+                low = _mm_srli_epi16(_mm_add_epi16(low, rounding), 2);
+                high = _mm_srli_epi16(_mm_add_epi16(high, rounding), 2);
+
+                _mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(low, high));
+            }
+        }
+#endif
+
+        for (; x < outWidth; x++)
+        {
+            int x0 = std::min(x * 2, width - 1) * 4;
+            int x1 = std::min(x * 2 + 1, width - 1) * 4;
+            for (int c = 0; c < 4; c++)
+                out[x * 4 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+static void buildMipChain(const unsigned char* rgba, int width, int height, std::vector<CookedLevel>& levels)
+{
+    levels.clear();
+    levels.push_back({ std::vector<unsigned char>(rgba, rgba + (size_t)width * height * 4), width, height });
+
+    while (width > 1 || height > 1)
+    {
+        int nextWidth = std::max(1, width / 2);
+        int nextHeight = std::max(1, height / 2);
+        CookedLevel next{ std::vector<unsigned char>((size_t)nextWidth * nextHeight * 4), nextWidth, nextHeight };
+        TextureCooker::downsample(levels.back().data.data(), width, height, next.data.data());
+
+        levels.push_back(std::move(next));
+        width = nextWidth;
+        height = nextHeight;
+    }
+}
+
+static bool compressLevels(const std::vector<CookedLevel>& levels, std::vector<CookedLevel>& blocks)
+{
+    // Let the driver encode DXT5 and read the blocks back, the GL cooker is only used offline
+    unsigned int texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    bool compressed = true;
+    blocks.resize(levels.size());
+    for (size_t level = 0; level < levels.size(); level++)
+    {
+        const CookedLevel& cooked = levels[level];
+        glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, cooked.width, cooked.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, cooked.data.data());
+
+        GLint isCompressed = 0, size = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, (GLint)level, GL_TEXTURE_COMPRESSED, &isCompressed);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, (GLint)level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+        if (!isCompressed || size <= 0)
+        {
+            compressed = false;
+            break;
+        }
+
+        blocks[level].width = cooked.width;
+        blocks[level].height = cooked.height;
+        blocks[level].data.resize((size_t)size);
+        glGetCompressedTexImage(GL_TEXTURE_2D, (GLint)level, blocks[level].data.data());
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDeleteTextures(1, &texture);
+    return compressed && glGetError() == GL_NO_ERROR;
+}
+
+static bool writeCooked(const std::string& destination, const std::vector<CookedLevel>& levels, bool compressed)
+{
+    CookedTextureHeader header = {};
+    std::memcpy(header.magic, "OTEX", 4);
+    header.version = CookedTexture::VERSION;
+    header.internalFormat = compressed ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_RGBA8;
+    header.format = compressed ? 0 : GL_RGBA;
+    header.type = compressed ? 0 : GL_UNSIGNED_BYTE;
+    header.width = (uint32_t)levels[0].width;
+    header.height = (uint32_t)levels[0].height;
+    header.levelCount = (uint32_t)levels.size();
+    header.flags = compressed ? CookedTexture::COMPRESSED : 0;
+
+    std::vector<CookedTextureLevel> table(levels.size());
+    uint64_t offset = sizeof(CookedTextureHeader) + table.size() * sizeof(CookedTextureLevel);
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        offset = (offset + 15) & ~(uint64_t)15;
+        table[i].offset = offset;
+        table[i].size = levels[i].data.size();
+        table[i].width = (uint32_t)levels[i].width;
+        table[i].height = (uint32_t)levels[i].height;
+        offset += table[i].size;
+    }
+
+    // Write beside the destination and rename, a concurrent load never maps a half written file
+    std::string temporary = destination + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)table.data(), table.size() * sizeof(CookedTextureLevel));
+        static const char padding[16] = {};
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+            out.write(padding, table[i].offset - (uint64_t)out.tellp());
+            out.write((const char*)levels[i].data.data(), levels[i].data.size());
+        }
+        if (!out)
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, destination, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+bool TextureCooker::cookPixels(const unsigned char* rgba, int width, int height, const std::string& destination)
+{
+    std::vector<CookedLevel> levels;
+    buildMipChain(rgba, width, height, levels);
+    return writeCooked(destination, levels, false);
+}
+
+bool TextureCooker::cook(const std::string& source, const std::string& destination, bool compress)
+{
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load_thread(true); // Flip texture vertically
+    unsigned char* pixels = stbi_load(source.c_str(), &width, &height, &channels, 4);
+    if (!pixels)
+    {
+        std::cout << "Failed to decode texture: " << source << std::endl;
+        return false;
+    }
+
+    std::vector<CookedLevel> levels;
+    buildMipChain(pixels, width, height, levels);
+    stbi_image_free(pixels);
+
+    if (compress)
+    {
+        std::vector<CookedLevel> blocks;
+        if (supportsCompression() && compressLevels(levels, blocks))
+            return writeCooked(destination, blocks, true);
+        std::cout << "DXT5 compression unavailable, cooking " << source << " uncompressed" << std::endl;
+    }
+
+    return writeCooked(destination, levels, false);
+}
@@ -0,0 +1,550 @@
+#include "Textures/TextureManager.h"
+#include "Textures/TextureCooker.h"
+
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+const int TextureManager::MAX_DECODERS;
+TextureManager* TextureManager::instance = nullptr;
+
+TextureManager::TextureManager()
+{
+    this->frame = 0;
+    this->residentBytes = 0;
+    this->activeDecoders = 0;
+    this->decodeJobs = 0;
+    this->cookedTextures = true;
+}
+
+TextureManager* TextureManager::getInstance()
+{
+    if (!instance)
+    {
+        instance = new TextureManager();
+    }
+
+    return instance;
+}
+
+std::string TextureManager::canonicalPath(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(std::filesystem::path(path), error);
+    if (error)
+        return path;
+    return canonical.lexically_normal().string();
+}
+
+uint64_t TextureManager::hashContent(const std::vector<unsigned char>& bytes)
+{
+    // FNV-1a, cheap next to decoding the image
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char byte : bytes)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool TextureManager::readFile(const std::string& path, std::vector<unsigned char>& bytes)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    bytes.resize((size_t)size);
+    return size > 0 && file.read((char*)bytes.data(), size);
+}
+
+unsigned int TextureManager::acquire(const std::string& path, Usage usage, bool matchContent, LoadedCallback onLoaded)
+{
+    std::string key = canonicalPath(path);
+    auto known = this->byPath.find(key);
+    if (known != this->byPath.end())
+    {
+        unsigned int handle = known->second;
+        addReference(handle);
+        if (onLoaded)
+        {
+            auto pending = std::find_if(this->uploads.begin(), this->uploads.end(),
+                [handle](const std::shared_ptr<Upload>& upload) { return upload->handle == handle; });
+            if (pending != this->uploads.end())
+                (*pending)->callbacks.push_back(onLoaded);
+            else
+                onLoaded(handle, this->textures[handle].resident);
+        }
+        return handle;
+    }
+
+    std::shared_ptr<Upload> upload = std::make_shared<Upload>();
+    uint64_t contentHash = 0;
+    if (matchContent)
+    {
+        if (!readFile(key, upload->fileBytes))
+        {
+            std::cout << "Failed to load texture: " << path << std::endl;
+            return 0;
+        }
+
+        contentHash = hashContent(upload->fileBytes);
+        auto same = this->byContent.find(contentHash);
+        if (same != this->byContent.end())
+        {
+            // Same image under another name, remember the alias and skip the decode
+            this->byPath[key] = same->second;
+            return acquire(key, usage, false, onLoaded);
+        }
+    }
+    else
+    {
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(key, error))
+        {
+            std::cout << "Failed to load texture: " << path << std::endl;
+            return 0;
+        }
+    }
+
+    unsigned int handle = createPlaceholder(usage);
+
+    Texture texture;
+    texture.path = key;
+    texture.contentHash = contentHash;
+    texture.refCount = 1;
+    texture.releaseFrame = 0;
+    texture.bytes = 0;
+    texture.resident = false;
+    this->textures[handle] = texture;
+    this->byPath[key] = handle;
+    if (matchContent)
+        this->byContent[contentHash] = handle;
+
+    upload->handle = handle;
+    upload->path = key;
+    if (this->cookedTextures)
+    {
+        // A stale, unreadable or unsupported cooked file is simply cooked again
+        CookedTextureHeader header;
+        upload->cookedPath = TextureCooker::getCookedPath(key);
+        upload->useCooked = TextureCooker::isUpToDate(key, upload->cookedPath)
+            && CookedTexture::readHeader(upload->cookedPath, header)
+            && (!(header.flags & CookedTexture::COMPRESSED) || TextureCooker::supportsCompression());
+    }
+    if (onLoaded)
+        upload->callbacks.push_back(onLoaded);
+    this->uploads.push_back(upload);
+
+    bool startDecoder = false;
+    {
+        std::lock_guard<std::mutex> lock(this->decodeMutex);
+        this->decodeQueue.push_back(upload);
+        if (this->activeDecoders < getDecoderLimit())
+        {
+            this->activeDecoders++;
+            startDecoder = true;
+        }
+    }
+    if (startDecoder)
+        JobSystem::getInstance()->runBackground([this] { decodeLoop(); }, &this->decodeJobs);
+
+    return handle;
+}
+
+unsigned int TextureManager::createPlaceholder(Usage usage)
+{
+    // Mid grey for colour, an undisturbed tangent space normal for normal maps
+    static const unsigned char colorTexel[4] = { 128, 128, 128, 255 };
+    static const unsigned char normalTexel[4] = { 128, 128, 255, 255 };
+
+    unsigned int handle = 0;
+    glGenTextures(1, &handle);
+    glBindTexture(GL_TEXTURE_2D, handle);
+
+    // Set texture parameters, no mips until the real image arrives
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, usage == NORMAL_TEXTURE ? normalTexel : colorTexel);
+
+    return handle;
+}
+
+int TextureManager::getDecoderLimit()
+{
+    // Leave the render thread alone, decoding more than a few images at once only thrashes memory
+    int workers = JobSystem::getInstance()->getThreadCount() - 1;
+    return std::min(MAX_DECODERS, std::max(1, workers));
+}
+
+void TextureManager::cancelDecodes()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->decodeMutex);
+        this->decodeQueue.clear();
+    }
+
+    // Running decoders finish the image they hold and find the queue empty
+    JobSystem::getInstance()->wait(this->decodeJobs);
+}
+
+void TextureManager::decodeLoop()
+{
+    stbi_set_flip_vertically_on_load_thread(true); // Flip texture vertically
+
+    while (true)
+    {
+        std::shared_ptr<Upload> upload;
+        {
+            std::lock_guard<std::mutex> lock(this->decodeMutex);
+            if (this->decodeQueue.empty())
+            {
+                this->activeDecoders--;
+                return;
+            }
+
+            upload = this->decodeQueue.front();
+            this->decodeQueue.pop_front();
+            if (upload->cancelled)
+                continue;
+        }
+
+        // The upload's cooked mapping belongs to this decoder until decoded is set
+        bool mapped = upload->useCooked && upload->cooked.open(upload->cookedPath);
+
+        int width = 0, height = 0, channels = 0;
+        unsigned char* pixels = nullptr;
+        if (!mapped)
+        {
+            if (!upload->fileBytes.empty() || readFile(upload->path, upload->fileBytes))
+                pixels = stbi_load_from_memory(upload->fileBytes.data(), (int)upload->fileBytes.size(), &width, &height, &channels, 4);
+            if (!pixels)
+                std::cout << "Failed to decode texture: " << upload->path << std::endl;
+
+            // First load of this source, cook it for the next run and stream the cooked mips now
+            if (pixels && !upload->cookedPath.empty() && TextureCooker::cookPixels(pixels, width, height, upload->cookedPath))
+            {
+                mapped = upload->cooked.open(upload->cookedPath);
+                if (mapped)
+                {
+                    stbi_image_free(pixels);
+                    pixels = nullptr;
+                }
+            }
+        }
+        if (mapped)
+            upload->cooked.prefetch();
+
+        {
+            std::lock_guard<std::mutex> lock(this->decodeMutex);
+            std::vector<unsigned char>().swap(upload->fileBytes);
+            if (upload->cancelled)
+            {
+                stbi_image_free(pixels);
+                pixels = nullptr;
+                upload->cooked.close();
+                mapped = false;
+            }
+            upload->pixels = pixels;
+            upload->mapped = mapped;
+            upload->width = width;
+            upload->height = height;
+            upload->channels = 4;
+            upload->decoded = true;
+        }
+        this->decodeDone.notify_all();
+    }
+}
+
+bool TextureManager::stage(Upload& upload, size_t& budget)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->decodeMutex);
+        if (!upload.decoded)
+            return false;
+    }
+
+    if (upload.mapped)
+        return stageCooked(upload, budget);
+
+    if (!upload.pixels)
+    {
+        finishUpload(upload, false);
+        return true;
+    }
+
+    size_t totalBytes = (size_t)upload.width * upload.height * upload.channels;
+    if (upload.pixelBuffer == 0)
+    {
+        glGenBuffers(1, &upload.pixelBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, totalBytes, nullptr, GL_STREAM_DRAW);
+    }
+    else
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.pixelBuffer);
+
+    // Copy the next slice, the buffer is not in use by GL until the final glTexImage2D
+    size_t slice = std::min(budget, totalBytes - upload.stagedBytes);
+    if (slice > 0)
+    {
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, upload.stagedBytes, slice,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (mapped)
+        {
+            std::memcpy(mapped, upload.pixels + upload.stagedBytes, slice);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            upload.stagedBytes += slice;
+            budget -= slice;
+        }
+        else
+        {
+            std::cout << "Failed to map texture upload buffer: " << upload.path << std::endl;
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            finishUpload(upload, false);
+            return true;
+        }
+    }
+
+    if (upload.stagedBytes < totalBytes)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+
+    // Everything staged, the driver copies from the pixel buffer without stalling this thread
+    glBindTexture(GL_TEXTURE_2D, upload.handle);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, upload.width, upload.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // Trilinear filtering
+
+    upload.residentBytes = (size_t)upload.width * upload.height * 4 * 4 / 3;
+    finishUpload(upload, true);
+    return true;
+}
+
+bool TextureManager::stageCooked(Upload& upload, size_t& budget)
+{
+    CookedTexture& cooked = upload.cooked;
+    const CookedTextureHeader& header = cooked.getHeader();
+    int levelCount = (int)cooked.getLevelCount();
+    if (upload.nextLevel < 0)
+        upload.nextLevel = levelCount - 1;
+
+    glBindTexture(GL_TEXTURE_2D, upload.handle);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    // At least one level per call so a level larger than the budget still goes in
+    do
+    {
+        const CookedTextureLevel& level = cooked.getLevel(upload.nextLevel);
+        const unsigned char* data = cooked.getLevelData(upload.nextLevel);
+        if (cooked.isCompressed())
+            glCompressedTexImage2D(GL_TEXTURE_2D, upload.nextLevel, header.internalFormat, level.width, level.height, 0, (GLsizei)level.size, data);
+        else
+            glTexImage2D(GL_TEXTURE_2D, upload.nextLevel, header.internalFormat, level.width, level.height, 0, header.format, header.type, data);
+
+        // Sample only the levels uploaded so far, the placeholder in level 0 is ignored until replaced
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, upload.nextLevel);
+        upload.residentBytes += (size_t)level.size;
+        budget -= std::min(budget, (size_t)level.size);
+        upload.nextLevel--;
+    } while (upload.nextLevel >= 0 && budget > 0);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // Trilinear filtering
+    if (upload.nextLevel >= 0)
+        return false;
+
+    finishUpload(upload, true);
+    return true;
+}
+
+void TextureManager::finishUpload(Upload& upload, bool loaded)
+{
+    if (upload.pixelBuffer != 0)
+        glDeleteBuffers(1, &upload.pixelBuffer);
+    upload.pixelBuffer = 0;
+
+    Texture& texture = this->textures[upload.handle];
+    if (loaded)
+    {
+        texture.bytes = upload.residentBytes;
+        this->residentBytes += texture.bytes;
+    }
+    texture.resident = loaded;
+
+    stbi_image_free(upload.pixels);
+    upload.pixels = nullptr;
+    upload.cooked.close();
+
+    for (LoadedCallback& callback : upload.callbacks)
+        callback(upload.handle, loaded);
+    upload.callbacks.clear();
+}
+
+void TextureManager::update()
+{
+    size_t budget = UPLOAD_BUDGET_BYTES;
+
+    // Oldest requests first, a load still decoding doesn't hold back the ones behind it
+    for (size_t i = 0; i < this->uploads.size() && budget > 0;)
+    {
+        std::shared_ptr<Upload> upload = this->uploads[i];
+        if (stage(*upload, budget))
+            this->uploads.erase(this->uploads.begin() + i);
+        else
+            i++;
+    }
+}
+
+bool TextureManager::isResident(unsigned int handle)
+{
+    auto it = this->textures.find(handle);
+    return it != this->textures.end() && it->second.resident;
+}
+
+bool TextureManager::wait(unsigned int handle)
+{
+    auto pending = std::find_if(this->uploads.begin(), this->uploads.end(),
+        [handle](const std::shared_ptr<Upload>& upload) { return upload->handle == handle; });
+
+    if (pending != this->uploads.end())
+    {
+        std::shared_ptr<Upload> upload = *pending;
+        {
+            std::unique_lock<std::mutex> lock(this->decodeMutex);
+            this->decodeDone.wait(lock, [&upload] { return upload->decoded; });
+        }
+
+        size_t unlimited = (size_t)-1;
+        stage(*upload, unlimited);
+        this->uploads.erase(std::find(this->uploads.begin(), this->uploads.end(), upload));
+    }
+
+    return isResident(handle);
+}
+
+void TextureManager::waitAll()
+{
+    while (!this->uploads.empty())
+        wait(this->uploads.front()->handle);
+}
+
+void TextureManager::addReference(unsigned int handle)
+{
+    Texture& texture = this->textures[handle];
+    if (texture.refCount++ == 0)
+        this->unreferenced.erase(std::remove(this->unreferenced.begin(), this->unreferenced.end(), handle), this->unreferenced.end());
+}
+
+void TextureManager::retain(unsigned int handle)
+{
+    if (this->textures.count(handle))
+        addReference(handle);
+}
+
+void TextureManager::release(unsigned int handle)
+{
+    auto it = this->textures.find(handle);
+    if (it == this->textures.end() || it->second.refCount == 0)
+        return;
+
+    // Keep the texture around for a few frames, draws already queued may still use it
+    if (--it->second.refCount == 0)
+    {
+        it->second.releaseFrame = this->frame;
+        this->unreferenced.push_back(handle);
+    }
+}
+
+void TextureManager::endFrame()
+{
+    this->frame++;
+
+    for (size_t i = 0; i < this->unreferenced.size();)
+    {
+        unsigned int handle = this->unreferenced[i];
+        if (this->frame - this->textures[handle].releaseFrame >= DELETE_DELAY_FRAMES)
+        {
+            this->unreferenced[i] = this->unreferenced.back();
+            this->unreferenced.pop_back();
+            destroy(handle);
+        }
+        else
+            i++;
+    }
+}
+
+void TextureManager::destroy(unsigned int handle)
+{
+    auto it = this->textures.find(handle);
+    if (it == this->textures.end())
+        return;
+
+    // Drop every path aliasing this texture
+    for (auto alias = this->byPath.begin(); alias != this->byPath.end();)
+    {
+        if (alias->second == handle)
+            alias = this->byPath.erase(alias);
+        else
+            ++alias;
+    }
+    auto content = this->byContent.find(it->second.contentHash);
+    if (content != this->byContent.end() && content->second == handle)
+        this->byContent.erase(content);
+
+    // Abandon a load still in flight, the decode job frees whatever it decodes
+    auto pending = std::find_if(this->uploads.begin(), this->uploads.end(),
+        [handle](const std::shared_ptr<Upload>& upload) { return upload->handle == handle; });
+    if (pending != this->uploads.end())
+    {
+        cancel(**pending);
+        this->uploads.erase(pending);
+    }
+
+    this->residentBytes -= it->second.bytes;
+    this->textures.erase(it);
+    glDeleteTextures(1, &handle);
+}
+
+void TextureManager::cancel(Upload& upload)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->decodeMutex);
+        upload.cancelled = true;
+        stbi_image_free(upload.pixels);
+        upload.pixels = nullptr;
+        // Before decoded is set the decode job still uses the mapping and closes it itself
+        if (upload.decoded)
+            upload.cooked.close();
+    }
+
+    if (upload.pixelBuffer != 0)
+        glDeleteBuffers(1, &upload.pixelBuffer);
+    upload.pixelBuffer = 0;
+}
+
+void TextureManager::clear()
+{
+    cancelDecodes();
+    for (std::shared_ptr<Upload>& upload : this->uploads)
+        cancel(*upload);
+    this->uploads.clear();
+
+    for (auto& entry : this->textures)
+        glDeleteTextures(1, &entry.first);
+
+    this->textures.clear();
+    this->byPath.clear();
+    this->byContent.clear();
+    this->unreferenced.clear();
+    this->residentBytes = 0;
+}
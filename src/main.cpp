@@ -1,13 +1,18 @@
 #include "windowing/Mainwindow.h"
+#include "windowing/EngineSettings.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #include <iostream>
 
-int main()
+int main(int argc, char** argv)
 {
-    MainWindow* window = new MainWindow();
+    EngineSettings settings;
+    if (!settings.parseArguments(argc, argv))
+        return 1;
+
+    MainWindow* window = new MainWindow(settings);
     if (window->isAlive())
         window->exec();
 
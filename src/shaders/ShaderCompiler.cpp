@@ -0,0 +1,152 @@
+#include "shaders/ShaderCompiler.h"
+#include "shaders/ShaderProgram.h"
+#include "Profiling/Profiler.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <iostream>
+
+// Same entry point for the KHR and ARB versions of parallel shader compile
+typedef void (APIENTRY* MaxShaderCompilerThreadsFunction)(GLuint count);
+
+ShaderCompiler* ShaderCompiler::instance = nullptr;
+
+ShaderCompiler* ShaderCompiler::getInstance()
+{
+    if (!instance)
+    {
+        instance = new ShaderCompiler();
+    }
+
+    return instance;
+}
+
+ShaderCompiler::ShaderCompiler()
+{
+    this->context = nullptr;
+    this->running = false;
+    this->stopping = false;
+}
+
+bool ShaderCompiler::start(GLFWwindow* shareWith)
+{
+    if (this->running)
+        return true;
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    this->context = glfwCreateWindow(1, 1, "Shader compiler", nullptr, shareWith);
+    if (!this->context)
+    {
+        std::cout << "No shared context for shader compilation, compiling on the render thread" << std::endl;
+        return false;
+    }
+
+    this->stopping = false;
+    this->running = true;
+    this->thread = std::thread(&ShaderCompiler::compilerLoop, this);
+    return true;
+}
+
+void ShaderCompiler::stop()
+{
+    if (!this->running)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->queued.notify_all();
+    this->thread.join();
+
+    glfwDestroyWindow(this->context);
+    this->context = nullptr;
+    this->running = false;
+}
+
+void ShaderCompiler::submit(ShaderProgram* program)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->pending.push_back(program);
+    }
+    this->queued.notify_one();
+}
+
+void ShaderCompiler::wait(ShaderProgram* program)
+{
+    PROFILE_ZONE("Shader compile wait");
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (!this->running)
+    {
+        // No thread, the caller's context compiles everything queued so far in one batch
+        std::deque<ShaderProgram*> batch;
+        batch.swap(this->pending);
+        lock.unlock();
+        compileBatch(batch);
+        return;
+    }
+
+    this->finished.wait(lock, [this, program] {
+        return this->compiling.count(program) == 0 && std::find(this->pending.begin(), this->pending.end(), program) == this->pending.end();
+    });
+}
+
+void ShaderCompiler::compileBatch(const std::deque<ShaderProgram*>& batch)
+{
+    for (ShaderProgram* program : batch)
+        program->beginLink(program->vertexSource, program->fragmentSource, program->defines);
+    for (ShaderProgram* program : batch)
+        program->endLink();
+}
+
+void ShaderCompiler::compilerLoop()
+{
+    glfwMakeContextCurrent(this->context);
+    PROFILE_THREAD("Shader compiler");
+
+    // Let the driver spread a batch over as many threads as it likes
+    const char* extensions[] = { "GL_KHR_parallel_shader_compile", "GL_ARB_parallel_shader_compile" };
+    const char* functions[] = { "glMaxShaderCompilerThreadsKHR", "glMaxShaderCompilerThreadsARB" };
+    for (int i = 0; i < 2; i++)
+    {
+        MaxShaderCompilerThreadsFunction maxThreads = nullptr;
+        if (glfwExtensionSupported(extensions[i]))
+            maxThreads = (MaxShaderCompilerThreadsFunction)glfwGetProcAddress(functions[i]);
+        if (maxThreads)
+        {
+            maxThreads(0xFFFFFFFFu);
+            break;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true)
+    {
+        this->queued.wait(lock, [this] { return !this->pending.empty() || this->stopping; });
+        if (this->pending.empty())
+            break;
+
+        std::deque<ShaderProgram*> batch;
+        batch.swap(this->pending);
+        this->compiling.insert(batch.begin(), batch.end());
+        lock.unlock();
+
+        {
+            PROFILE_ZONE("Compile shader batch");
+            compileBatch(batch);
+            // Linked state has to reach the GL thread's context before it uses the programs
+            glFinish();
+        }
+
+        lock.lock();
+        for (ShaderProgram* program : batch)
+            this->compiling.erase(program);
+        this->finished.notify_all();
+    }
+
+    lock.unlock();
+    glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,437 @@
+#include "shaders/ShaderProgram.h"
+#include "shaders/ShaderVariants.h"
+#include "shaders/VertexShader.h"
+#include "shaders/FragmentShader.h"
+#include "shaders/FrameDataBlock.h"
+#include "Rendering/FrameUniformBuffer.h"
+#include "shaders/ShaderCompiler.h"
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+std::unordered_map<std::string, ShaderProgram*> ShaderProgram::sharedPrograms;
+unsigned int ShaderProgram::boundHandle = 0;
+unsigned int ShaderProgram::nextId = 0;
+
+std::string ShaderProgram::cacheDirectory;
+std::string ShaderProgram::driverKey;
+bool ShaderProgram::binariesSupported = false;
+std::atomic<int> ShaderProgram::cacheHits(0);
+std::atomic<int> ShaderProgram::cacheMisses(0);
+
+static const char* uniformNames[ShaderProgram::UNIFORM_COUNT] = {
+    "model"
+};
+
+static const char* versionLine = "#version 330 core\n";
+
+// Cached program binary file, the driver's blob follows the header
+struct ProgramBinaryHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t length;
+};
+
+static const char programBinaryMagic[4] = { 'O', 'P', 'R', 'G' };
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+ShaderProgram* ShaderProgram::getDefault()
+{
+    return getShared(ShaderVariants::getDefines(ShaderVariants::NORMAL_MAP | ShaderVariants::SPECULAR));
+}
+
+ShaderProgram* ShaderProgram::getShared(const std::string& defines)
+{
+    auto it = sharedPrograms.find(defines);
+    if (it != sharedPrograms.end())
+    {
+        ShaderProgram* program = it->second;
+        if (program->pending)
+        {
+            ShaderCompiler::getInstance()->wait(program);
+            program->pending = false;
+            if (program->handle == 0)
+            {
+                sharedPrograms.erase(it);
+                delete program;
+                return nullptr;
+            }
+            program->reflectUniforms();
+        }
+        return program;
+    }
+
+    ShaderProgram* program = new ShaderProgram();
+    if (!program->compile(vertexShader, fragmentShader, defines))
+    {
+        delete program;
+        return nullptr;
+    }
+
+    sharedPrograms[defines] = program;
+    return program;
+}
+
+void ShaderProgram::preload(const std::string& defines)
+{
+    if (sharedPrograms.count(defines) > 0)
+        return;
+
+    ShaderProgram* program = new ShaderProgram();
+    program->vertexSource = vertexShader;
+    program->fragmentSource = fragmentShader;
+    program->defines = defines;
+    program->pending = true;
+    sharedPrograms[defines] = program;
+    ShaderCompiler::getInstance()->submit(program);
+}
+
+void ShaderProgram::releaseAll()
+{
+    for (auto& entry : sharedPrograms)
+    {
+        // The compiler may still be using it
+        if (entry.second->pending)
+            ShaderCompiler::getInstance()->wait(entry.second);
+        delete entry.second;
+    }
+    sharedPrograms.clear();
+}
+
+void ShaderProgram::setCacheDirectory(const std::string& directory)
+{
+    cacheDirectory = directory;
+
+    // Core from 4.1, before that ARB_get_program_binary, which may also offer no formats at all
+    GLint formats = 0;
+    if (glGetProgramBinary && glProgramBinary && glProgramParameteri)
+    {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        glGetError();
+    }
+    binariesSupported = formats > 0;
+    if (!directory.empty() && !binariesSupported)
+        std::cout << "Program binaries not supported, shaders are always compiled" << std::endl;
+
+    // A driver update invalidates every binary, keep them apart by driver
+    const char* strings[] = { (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION) };
+    driverKey.clear();
+    for (const char* string : strings)
+    {
+        driverKey += string ? string : "";
+        driverKey += '\n';
+    }
+}
+
+ShaderProgram::ShaderProgram()
+{
+    this->handle = 0;
+    this->id = nextId++;
+    for (int i = 0; i < UNIFORM_COUNT; i++)
+        this->locations[i] = -1;
+
+    this->vertexSource = nullptr;
+    this->fragmentSource = nullptr;
+    this->stages[0] = 0;
+    this->stages[1] = 0;
+    this->fromCache = false;
+    this->pending = false;
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    if (this->handle != 0)
+    {
+        if (boundHandle == this->handle)
+            boundHandle = 0;
+        glDeleteProgram(this->handle);
+    }
+}
+
+static unsigned int startStage(GLenum stage, const char* source, const std::string& defines)
+{
+    const char* sources[] = { versionLine, defines.c_str(), "\n", frameDataBlock, source };
+
+    unsigned int shaderHandle = glCreateShader(stage);
+    glShaderSource(shaderHandle, 5, sources, nullptr);
+    glCompileShader(shaderHandle);
+    return shaderHandle;
+}
+
+static bool checkStage(unsigned int shaderHandle, const char* label)
+{
+    int success;
+    glGetShaderiv(shaderHandle, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shaderHandle, 512, nullptr, infoLog);
+        std::cout << label << " compilation failed: " << infoLog << std::endl;
+    }
+    return success != 0;
+}
+
+static uint64_t hashString(uint64_t hash, const char* string)
+{
+    // FNV-1a, the terminator separates consecutive strings
+    for (const char* c = string; ; c++)
+    {
+        hash ^= (unsigned char)*c;
+        hash *= 1099511628211ull;
+        if (*c == 0)
+            return hash;
+    }
+}
+
+bool ShaderProgram::compile(const char* vertexSource, const char* fragmentSource, const std::string& defines)
+{
+    if (!vertexSource || !fragmentSource) {
+        std::cout << "Shader source is null" << std::endl;
+        return false;
+    }
+
+    beginLink(vertexSource, fragmentSource, defines);
+    if (!endLink())
+        return false;
+
+    reflectUniforms();
+    return true;
+}
+
+void ShaderProgram::beginLink(const char* vertexSource, const char* fragmentSource, const std::string& defines)
+{
+    this->vertexSource = vertexSource;
+    this->fragmentSource = fragmentSource;
+    this->defines = defines;
+    this->handle = glCreateProgram();
+    this->fromCache = false;
+    this->cachePath.clear();
+
+    if (!cacheDirectory.empty() && binariesSupported)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        const char* parts[] = { driverKey.c_str(), versionLine, defines.c_str(), frameDataBlock, vertexSource, fragmentSource };
+        for (const char* part : parts)
+            hash = hashString(hash, part);
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.oprg", (unsigned long long)hash);
+        this->cachePath = (std::filesystem::path(cacheDirectory) / name).string();
+        this->fromCache = loadBinary();
+    }
+
+    if (!this->fromCache)
+        beginCompile();
+}
+
+void ShaderProgram::beginCompile()
+{
+    // Status is only queried in endLink, so a driver compiling in parallel isn't waited on here
+    this->stages[0] = startStage(GL_VERTEX_SHADER, this->vertexSource, this->defines);
+    this->stages[1] = startStage(GL_FRAGMENT_SHADER, this->fragmentSource, this->defines);
+    glAttachShader(this->handle, this->stages[0]);
+    glAttachShader(this->handle, this->stages[1]);
+    if (!this->cachePath.empty())
+        glProgramParameteri(this->handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(this->handle);
+}
+
+bool ShaderProgram::endLink()
+{
+    int success;
+    glGetProgramiv(this->handle, GL_LINK_STATUS, &success);
+    if (!success && this->fromCache)
+    {
+        // Binaries go stale with driver changes the version string doesn't show, compile instead
+        this->fromCache = false;
+        glDeleteProgram(this->handle);
+        this->handle = glCreateProgram();
+        beginCompile();
+        glGetProgramiv(this->handle, GL_LINK_STATUS, &success);
+    }
+
+    bool stagesCompiled = true;
+    if (!this->fromCache)
+    {
+        stagesCompiled = checkStage(this->stages[0], "Vertex Shader");
+        stagesCompiled = checkStage(this->stages[1], "Fragment Shader") && stagesCompiled;
+        glDeleteShader(this->stages[0]);
+        glDeleteShader(this->stages[1]);
+        this->stages[0] = 0;
+        this->stages[1] = 0;
+    }
+
+    if (!success) {
+        if (stagesCompiled)
+        {
+            char infoLog[512];
+            glGetProgramInfoLog(this->handle, 512, nullptr, infoLog);
+            std::cout << "Shader Program linking failed: " << infoLog << std::endl;
+        }
+        glDeleteProgram(this->handle);
+        this->handle = 0;
+        return false;
+    }
+
+    if (this->fromCache)
+        cacheHits++;
+    else if (!this->cachePath.empty())
+    {
+        cacheMisses++;
+        saveBinary();
+    }
+    return true;
+}
+
+bool ShaderProgram::loadBinary()
+{
+    std::ifstream in(this->cachePath, std::ios::binary);
+    if (!in)
+        return false;
+
+    ProgramBinaryHeader header;
+    in.read((char*)&header, sizeof(header));
+    if (!in || std::memcmp(header.magic, programBinaryMagic, 4) != 0 || header.version != PROGRAM_BINARY_VERSION)
+        return false;
+
+    std::vector<char> binary(header.length);
+    in.read(binary.data(), binary.size());
+    if (!in)
+        return false;
+
+    // Rejected binaries show up as a failed link in endLink
+    glProgramBinary(this->handle, header.format, binary.data(), (GLsizei)binary.size());
+    return true;
+}
+
+void ShaderProgram::saveBinary()
+{
+    GLint length = 0;
+    glGetProgramiv(this->handle, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(this->handle, length, &written, &format, binary.data());
+    if (written <= 0)
+        return;
+
+    ProgramBinaryHeader header;
+    std::memcpy(header.magic, programBinaryMagic, 4);
+    header.version = PROGRAM_BINARY_VERSION;
+    header.format = format;
+    header.length = (uint32_t)written;
+
+    // Write beside the destination and rename, a crash never leaves a truncated binary behind
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+    std::string temporary = this->cachePath + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write((const char*)&header, sizeof(header));
+        out.write(binary.data(), written);
+        if (!out)
+        {
+            std::cout << "Failed to write program binary " << temporary << std::endl;
+            return;
+        }
+    }
+
+    std::filesystem::rename(temporary, this->cachePath, error);
+    if (error)
+        std::filesystem::remove(temporary, error);
+}
+
+void ShaderProgram::reflectUniforms()
+{
+    bind();
+
+    unsigned int frameBlock = glGetUniformBlockIndex(this->handle, "FrameData");
+    if (frameBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(this->handle, frameBlock, FrameUniformBuffer::BINDING_POINT);
+
+    int uniformCount = 0;
+    glGetProgramiv(this->handle, GL_ACTIVE_UNIFORMS, &uniformCount);
+
+    int nextFreeUnit = FIRST_FREE_UNIT;
+    for (int i = 0; i < uniformCount; i++)
+    {
+        char nameBuffer[256];
+        GLsizei nameLength = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(this->handle, i, sizeof(nameBuffer), &nameLength, &size, &type, nameBuffer);
+
+        // Arrays are reported as "name[0]", store them under their base name
+        std::string name(nameBuffer, nameLength);
+        size_t bracket = name.find('[');
+        if (bracket != std::string::npos)
+            name = name.substr(0, bracket);
+
+        int location = glGetUniformLocation(this->handle, nameBuffer);
+        if (location < 0)
+            continue; // uniform block member
+
+        this->uniformLocations[name] = location;
+
+        // Samplers never change unit, assign them once here instead of every draw
+        if (type == GL_SAMPLER_2D || type == GL_SAMPLER_CUBE || type == GL_SAMPLER_BUFFER || type == GL_SAMPLER_2D_ARRAY
+            || type == GL_UNSIGNED_INT_SAMPLER_BUFFER || type == GL_INT_SAMPLER_BUFFER)
+        {
+            int unit;
+            if (name == "texture1")
+                unit = ALBEDO_UNIT;
+            else if (name == "normalMap")
+                unit = NORMAL_MAP_UNIT;
+            else if (name == "lightData")
+                unit = LIGHT_DATA_UNIT;
+            else if (name == "clusterGrid")
+                unit = CLUSTER_GRID_UNIT;
+            else if (name == "lightIndices")
+                unit = LIGHT_INDEX_UNIT;
+            else
+                unit = nextFreeUnit++;
+            glUniform1i(location, unit);
+            this->samplerUnits[name] = unit;
+        }
+    }
+
+    for (int i = 0; i < UNIFORM_COUNT; i++)
+        this->locations[i] = findUniform(uniformNames[i]);
+}
+
+void ShaderProgram::bind()
+{
+    if (boundHandle != this->handle)
+    {
+        glUseProgram(this->handle);
+        boundHandle = this->handle;
+    }
+}
+
+int ShaderProgram::findUniform(const std::string& name)
+{
+    auto it = this->uniformLocations.find(name);
+    if (it == this->uniformLocations.end())
+        return -1;
+
+    return it->second;
+}
+
+int ShaderProgram::findSamplerUnit(const std::string& name)
+{
+    auto it = this->samplerUnits.find(name);
+    if (it == this->samplerUnits.end())
+        return -1;
+
+    return it->second;
+}
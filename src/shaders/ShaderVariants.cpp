@@ -0,0 +1,47 @@
+#include "shaders/ShaderVariants.h"
+
+const uint32_t ShaderVariants::DYNAMIC_LIGHTING;
+const int ShaderVariants::MAX_UNROLLED_LIGHTS;
+
+uint32_t ShaderVariants::getLightingKey(bool clustered, int lightCount)
+{
+    if (clustered)
+        return CLUSTERED_BIT;
+    if (lightCount < 0 || lightCount > MAX_UNROLLED_LIGHTS)
+        return DYNAMIC_LIGHTING;
+
+    // Round up so a handful of buckets cover every small count
+    uint32_t bound = 0;
+    if (lightCount > 0)
+    {
+        bound = 1;
+        while (bound < (uint32_t)lightCount)
+            bound <<= 1;
+    }
+    return (bound + 1) << LIGHT_BOUND_SHIFT;
+}
+
+int ShaderVariants::getLightBound(uint32_t key)
+{
+    return (int)(key >> LIGHT_BOUND_SHIFT) - 1;
+}
+
+std::string ShaderVariants::getDefines(uint32_t key)
+{
+    std::string defines;
+    if (key & NORMAL_MAP)
+        defines += "#define NORMAL_MAP\n";
+    if (key & SPECULAR)
+        defines += "#define SPECULAR\n";
+    if (key & ALPHA_TEST)
+        defines += "#define ALPHA_TEST\n";
+    if (key & DEPTH_ONLY)
+        defines += "#define DEPTH_ONLY\n";
+    if (key & CLUSTERED_BIT)
+        defines += "#define CLUSTERED_LIGHTING\n";
+
+    int bound = getLightBound(key);
+    if (bound >= 0)
+        defines += "#define LIGHT_LOOP_BOUND " + std::to_string(bound) + "\n";
+    return defines;
+}
@@ -0,0 +1,323 @@
+#include "windowing/EngineSettings.h"
+#include "Rendering/VertexLayout.h"
+#include "Rendering/FramePipeline.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static bool readInt(int argc, char** argv, int& i, int& out)
+{
+    if (i + 1 >= argc)
+    {
+        std::cout << "Missing value for " << argv[i] << std::endl;
+        return false;
+    }
+
+    char* end = nullptr;
+    long value = std::strtol(argv[++i], &end, 10);
+    if (*end != '\0' || value < 0)
+    {
+        std::cout << "Invalid value for " << argv[i - 1] << ": " << argv[i] << std::endl;
+        return false;
+    }
+
+    out = (int)value;
+    return true;
+}
+
+static bool readFloat(int argc, char** argv, int& i, float& out)
+{
+    if (i + 1 >= argc)
+    {
+        std::cout << "Missing value for " << argv[i] << std::endl;
+        return false;
+    }
+
+    char* end = nullptr;
+    float value = std::strtof(argv[++i], &end);
+    if (*end != '\0' || !(value >= 0.f))
+    {
+        std::cout << "Invalid value for " << argv[i - 1] << ": " << argv[i] << std::endl;
+        return false;
+    }
+
+    out = value;
+    return true;
+}
+
+static bool readString(int argc, char** argv, int& i, std::string& out)
+{
+    if (i + 1 >= argc)
+    {
+        std::cout << "Missing value for " << argv[i] << std::endl;
+        return false;
+    }
+
+    out = argv[++i];
+    return true;
+}
+
+bool EngineSettings::parseArguments(int argc, char** argv)
+{
+    bool windowed = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        if (std::strcmp(arg, "--benchmark") == 0)
+            this->benchmark = true;
+        else if (std::strcmp(arg, "--headless") == 0)
+            this->headless = true;
+        else if (std::strcmp(arg, "--windowed") == 0)
+            windowed = true;
+        else if (std::strcmp(arg, "--frames") == 0)
+        {
+            if (!readInt(argc, argv, i, this->benchmarkFrames))
+                return false;
+        }
+        else if (std::strcmp(arg, "--warmup") == 0)
+        {
+            if (!readInt(argc, argv, i, this->warmupFrames))
+                return false;
+        }
+        else if (std::strcmp(arg, "--out") == 0)
+        {
+            if (!readString(argc, argv, i, this->benchmarkOutput))
+                return false;
+        }
+        else if (std::strcmp(arg, "--objects") == 0)
+        {
+            if (!readInt(argc, argv, i, this->objectCount))
+                return false;
+        }
+        else if (std::strcmp(arg, "--instances") == 0)
+        {
+            if (!readInt(argc, argv, i, this->instanceCount))
+                return false;
+        }
+        else if (std::strcmp(arg, "--vertex-format") == 0)
+        {
+            VertexLayout layout;
+            if (!readString(argc, argv, i, this->vertexFormat))
+                return false;
+            if (!VertexLayout::fromName(this->vertexFormat, layout))
+            {
+                std::cout << "Unknown vertex format: " << this->vertexFormat << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--mesh") == 0)
+        {
+            if (!readString(argc, argv, i, this->meshPath))
+                return false;
+        }
+        else if (std::strcmp(arg, "--mesh-benchmark") == 0)
+        {
+            this->meshBenchmark = true;
+            this->benchmark = true;
+        }
+        else if (std::strcmp(arg, "--cull-benchmark") == 0)
+        {
+            this->cullBenchmark = true;
+            this->benchmark = true;
+        }
+        else if (std::strcmp(arg, "--occlusion-benchmark") == 0)
+        {
+            this->occlusionBenchmark = true;
+            this->benchmark = true;
+        }
+        else if (std::strcmp(arg, "--transform-benchmark") == 0)
+        {
+            this->transformBenchmark = true;
+            this->benchmark = true;
+        }
+        else if (std::strcmp(arg, "--job-benchmark") == 0)
+        {
+            this->jobBenchmark = true;
+            this->benchmark = true;
+        }
+        else if (std::strcmp(arg, "--command-benchmark") == 0)
+        {
+            this->commandBenchmark = true;
+            this->benchmark = true;
+        }
+        else if (std::strcmp(arg, "--workers") == 0)
+        {
+            if (!readInt(argc, argv, i, this->jobWorkers))
+                return false;
+        }
+        else if (std::strcmp(arg, "--pipeline-depth") == 0)
+        {
+            if (!readInt(argc, argv, i, this->pipelineDepth))
+                return false;
+            if (this->pipelineDepth > FramePipeline::MAX_DEPTH)
+            {
+                std::cout << "Pipeline depth must be 0 to " << FramePipeline::MAX_DEPTH << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--lod-error") == 0)
+        {
+            if (!readFloat(argc, argv, i, this->lodErrorPixels))
+                return false;
+        }
+        else if (std::strcmp(arg, "--no-occlusion") == 0)
+            this->occlusionCulling = false;
+        else if (std::strcmp(arg, "--depth-prepass") == 0)
+        {
+            if (!readString(argc, argv, i, this->depthPrepass))
+                return false;
+            if (this->depthPrepass != "auto" && this->depthPrepass != "on" && this->depthPrepass != "off")
+            {
+                std::cout << "Unknown depth pre-pass mode: " << this->depthPrepass << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--overdraw") == 0)
+            this->overdrawView = true;
+        else if (std::strcmp(arg, "--prepass-compare") == 0)
+        {
+            this->prepassCompare = true;
+            this->benchmark = true;
+        }
+        else if (std::strcmp(arg, "--lighting") == 0)
+        {
+            std::string mode;
+            if (!readString(argc, argv, i, mode))
+                return false;
+
+            if (mode == "clustered")
+                this->clusteredLighting = true;
+            else if (mode == "brute")
+                this->clusteredLighting = false;
+            else
+            {
+                std::cout << "Unknown lighting mode: " << mode << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--lights") == 0)
+        {
+            if (!readInt(argc, argv, i, this->lightCount))
+                return false;
+        }
+        else if (std::strcmp(arg, "--light-sweep") == 0)
+        {
+            this->lightSweep = true;
+            this->benchmark = true;
+        }
+        else if (std::strcmp(arg, "--capture") == 0)
+        {
+            if (!readInt(argc, argv, i, this->captureFrames))
+                return false;
+        }
+        else if (std::strcmp(arg, "--capture-out") == 0)
+        {
+            if (!readString(argc, argv, i, this->captureOutput))
+                return false;
+        }
+        else if (std::strcmp(arg, "--assets") == 0)
+        {
+            if (!readString(argc, argv, i, this->assetDirectory))
+                return false;
+        }
+        else if (std::strcmp(arg, "--no-cooked") == 0)
+            this->cookedTextures = false;
+        else if (std::strcmp(arg, "--cook") == 0)
+        {
+            this->cookTextures = true;
+            this->headless = true;
+        }
+        else if (std::strcmp(arg, "--texture-benchmark") == 0)
+        {
+            this->textureBenchmark = true;
+            this->benchmark = true;
+        }
+        else if (std::strcmp(arg, "--no-shader-variants") == 0)
+            this->shaderVariants = false;
+        else if (std::strcmp(arg, "--shader-cache") == 0)
+        {
+            if (!readString(argc, argv, i, this->shaderCacheDirectory))
+                return false;
+        }
+        else if (std::strcmp(arg, "--no-shader-cache") == 0)
+            this->shaderCacheDirectory.clear();
+        else if (std::strcmp(arg, "--shader-benchmark") == 0)
+        {
+            this->shaderBenchmark = true;
+            this->benchmark = true;
+        }
+        else if (std::strcmp(arg, "--help") == 0)
+        {
+            printUsage();
+            return false;
+        }
+        else
+        {
+            std::cout << "Unknown argument: " << arg << std::endl;
+            printUsage();
+            return false;
+        }
+    }
+
+    // Benchmarks run offscreen unless a window was explicitly asked for
+    if (this->benchmark && !windowed)
+        this->headless = true;
+
+    if (this->meshBenchmark && this->meshPath.empty())
+    {
+        std::cout << "--mesh-benchmark needs --mesh" << std::endl;
+        return false;
+    }
+
+    if (this->benchmark && this->benchmarkFrames == 0)
+    {
+        std::cout << "--frames must be greater than 0" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void EngineSettings::printUsage()
+{
+    std::cout << "Usage: OptimEngine [options]\n"
+              << "  --benchmark       Run the scripted scene for a fixed frame count and write timings\n"
+              << "  --frames <n>      Measured benchmark frames (default 1000)\n"
+              << "  --warmup <n>      Frames rendered before measuring starts (default 60)\n"
+              << "  --out <file>      Benchmark JSON output path (default benchmark.json)\n"
+              << "  --headless        Render without a visible window\n"
+              << "  --windowed        Show the window while benchmarking\n"
+              << "  --objects <n>     Number of cubes in the scene (default 1)\n"
+              << "  --instances <n>   Draw n cubes with one instanced draw instead of --objects\n"
+              << "  --vertex-format <f> full (44 bytes), compact (24, default) or quantized (20) vertices\n"
+              << "  --mesh <file>     Draw an .obj, .gltf or .glb mesh instead of the cube\n"
+              << "  --mesh-benchmark  Time parsing --mesh against loading its cached .omesh\n"
+              << "  --cull-benchmark  Time SIMD against scalar frustum culling of 1M spheres\n"
+              << "  --occlusion-benchmark Time SIMD against scalar occluder rasterization and 100k occlusion tests\n"
+              << "  --transform-benchmark  Time world matrix updates of a ~100k node hierarchy\n"
+              << "  --job-benchmark   Time job scheduling overhead and parallelFor scaling over 1..N threads\n"
+              << "  --command-benchmark Time serial and parallel command recording and replay of 10k and 100k draws\n"
+              << "  --workers <n>     Job system worker threads (default one less than the core count)\n"
+              << "  --pipeline-depth <n> Frames simulated ahead of rendering: 0 (same thread), 1 or 2 (default)\n"
+              << "  --lod-error <px>  Screen space error mesh LODs may show (default 1), 0 disables LODs\n"
+              << "  --no-occlusion    Draw everything in the frustum, without culling objects hidden by the front layer\n"
+              << "  --depth-prepass <mode> auto (default, on for high depth complexity), on or off\n"
+              << "  --overdraw        Show how often each pixel is shaded instead of the lit scene (F2 toggles)\n"
+              << "  --prepass-compare Benchmark the scene with the depth pre-pass off and on\n"
+              << "  --lighting <mode> clustered (default) or brute force light loop\n"
+              << "  --lights <n>      Generate n point lights instead of the default two\n"
+              << "  --light-sweep     Benchmark both lighting modes from 4 to 1024 lights\n"
+              << "  --no-shader-variants Keep the dynamic light loop instead of unrolling it for up to 16 lights\n"
+              << "  --capture <n>     Write a chrome://tracing capture of the first n frames (debug builds)\n"
+              << "  --capture-out <f> Capture output path (default capture.json)\n"
+              << "  --assets <dir>    Directory containing the scene textures\n"
+              << "  --no-cooked       Always decode source images, never read or write .otex files\n"
+              << "  --cook            Cook the scene textures to .otex (DXT5 colour where supported) and exit\n"
+              << "  --texture-benchmark Time scene texture loads from JPEG against cooked .otex\n"
+              << "  --shader-cache <dir> Directory linked program binaries are cached in (default shadercache)\n"
+              << "  --no-shader-cache Always compile shaders, never read or write program binaries\n"
+              << "  --shader-benchmark Time cold against cached program builds, on the GL thread and the compiler thread\n";
+}
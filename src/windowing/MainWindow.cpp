@@ -1,68 +1,212 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 #include <cmath>
 #include <chrono>
+#include <string>
+#include <algorithm>
 
 #include "windowing/Mainwindow.h"
 #include "RenderObjects/Object.h"
+#include "RenderObjects/InstancedMesh.h"
 #include "Lighting/PointLight.h"
+#include "Lighting/LightController.h"
 #include "Camera/Camera.h"
 #include "Camera/CameraController.h"
+#include "Benchmark/Benchmarks.h"
+#include "Benchmark/FrameStats.h"
+#include "Benchmark/GpuFrameTimer.h"
+#include "Benchmark/FragmentCounter.h"
+#include "Benchmark/Random.h"
+#include "Profiling/Profiler.h"
+#include "shaders/ShaderProgram.h"
+#include "shaders/ShaderCompiler.h"
+#include "shaders/ShaderVariants.h"
+#include "Textures/TextureManager.h"
+#include "Scene/TransformStore.h"
+#include "Jobs/JobSystem.h"
+#include "Textures/TextureCooker.h"
+#include "Meshes/MeshImporter.h"
+#include "Rendering/VertexLayout.h"
+#include "Rendering/GeometryPool.h"
 
 const int MainWindow::WIDTH = 800;
 const int MainWindow::HEIGHT = 600;
 
+// Room for a few frames of uniforms and a full rewrite of every instance matrix
+static const size_t STREAM_BUFFER_SIZE = 8 * 1024 * 1024;
+
+// Estimated depth complexity the automatic depth pre-pass turns on above and off below again
+static const float PREPASS_ON_COMPLEXITY = 2.5f;
+static const float PREPASS_OFF_COMPLEXITY = 2.f;
+
+/*!
+    Fraction of the screen the projected disc of a sphere distance away covers, at most the whole screen
+*/
+static float getDiscCoverage(float pixelScale, float distance, float radius)
+{
+    if (distance <= radius)
+        return 1.f;
+
+    float pixels = radius * pixelScale / distance;
+    return std::min(3.14159265f * pixels * pixels / (float)(MainWindow::WIDTH * MainWindow::HEIGHT), 1.f);
+}
+
+static float getScreenCoverage(const glm::vec3& eye, float pixelScale, const glm::vec3& center, float radius)
+{
+    return getDiscCoverage(pixelScale, glm::length(center - eye), radius);
+}
+
+/*!
+    Summed coverage of count instances of instanceRadius spread through a batch's sphere, from the
+    batch's bounds alone: one instance's disc at the batch's distance for each, scaled by the share
+    of the batch's screen square that lies on the screen
+*/
+static float getBatchCoverage(const glm::mat4& viewProjection, const glm::vec3& eye, float pixelScale, const glm::vec3& center,
+                              float radius, size_t count, float instanceRadius)
+{
+    // With the camera inside or beside the batch, about half of it lies ahead at up to its radius away
+    glm::vec4 clip = viewProjection * glm::vec4(center, 1.f);
+    float distance = glm::length(center - eye);
+    if (distance <= radius || clip.w <= 0.f)
+        return 0.5f * count * getDiscCoverage(pixelScale, radius, instanceRadius);
+
+    // Square around the batch's disc in normalized device coordinates, clipped to the screen
+    float pixels = radius * pixelScale / distance;
+    glm::vec2 extent(pixels * 2.f / MainWindow::WIDTH, pixels * 2.f / MainWindow::HEIGHT);
+    glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+    glm::vec2 low = glm::max(ndc - extent, glm::vec2(-1.f));
+    glm::vec2 high = glm::min(ndc + extent, glm::vec2(1.f));
+    if (low.x >= high.x || low.y >= high.y)
+        return 0.f;
+    float onScreen = (high.x - low.x) * (high.y - low.y) / (4.f * extent.x * extent.y);
+
+    return onScreen * count * getDiscCoverage(pixelScale, distance, instanceRadius);
+}
+
 void GLAPIENTRY debugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam) {
     std::cout << "GL DEBUG: " << message << std::endl;
 }
 
 MainWindow::MainWindow()
 {
+    this->window = nullptr;
+    this->captureKeyDown = false;
+    this->overdrawKeyDown = false;
+    this->overdrawView = false;
+    this->depthPrepassOn = false;
+    this->lastFrameTime = 0.0;
+    this->cameraDistance = 3.f;
+    this->instancePrototype = nullptr;
+    this->instancedCubes = nullptr;
+    this->instanceCursor = 0;
+    this->visibleObjects = 0;
+    this->occludedObjects = 0;
+    this->queueStats = RenderQueue::Stats();
+    this->inputPollTime = 0;
+    this->timeToFirstFrameMs = -1.0;
+    this->alive = init();
+}
+
+MainWindow::MainWindow(const EngineSettings& settings)
+{
+    this->window = nullptr;
+    this->captureKeyDown = false;
+    this->overdrawKeyDown = false;
+    this->overdrawView = false;
+    this->depthPrepassOn = false;
+    this->lastFrameTime = 0.0;
+    this->cameraDistance = 3.f;
+    this->instancePrototype = nullptr;
+    this->instancedCubes = nullptr;
+    this->instanceCursor = 0;
+    this->visibleObjects = 0;
+    this->occludedObjects = 0;
+    this->queueStats = RenderQueue::Stats();
+    this->inputPollTime = 0;
+    this->timeToFirstFrameMs = -1.0;
+    this->settings = settings;
+    this->overdrawView = settings.overdrawView;
+    this->alive = init();
+}
+
+bool MainWindow::createWindow(bool offscreenFallback)
+{
+    if (offscreenFallback)
+    {
+        // No display available, let GLFW create an OSMesa context on its null platform
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+
     // Initialize GLFW
     if (!glfwInit())
     {
         std::cout << "Failed to initialize GLFW" << std::endl;
-        this->alive = false;
-        return;
+        return false;
     }
 
     // Set GLFW window hints for OpenGL version 3.3 core profile
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+
+    // Synchronous debug output skews timings, only request it for interactive runs
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, this->settings.benchmark ? GL_FALSE : GL_TRUE);
+
+    if (this->settings.headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (offscreenFallback)
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
 
     // Create window
     this->window = glfwCreateWindow(WIDTH, HEIGHT, "Optim", nullptr, nullptr);
     if (!this->window) {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
-        this->alive = false;
-        return;
+        return false;
+    }
+
+    return true;
+}
+
+bool MainWindow::init()
+{
+    if (!createWindow(false))
+    {
+        if (!this->settings.headless || !createWindow(true))
+            return false;
     }
 
     // Make context current
     glfwMakeContextCurrent(this->window);
 
+    // Benchmarks measure render cost, not the display refresh rate
+    if (this->settings.benchmark)
+        glfwSwapInterval(0);
+
     // Initialize GLAD
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         std::cout << "Failed to initialize GLAD" << std::endl;
         glfwTerminate();
-        this->alive = false;
-        return;
+        return false;
     }
 
-    if (glDebugMessageCallback) {
+    // Benchmarks leave debug output off on purpose, only a missing entry point is reported
+    if (!glDebugMessageCallback)
+    {
+        std::cout << "GLDebug output not supported" << std::endl;
+    }
+    else if (!this->settings.benchmark) {
         glEnable(GL_DEBUG_OUTPUT);
         glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
         glDebugMessageCallback(debugCallback, nullptr);
     }
-    else
-    {
-        std::cout << "GLDebug output not supported" << std::endl;
-    }
+
+    // Programs preloaded during scene loads build on their own thread and context
+    ShaderProgram::setCacheDirectory(this->settings.shaderCacheDirectory);
+    ShaderCompiler::getInstance()->start(this->window);
 
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
@@ -72,7 +216,7 @@ MainWindow::MainWindow()
     glViewport(0, 0, 800, 600);
     glfwSetFramebufferSizeCallback(this->window, framebufferSizeCallback);
 
-    this->alive = true;
+    return true;
 }
 
 bool MainWindow::isAlive()
@@ -87,141 +231,705 @@ void MainWindow::framebufferSizeCallback(GLFWwindow* window, int width, int heig
 
 void MainWindow::processInput()
 {
+    PROFILE_ZONE("Input");
+
     if (glfwGetKey(this->window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(this->window, true);
+
+    // F1 captures the next frames to the profiler output
+    bool captureKey = glfwGetKey(this->window, GLFW_KEY_F1) == GLFW_PRESS;
+    if (captureKey && !this->captureKeyDown)
+        PROFILE_CAPTURE(this->settings.captureFrames > 0 ? this->settings.captureFrames : 120, this->settings.captureOutput);
+    this->captureKeyDown = captureKey;
+
+    // F2 switches between the lit scene and the overdraw view
+    bool overdrawKey = glfwGetKey(this->window, GLFW_KEY_F2) == GLFW_PRESS;
+    if (overdrawKey && !this->overdrawKeyDown)
+        this->overdrawView = !this->overdrawView;
+    this->overdrawKeyDown = overdrawKey;
 }
 
 void MainWindow::exec()
 {
-    // Define interleaved vertices with positions and colors (using double)
-    float* vertices = new float[120]{
-        // Positions          // Texture Coords
-        // Front face
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, // Bottom-left
-         0.5f, -0.5f,  0.5f,  1.0f, 0.0f, // Bottom-right
-         0.5f,  0.5f,  0.5f,  1.0f, 1.0f, // Top-right
-        -0.5f,  0.5f,  0.5f,  0.0f, 1.0f, // Top-left
-        // Back face
-         0.5f, -0.5f, -0.5f,  0.0f, 0.0f, // Bottom-right
-        -0.5f, -0.5f, -0.5f,  1.0f, 0.0f, // Bottom-left
-        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f, // Top-left
-         0.5f,  0.5f, -0.5f,  0.0f, 1.0f, // Top-right
-        // Right face
-         0.5f, -0.5f,  0.5f,  0.0f, 0.0f, // Bottom-front
-         0.5f, -0.5f, -0.5f,  1.0f, 0.0f, // Bottom-back
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f, // Top-back
-         0.5f,  0.5f,  0.5f,  0.0f, 1.0f, // Top-front
-        // Left face
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f, // Bottom-back
-        -0.5f, -0.5f,  0.5f,  1.0f, 0.0f, // Bottom-front
-        -0.5f,  0.5f,  0.5f,  1.0f, 1.0f, // Top-front
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, // Top-back
-        // Top face
-        -0.5f,  0.5f,  0.5f,  0.0f, 0.0f, // Front-left
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f, // Front-right
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f, // Back-right
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, // Back-left
-        // Bottom face
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f, // Back-left
-         0.5f, -0.5f, -0.5f,  1.0f, 0.0f, // Back-right
-         0.5f, -0.5f,  0.5f,  1.0f, 1.0f, // Front-right
-        -0.5f, -0.5f,  0.5f,  0.0f, 1.0f  // Front-left
-    };
+    this->loadBegin = std::chrono::steady_clock::now();
+    JobSystem::getInstance()->start(this->settings.jobWorkers);
+    TextureManager::getInstance()->setCookedTextures(this->settings.cookedTextures);
 
-    // Tangent vectors (3 floats per vertex)
-    float* tangents = new float[144] {
-        // Front face (normal: 0,0,1, tangent: 1,0,0, bitangent: 0,1,0)
-        1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Bottom-left
-        1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Bottom-right
-        1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Top-right
-        1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Top-left
-        // Back face (normal: 0,0,-1, tangent: -1,0,0, bitangent: 0,1,0)
-       -1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Bottom-right
-       -1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Bottom-left
-       -1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Top-left
-       -1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Top-right
-        // Right face (normal: 1,0,0, tangent: 0,0,-1, bitangent: 0,1,0)
-        0.0f, 0.0f,-1.0f,  0.0f, 1.0f, 0.0f, // Bottom-front
-        0.0f, 0.0f,-1.0f,  0.0f, 1.0f, 0.0f, // Bottom-back
-        0.0f, 0.0f,-1.0f,  0.0f, 1.0f, 0.0f, // Top-back
-        0.0f, 0.0f,-1.0f,  0.0f, 1.0f, 0.0f, // Top-front
-        // Left face (normal: -1,0,0, tangent: 0,0,1, bitangent: 0,1,0)
-        0.0f, 0.0f, 1.0f,  0.0f, 1.0f, 0.0f, // Bottom-back
-        0.0f, 0.0f, 1.0f,  0.0f, 1.0f, 0.0f, // Bottom-front
-        0.0f, 0.0f, 1.0f,  0.0f, 1.0f, 0.0f, // Top-front
-        0.0f, 0.0f, 1.0f,  0.0f, 1.0f, 0.0f, // Top-back
-        // Top face (normal: 0,1,0, tangent: 1,0,0, bitangent: 0,0,-1)
-        1.0f, 0.0f, 0.0f,  0.0f, 0.0f,-1.0f, // Front-left
-        1.0f, 0.0f, 0.0f,  0.0f, 0.0f,-1.0f, // Front-right
-        1.0f, 0.0f, 0.0f,  0.0f, 0.0f,-1.0f, // Back-right
-        1.0f, 0.0f, 0.0f,  0.0f, 0.0f,-1.0f, // Back-left
-        // Bottom face (normal: 0,-1,0, tangent: 1,0,0, bitangent: 0,0,1)
-        1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, // Back-left
-        1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, // Back-right
-        1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, // Front-right
-        1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f  // Front-left
-    };
+    Benchmarks benchmarks(this);
 
-    unsigned int* indices = new unsigned int[36]{
-        0,  1,  2,  2,  3,  0,  // Front
-        4,  5,  6,  6,  7,  4,  // Back
-        8,  9, 10, 10, 11,  8,  // Right
-        12, 13, 14, 14, 15, 12,  // Left
-        16, 17, 18, 18, 19, 16,  // Top
-        20, 23, 22, 22, 21, 20   // Bottom (fixed)
-    };
+    // Texture tools run without a scene
+    if (this->settings.cookTextures)
+        cookSceneTextures(true);
+    else if (this->settings.textureBenchmark)
+        benchmarks.runTextureBenchmark();
+    else if (this->settings.meshBenchmark)
+        benchmarks.runMeshBenchmark();
+    else if (this->settings.cullBenchmark)
+        benchmarks.runCullBenchmark();
+    else if (this->settings.occlusionBenchmark)
+        benchmarks.runOcclusionBenchmark();
+    else if (this->settings.transformBenchmark)
+        benchmarks.runTransformBenchmark();
+    else if (this->settings.jobBenchmark)
+        benchmarks.runJobBenchmark();
+    else if (this->settings.commandBenchmark)
+        benchmarks.runCommandBenchmark();
+    else if (this->settings.shaderBenchmark)
+        benchmarks.runShaderBenchmark();
+    else if (loadScene())
+    {
+        if (this->settings.captureFrames > 0)
+            PROFILE_CAPTURE(this->settings.captureFrames, this->settings.captureOutput);
+
+        if (this->settings.benchmark)
+            benchmarks.runSceneBenchmark();
+        else
+            runInteractive();
 
-    Object* obj = new Object(vertices, indices, tangents, 120, 36, 144);
-    if (!obj->compileShader())
+        PROFILE_FINISH_CAPTURE();
+    }
+
+    destroyScene();
+    ShaderCompiler::getInstance()->stop();
+    JobSystem::getInstance()->stop();
+
+    // Cleanup
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    this->alive = false;
+}
+
+// Scene material, loaded from settings.assetDirectory
+static const char* sceneAlbedoTexture = "ui5kaiqg_4K_Albedo.jpg";
+static const char* sceneNormalTexture = "ui5kaiqg_4K_Normal.jpg";
+
+// Define interleaved vertices with positions and texture coordinates
+static const float cubeVertices[120] = {
+    // Positions          // Texture Coords
+    // Front face
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, // Bottom-left
+     0.5f, -0.5f,  0.5f,  1.0f, 0.0f, // Bottom-right
+     0.5f,  0.5f,  0.5f,  1.0f, 1.0f, // Top-right
+    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f, // Top-left
+    // Back face
+     0.5f, -0.5f, -0.5f,  0.0f, 0.0f, // Bottom-right
+    -0.5f, -0.5f, -0.5f,  1.0f, 0.0f, // Bottom-left
+    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f, // Top-left
+     0.5f,  0.5f, -0.5f,  0.0f, 1.0f, // Top-right
+    // Right face
+     0.5f, -0.5f,  0.5f,  0.0f, 0.0f, // Bottom-front
+     0.5f, -0.5f, -0.5f,  1.0f, 0.0f, // Bottom-back
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f, // Top-back
+     0.5f,  0.5f,  0.5f,  0.0f, 1.0f, // Top-front
+    // Left face
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f, // Bottom-back
+    -0.5f, -0.5f,  0.5f,  1.0f, 0.0f, // Bottom-front
+    -0.5f,  0.5f,  0.5f,  1.0f, 1.0f, // Top-front
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, // Top-back
+    // Top face
+    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f, // Front-left
+     0.5f,  0.5f,  0.5f,  1.0f, 0.0f, // Front-right
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f, // Back-right
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, // Back-left
+    // Bottom face
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f, // Back-left
+     0.5f, -0.5f, -0.5f,  1.0f, 0.0f, // Back-right
+     0.5f, -0.5f,  0.5f,  1.0f, 1.0f, // Front-right
+    -0.5f, -0.5f,  0.5f,  0.0f, 1.0f  // Front-left
+};
+
+// Tangent vectors (3 floats per vertex)
+static const float cubeTangents[144] = {
+    // Front face (normal: 0,0,1, tangent: 1,0,0, bitangent: 0,1,0)
+    1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Bottom-left
+    1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Bottom-right
+    1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Top-right
+    1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Top-left
+    // Back face (normal: 0,0,-1, tangent: -1,0,0, bitangent: 0,1,0)
+   -1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Bottom-right
+   -1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Bottom-left
+   -1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Top-left
+   -1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, // Top-right
+    // Right face (normal: 1,0,0, tangent: 0,0,-1, bitangent: 0,1,0)
+    0.0f, 0.0f,-1.0f,  0.0f, 1.0f, 0.0f, // Bottom-front
+    0.0f, 0.0f,-1.0f,  0.0f, 1.0f, 0.0f, // Bottom-back
+    0.0f, 0.0f,-1.0f,  0.0f, 1.0f, 0.0f, // Top-back
+    0.0f, 0.0f,-1.0f,  0.0f, 1.0f, 0.0f, // Top-front
+    // Left face (normal: -1,0,0, tangent: 0,0,1, bitangent: 0,1,0)
+    0.0f, 0.0f, 1.0f,  0.0f, 1.0f, 0.0f, // Bottom-back
+    0.0f, 0.0f, 1.0f,  0.0f, 1.0f, 0.0f, // Bottom-front
+    0.0f, 0.0f, 1.0f,  0.0f, 1.0f, 0.0f, // Top-front
+    0.0f, 0.0f, 1.0f,  0.0f, 1.0f, 0.0f, // Top-back
+    // Top face (normal: 0,1,0, tangent: 1,0,0, bitangent: 0,0,-1)
+    1.0f, 0.0f, 0.0f,  0.0f, 0.0f,-1.0f, // Front-left
+    1.0f, 0.0f, 0.0f,  0.0f, 0.0f,-1.0f, // Front-right
+    1.0f, 0.0f, 0.0f,  0.0f, 0.0f,-1.0f, // Back-right
+    1.0f, 0.0f, 0.0f,  0.0f, 0.0f,-1.0f, // Back-left
+    // Bottom face (normal: 0,-1,0, tangent: 1,0,0, bitangent: 0,0,1)
+    1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, // Back-left
+    1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, // Back-right
+    1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, // Front-right
+    1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f  // Front-left
+};
+
+static const unsigned int cubeIndices[36] = {
+    0,  1,  2,  2,  3,  0,  // Front
+    4,  5,  6,  6,  7,  4,  // Back
+    8,  9, 10, 10, 11,  8,  // Right
+    12, 13, 14, 14, 15, 12,  // Left
+    16, 17, 18, 18, 19, 16,  // Top
+    20, 23, 22, 22, 21, 20   // Bottom (fixed)
+};
+
+static Object* createCube()
+{
+    // Objects own and delete their vertex data
+    float* vertices = new float[120];
+    float* tangents = new float[144];
+    unsigned int* indices = new unsigned int[36];
+    std::copy(cubeVertices, cubeVertices + 120, vertices);
+    std::copy(cubeTangents, cubeTangents + 144, tangents);
+    std::copy(cubeIndices, cubeIndices + 36, indices);
+
+    return new Object(vertices, indices, tangents, 120, 36, 144);
+}
+
+Object* MainWindow::createSceneObject()
+{
+    VertexLayout layout;
+    VertexLayout::fromName(this->settings.vertexFormat, layout);
+
+    Object* obj;
+    bool built;
+    if (this->sceneMesh.isOpen())
     {
-        std::cout << "error compiling shaders" << std::endl;
-        delete obj;
-        return;
+        // Encoded straight from the mapped mesh file
+        size_t vertexCount = this->sceneMesh.getVertexCount();
+        obj = new Object();
+        obj->setVertexLayout(layout);
+        std::vector<MeshLod> lods(this->sceneMesh.getLodCount());
+        for (size_t i = 0; i < lods.size(); i++)
+        {
+            const CookedMeshLod& cooked = this->sceneMesh.getLods()[i];
+            lods[i].firstIndex = cooked.firstIndex;
+            lods[i].indexCount = cooked.indexCount;
+            lods[i].error = cooked.error;
+        }
+        built = obj->buildGeometry(this->sceneMesh.getVertices(), vertexCount * 5, this->sceneMesh.getTangents(), vertexCount * 6,
+                                   this->sceneMesh.getIndices(), this->sceneMesh.getIndexCount(), lods.data(), lods.size());
     }
-    if (!obj->buildGeometry())
+    else
+    {
+        obj = createCube();
+        obj->setVertexLayout(layout);
+        built = obj->buildGeometry();
+    }
+
+    if (!built)
     {
         std::cout << "error building geometry" << std::endl;
         delete obj;
-        return;
+        return nullptr;
+    }
+    return obj;
+}
+
+bool MainWindow::initFrameResources()
+{
+    if (!this->streamBuffer.init(STREAM_BUFFER_SIZE) || !this->frameUniforms.init(&this->streamBuffer) || !this->lightGrid.init())
+        return false;
+    this->lightGrid.setClustered(this->settings.clusteredLighting);
+    return true;
+}
+
+std::string MainWindow::getSceneTexturePath(bool normal)
+{
+    return this->settings.assetDirectory + (normal ? sceneNormalTexture : sceneAlbedoTexture);
+}
+
+bool MainWindow::loadSceneTextures(Object* obj)
+{
+    return obj->loadTexture(getSceneTexturePath(false).c_str()) && obj->loadTexture(getSceneTexturePath(true).c_str(), true);
+}
+
+bool MainWindow::loadScene()
+{
+    if (!initFrameResources())
+        return false;
+
+    // Lights first, the light count picks the shader variant
+    if (this->settings.lightCount > 0)
+        createLights(this->settings.lightCount);
+    else
+    {
+        PointLight* light = new PointLight(1.2f, 1.0f, 2.0f, 1.0f, 1.0f, 1.0f);
+        PointLight* lightTwo = new PointLight(-1.2f, -1.0f, 2.0f, 0.0f, 0.5f, 0.0f);
+        LightController::getInstance()->addLight(light);
+        LightController::getInstance()->addLight(lightTwo);
     }
-    if (!obj->loadTexture("C:\\Users\\jrbri\\Documents\\Megascans\\Downloaded\\surface\\Brick_Modern_ui5kaiqg\\ui5kaiqg_4K_Albedo.jpg"))
+
+    // The scene's program compiles while meshes and textures load, objects wait for it when they attach it.
+    // Its material has an albedo and normal map and keeps the default specular.
+    VertexLayout layout;
+    VertexLayout::fromName(this->settings.vertexFormat, layout);
+    uint32_t variant = ShaderVariants::makeKey(ShaderVariants::NORMAL_MAP | ShaderVariants::SPECULAR, getLightingVariant());
+    uint32_t depthVariant = ShaderVariants::getDepthKey(ShaderVariants::NORMAL_MAP | ShaderVariants::SPECULAR);
+    if (this->settings.instanceCount > 0)
     {
-        delete obj;
-        return;
+        ShaderProgram::preload(InstancedMesh::getShaderDefines(variant, layout));
+        ShaderProgram::preload(InstancedMesh::getShaderDefines(depthVariant, layout));
+    }
+    else
+    {
+        ShaderProgram::preload(Object::getShaderDefines(variant, layout));
+        ShaderProgram::preload(Object::getShaderDefines(depthVariant, layout));
     }
-    if (!obj->loadTexture("C:\\Users\\jrbri\\Documents\\Megascans\\Downloaded\\surface\\Brick_Modern_ui5kaiqg\\ui5kaiqg_4K_Normal.jpg"))
+
+    // Imported meshes replace the cube and stay mapped until every object has uploaded them
+    float meshSize = 1.f;
+    if (!this->settings.meshPath.empty())
+    {
+        auto begin = std::chrono::steady_clock::now();
+        if (!MeshImporter::load(this->settings.meshPath, this->sceneMesh))
+            return false;
+        std::cout << "Loaded " << this->settings.meshPath << " (" << this->sceneMesh.getLods()[0].indexCount / 3 << " triangles, "
+                  << this->sceneMesh.getLodCount() << " LODs) in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() << " ms" << std::endl;
+
+        const CookedMeshHeader& header = this->sceneMesh.getHeader();
+        for (int i = 0; i < 3; i++)
+            meshSize = std::max(meshSize, header.boundsMax[i] - header.boundsMin[i]);
+    }
+
+    // One cube by default, otherwise a grid of cubes sharing one material
+    bool instanced = this->settings.instanceCount > 0;
+    int objectCount = instanced ? this->settings.instanceCount : std::max(1, this->settings.objectCount);
+    int side = (int)std::ceil(std::cbrt((double)objectCount));
+    const float spacing = 1.5f * meshSize;
+    float extent = (side - 1) * spacing;
+    auto gridPosition = [side, spacing, extent](int i) {
+        int gx = i % side;
+        int gy = (i / side) % side;
+        int gz = i / (side * side);
+        return glm::vec3(gx * spacing - extent * 0.5f, gy * spacing - extent * 0.5f, -gz * spacing + extent * 0.5f);
+    };
+
+    if (instanced)
+    {
+        if (!loadInstancedCubes(objectCount, gridPosition))
+            return false;
+        objectCount = 0;
+    }
+
+    // With layers behind it, the layer nearest the camera hides much of the grid. Its objects are
+    // rasterized from the full detail mesh, coarser levels could hide what they no longer cover.
+    bool occluders = this->settings.occlusionCulling && objectCount > side * side;
+    if (occluders && this->sceneMesh.isOpen())
+        this->sceneOccluder.set(this->sceneMesh.getVertices(), this->sceneMesh.getVertexCount(), this->sceneMesh.getIndices(), this->sceneMesh.getLods()[0].indexCount);
+    else if (occluders)
+        this->sceneOccluder.set(cubeVertices, 24, cubeIndices, 36);
+
+    for (int i = 0; i < objectCount; i++)
+    {
+        Object* obj = createSceneObject();
+        if (!obj)
+            return false;
+        this->objects.push_back(obj);
+
+        // Every cube uses the same material, only the first load decodes and uploads
+        if (!loadSceneTextures(obj))
+            return false;
+        if (!obj->compileShader(getLightingVariant()))
+        {
+            std::cout << "error compiling shaders" << std::endl;
+            return false;
+        }
+
+        glm::vec3 position = gridPosition(i);
+        obj->setLocation(position.x, position.y, position.z);
+        if (occluders && i < side * side)
+            obj->setOccluder(&this->sceneOccluder);
+    }
+
+    this->sceneMesh.close();
+
+    GeometryPool::Stats poolStats = GeometryPool::getInstance()->getStats();
+    std::cout << "Geometry pool: " << poolStats.allocations << " meshes in " << poolStats.buffers << " buffer pairs, "
+              << (poolStats.vertexBytes + poolStats.indexBytes) / 1024 << " of " << (poolStats.vertexCapacity + poolStats.indexCapacity) / 1024
+              << " KB used, fragmentation " << poolStats.fragmentation << std::endl;
+
+    // Setup camera, backed off far enough to frame the whole grid
+    this->cameraDistance = 3.f * meshSize + extent * 1.5f;
+    Camera* cam = new Camera(this, 0.f, 0.f, -this->cameraDistance, 45.f);
+    cam->setFarClippingDistance(std::max(100.f, this->cameraDistance + extent * 2.f));
+    CameraController::getInstance()->addCamera(cam);
+
+    return true;
+}
+
+bool MainWindow::loadInstancedCubes(int count, const std::function<glm::vec3(int)>& gridPosition)
+{
+    this->instancePrototype = createSceneObject();
+    if (!this->instancePrototype)
+        return false;
+    if (!loadSceneTextures(this->instancePrototype))
+        return false;
+
+    this->instancedCubes = new InstancedMesh(this->instancePrototype);
+    if (!this->instancedCubes->compileShader(getLightingVariant()))
     {
+        std::cout << "error compiling shaders" << std::endl;
+        return false;
+    }
+
+    this->instancedCubes->reserve(count);
+    for (int i = 0; i < count; i++)
+        this->instancedCubes->addInstance(glm::translate(glm::mat4(1.0f), gridPosition(i)));
+
+    if (!this->instancedCubes->build())
+    {
+        std::cout << "error building instanced geometry" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void MainWindow::destroyScene()
+{
+    for (Object* obj : this->objects)
         delete obj;
+    this->objects.clear();
+
+    this->sceneOccluder.clear();
+
+    delete this->instancedCubes;
+    delete this->instancePrototype;
+    this->instancedCubes = nullptr;
+    this->instancePrototype = nullptr;
+    TransformStore::getInstance()->clear();
+    TextureManager::getInstance()->clear();
+
+    GeometryPool::getInstance()->clear();
+    LightController::getInstance()->clear();
+    ShaderProgram::releaseAll();
+    this->streamBuffer.release();
+    this->lightGrid.release();
+}
+
+void MainWindow::createLights(int count)
+{
+    LightController* lights = LightController::getInstance();
+    lights->clear();
+
+    // Fixed seed so every run lights the scene identically
+    Random random(12345u);
+    for (int i = 0; i < count; i++)
+    {
+        float x = random.next(-2.5f, 2.5f);
+        float y = random.next(-2.5f, 2.5f);
+        float z = random.next(-2.5f, 2.5f);
+        lights->addLight(new PointLight(x, y, z, random.next(0.2f, 1.f), random.next(0.2f, 1.f), random.next(0.2f, 1.f), random.next(0.75f, 1.5f)));
+    }
+}
+
+bool MainWindow::setClusteredLighting(bool clustered)
+{
+    this->lightGrid.setClustered(clustered);
+    return updateShaderVariants();
+}
+
+uint32_t MainWindow::getLightingVariant()
+{
+    int lightCount = this->settings.shaderVariants ? (int)LightController::getInstance()->getLights().size() : -1;
+    return ShaderVariants::getLightingKey(this->lightGrid.isClustered(), lightCount);
+}
+
+bool MainWindow::updateShaderVariants()
+{
+    uint32_t lighting = getLightingVariant();
+    for (Object* obj : this->objects)
+    {
+        if (!obj->compileShader(lighting))
+            return false;
+    }
+    if (this->instancedCubes && !this->instancedCubes->compileShader(lighting))
+        return false;
+
+    return true;
+}
+
+void MainWindow::updateScene(double t)
+{
+    {
+        PROFILE_ZONE("Transform update");
+
+        // Every object spins about its own origin, then changed world matrices are recomputed
+        TransformStore* transforms = TransformStore::getInstance();
+        glm::quat spin = glm::angleAxis((float)t, glm::normalize(glm::vec3(0.5f, 1.0f, 0.0f)));
+        for (Object* obj : this->objects)
+            transforms->setRotation(obj->getTransform(), spin);
+        transforms->update();
+    }
+
+    if (this->instancedCubes)
+    {
+        PROFILE_ZONE("Instance update");
+
+        // Spin a contiguous window of instances per frame so only that range is re-uploaded
+        const size_t ANIMATED_PER_FRAME = 4096;
+        size_t count = this->instancedCubes->getInstanceCount();
+        if (this->instanceCursor >= count)
+            this->instanceCursor = 0;
+        size_t last = std::min(count, this->instanceCursor + ANIMATED_PER_FRAME);
+
+        for (size_t i = this->instanceCursor; i < last; i++)
+        {
+            glm::vec3 position = glm::vec3(this->instancedCubes->getTransform(i)[3]);
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+            this->instancedCubes->setTransform(i, glm::rotate(model, (float)t, glm::vec3(0.5f, 1.0f, 0.0f)));
+        }
+        this->instanceCursor = last;
+    }
+
+    if (!this->settings.benchmark)
         return;
+
+    // Scripted camera dolly so benchmark frames cover a range of screen coverage
+    Camera* cam = CameraController::getInstance()->getActiveCamera();
+    cam->setLocation(0.f, 0.f, -this->cameraDistance - 1.5f * (float)(0.5 - 0.5 * std::cos(t * 0.5)));
+}
+
+void MainWindow::simulateFrame(FrameSnapshot& frame)
+{
+    frame.inputTime = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(this->inputPollTime.load()));
+    updateScene(frame.time);
+
+    // Camera and lights as of this frame, the live ones keep moving while it is drawn
+    Camera* cam = CameraController::getInstance()->getActiveCamera();
+    frame.camera = *cam;
+    frame.lights.clear();
+    for (PointLight* light : LightController::getInstance()->getLights())
+        frame.lights.push_back(*light);
+    frame.lightPointers.clear();
+    for (PointLight& light : frame.lights)
+        frame.lightPointers.push_back(&light);
+
+    // Bounds of everything in the scene against the camera frustum, before any draw is queued
+    {
+        PROFILE_ZONE("Frustum culling");
+        this->culler.setFrustum(cam->getProjection() * cam->getView());
+        this->culler.resize(this->objects.size() + (this->instancedCubes ? 1 : 0));
+
+        glm::vec3 center;
+        float radius;
+        for (size_t i = 0; i < this->objects.size(); i++)
+        {
+            this->objects[i]->getWorldSphere(center, radius);
+            this->culler.set(i, center, radius);
+        }
+        if (this->instancedCubes)
+        {
+            this->instancedCubes->getWorldSphere(center, radius);
+            this->culler.set(this->objects.size(), center, radius);
+        }
+        frame.visibleObjects = this->culler.cull();
+    }
+
+    // Visible occluders go into the CPU depth buffer, then every other visible object is tested against it
+    bool occlusion = false;
+    frame.occludedObjects = 0;
+    frame.occlusionMs = 0.0;
+    if (this->settings.occlusionCulling)
+    {
+        PROFILE_ZONE("Occlusion culling");
+        auto begin = std::chrono::steady_clock::now();
+        TransformStore* transforms = TransformStore::getInstance();
+        this->occlusionCuller.begin(cam->getProjection() * cam->getView());
+        for (size_t i = 0; i < this->objects.size(); i++)
+        {
+            Object* obj = this->objects[i];
+            if (obj->getOccluder() && this->culler.isVisible(i))
+                this->occlusionCuller.addOccluder(*obj->getOccluder(), transforms->getWorld(obj->getTransform()));
+        }
+
+        occlusion = this->occlusionCuller.getTriangleCount() > 0;
+        if (occlusion)
+        {
+            this->occlusionCuller.rasterize();
+
+            // Occluders are always drawn, their own depth would hide them
+            this->occlusionCuller.resize(this->objects.size());
+            this->occlusionCandidates.resize(this->objects.size());
+            for (size_t i = 0; i < this->objects.size(); i++)
+            {
+                Object* obj = this->objects[i];
+                this->occlusionCandidates[i] = this->culler.isVisible(i) && !obj->getOccluder();
+                if (this->occlusionCandidates[i])
+                    this->occlusionCuller.set(i, obj->getLocalBounds(), transforms->getWorld(obj->getTransform()));
+            }
+            frame.occludedObjects = this->occlusionCuller.cull(this->occlusionCandidates.data());
+        }
+        frame.occlusionMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    // Changed instances travel with the frame, the GL thread uploads them before drawing it
+    frame.instanceUploads.clear();
+    frame.instanceMatrices.clear();
+    if (this->instancedCubes)
+    {
+        FrameSnapshot::InstanceUpload upload;
+        upload.mesh = this->instancedCubes;
+        upload.offset = frame.instanceMatrices.size();
+        upload.count = this->instancedCubes->copyChangedInstances(frame.instanceMatrices, upload.first);
+        if (upload.count > 0)
+            frame.instanceUploads.push_back(upload);
     }
 
-    PointLight* light = new PointLight(1.2f, 1.0f, 2.0f, 1.0f, 1.0f, 1.0f);
-    PointLight* lightTwo = new PointLight(-1.2f, -1.0f, 2.0f, 0.0f, 0.5f, 0.0f);
-    obj->addAffectingLight(light);
-    obj->addAffectingLight(lightTwo);
+    // Queue every visible object in state sorted order and record the commands the GL thread replays
+    // Visible objects pick their level of detail by how large each level's error appears from the camera
+    PROFILE_ZONE("Queue draws");
+    frame.queue.begin(cam->getView(), cam->getFarClip());
+    glm::vec3 eye = cam->getPosition();
+    float pixelScale = cam->getPixelScale();
+    float complexity = 0.f;
+    glm::vec3 center;
+    float radius;
+    for (size_t i = 0; i < this->objects.size(); i++)
+    {
+        if (this->culler.isVisible(i) && !(occlusion && this->occlusionCuller.isOccluded(i)))
+        {
+            this->objects[i]->selectLod(eye, pixelScale, this->settings.lodErrorPixels);
+            this->objects[i]->getWorldSphere(center, radius);
+            complexity += getScreenCoverage(eye, pixelScale, center, radius);
+        }
+    }
+    // The instances are culled as one batch, so their share is estimated from its bounds rather than per instance
+    bool instancesVisible = this->instancedCubes && this->culler.isVisible(this->objects.size());
+    if (instancesVisible)
+    {
+        this->instancedCubes->getWorldSphere(center, radius);
+        complexity += getBatchCoverage(cam->getProjection() * cam->getView(), eye, pixelScale, center, radius,
+                                       this->instancedCubes->getInstanceCount(), this->instancePrototype->getBoundingRadius());
+    }
 
-    // Setup camera
-    CameraController::getInstance()->addCamera(new Camera(this, 0.f, 0.f, -3.f, 45.f));
+    // The pre-pass doubles the draws, so it only pays for itself once pixels are covered several times over
+    if (this->settings.depthPrepass == "auto")
+    {
+        if (complexity > PREPASS_ON_COMPLEXITY)
+            this->depthPrepassOn = true;
+        else if (complexity < PREPASS_OFF_COMPLEXITY)
+            this->depthPrepassOn = false;
+    }
+    else
+        this->depthPrepassOn = this->settings.depthPrepass == "on";
+    frame.depthComplexity = complexity;
+    frame.depthPrepass = this->depthPrepassOn;
+    frame.queue.setDepthPrepass(this->depthPrepassOn);
+    frame.queue.setOverdrawView(this->overdrawView);
+
+    for (size_t i = 0; i < this->objects.size(); i++)
+    {
+        if (this->culler.isVisible(i) && !(occlusion && this->occlusionCuller.isOccluded(i)))
+            this->objects[i]->submit(frame.queue);
+    }
+    if (instancesVisible)
+        this->instancedCubes->submit(frame.queue);
+    frame.queue.sort();
+    frame.queue.record();
+}
 
+void MainWindow::renderFrame(FrameSnapshot& frame)
+{
+    {
+        PROFILE_ZONE("Texture streaming");
+        TextureManager::getInstance()->update();
+    }
+
+    // Camera and lights are uploaded once for all objects
+    Camera* cam = &frame.camera;
+    {
+        PROFILE_ZONE("Light assignment");
+        int width, height;
+        glfwGetFramebufferSize(this->window, &width, &height);
+        this->lightGrid.update(cam, frame.lightPointers, width, height);
+    }
+    this->frameUniforms.update(cam, &this->lightGrid, (float)frame.time, (float)(frame.time - this->lastFrameTime));
+    this->lastFrameTime = frame.time;
+
+    // Rendering
+    {
+        PROFILE_ZONE("Clear");
+        PROFILE_GPU_ZONE("Clear");
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (glGetError() != GL_NO_ERROR) std::cout << "GL Error after clear" << std::endl;
+    }
+
+    for (const FrameSnapshot::InstanceUpload& upload : frame.instanceUploads)
+        upload.mesh->uploadInstances(upload.first, &frame.instanceMatrices[upload.offset], upload.count, this->streamBuffer);
+
+    {
+        PROFILE_GPU_ZONE("Draw");
+        frame.queue.execute();
+    }
+    this->streamBuffer.endFrame();
+    this->queueStats = frame.queue.getStats();
+    this->visibleObjects = frame.visibleObjects;
+    this->occludedObjects = frame.occludedObjects;
+
+    // Textures released this frame are deleted once in-flight frames can no longer reference them
+    TextureManager::getInstance()->endFrame();
+
+    if (this->timeToFirstFrameMs < 0.0)
+    {
+        this->timeToFirstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->loadBegin).count();
+        std::cout << "First frame after " << this->timeToFirstFrameMs << " ms, "
+                  << TextureManager::getInstance()->getPendingCount() << " textures still streaming" << std::endl;
+    }
+}
+
+void MainWindow::pollEvents()
+{
+    glfwPollEvents();
+    this->inputPollTime = std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+void MainWindow::runInteractive()
+{
     auto begin = std::chrono::high_resolution_clock::now();
     size_t iters = 0;
+
+    pollEvents();
+    this->pipeline.start(this->settings.pipelineDepth, [this](FrameSnapshot& frame) {
+        frame.time = glfwGetTime();
+        simulateFrame(frame);
+        return true;
+    });
+
     // Render loop
     while (!glfwWindowShouldClose(this->window))
     {
+        PROFILE_FRAME_BEGIN();
+
         // Input
         processInput();
 
-        // Rendering
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        if (glGetError() != GL_NO_ERROR) std::cout << "GL Error after clear" << std::endl;
-
-        obj->render();
+        FrameSnapshot* frame = this->pipeline.acquire();
+        if (frame)
+        {
+            renderFrame(*frame);
+            this->pipeline.release(frame);
+        }
 
         // Swap buffers and poll events
-        glfwSwapBuffers(this->window);
+        {
+            PROFILE_ZONE("Swap");
+            glfwSwapBuffers(this->window);
+        }
         if (!glfwWindowShouldClose(this->window))
-            glfwPollEvents();
+            pollEvents();
         else
             std::cout << "should close" << std::endl;
             
@@ -230,18 +938,147 @@ void MainWindow::exec()
             std::cout << "GLFW Error: " << glfwError << std::endl;
         }
 
+        PROFILE_FRAME_END();
         iters++;
     }
-
-    delete obj;
+    this->pipeline.stop();
 
     auto end = std::chrono::high_resolution_clock::now();
-    double fps = (double)iters / (double)std::chrono::duration_cast<std::chrono::seconds>(end - begin).count();
+    double fps = (double)iters / std::chrono::duration<double>(end - begin).count();
     std::cout << fps << std::endl;
+}
 
-    // Cleanup
-    glfwDestroyWindow(window);
-    glfwTerminate();
+void MainWindow::runBenchmarkPass(FrameStats& stats)
+{
+    // Fixed timestep so every run renders exactly the same frames
+    const double timestep = 1.0 / 60.0;
+    const int warmupFrames = this->settings.warmupFrames;
+    const int totalFrames = warmupFrames + this->settings.benchmarkFrames;
 
-    this->alive = false;
-}
\ No newline at end of file
+    GpuFrameTimer gpuTimer;
+    bool gpuTiming = gpuTimer.init();
+    FragmentCounter fragmentCounter;
+    bool fragmentCounting = fragmentCounter.init();
+
+    stats.reserve(this->settings.benchmarkFrames);
+    std::vector<double> gpuSamples;
+    gpuSamples.reserve(this->settings.benchmarkFrames);
+    std::vector<double> latencySamples;
+    latencySamples.reserve(this->settings.benchmarkFrames);
+    std::vector<double> occlusionSamples;
+    occlusionSamples.reserve(this->settings.benchmarkFrames);
+    std::vector<double> fragmentSamples;
+    fragmentSamples.reserve(this->settings.benchmarkFrames);
+    std::vector<double> complexitySamples;
+    complexitySamples.reserve(this->settings.benchmarkFrames);
+    size_t prepassFrames = 0;
+    this->lastFrameTime = 0.0;
+
+    pollEvents();
+    this->pipeline.start(this->settings.pipelineDepth, [this, totalFrames, timestep](FrameSnapshot& frame) {
+        if (frame.frame >= (uint64_t)totalFrames)
+            return false;
+        frame.time = frame.frame * timestep;
+        simulateFrame(frame);
+        return true;
+    });
+
+    while (!glfwWindowShouldClose(this->window))
+    {
+        auto frameBegin = std::chrono::steady_clock::now();
+        PROFILE_FRAME_BEGIN();
+
+        FrameSnapshot* frame = this->pipeline.acquire();
+        if (!frame)
+        {
+            PROFILE_FRAME_END();
+            break;
+        }
+        bool measured = frame->frame >= (uint64_t)warmupFrames;
+
+        if (gpuTiming && measured)
+            gpuTimer.beginFrame();
+        if (fragmentCounting && measured)
+            frame->queue.setFragmentQuery(fragmentCounter.beginFrame());
+
+        renderFrame(*frame);
+
+        if (gpuTiming && measured)
+            gpuTimer.endFrame();
+        if (fragmentCounting && measured)
+            fragmentCounter.endFrame();
+
+        {
+            PROFILE_ZONE("Swap");
+            glfwSwapBuffers(this->window);
+        }
+        pollEvents();
+
+        // Input the frame was simulated from to the frame being handed to the display
+        auto frameEnd = std::chrono::steady_clock::now();
+        if (measured)
+        {
+            latencySamples.push_back(std::chrono::duration<double, std::milli>(frameEnd - frame->inputTime).count());
+            occlusionSamples.push_back(frame->occlusionMs);
+            complexitySamples.push_back(frame->depthComplexity);
+            if (frame->depthPrepass)
+                prepassFrames++;
+        }
+        this->pipeline.release(frame);
+
+        PROFILE_FRAME_END();
+        if (measured)
+            stats.addCpuSample(std::chrono::duration<double, std::milli>(frameEnd - frameBegin).count());
+
+        if (gpuTiming)
+            gpuTimer.collect(gpuSamples, false);
+        if (fragmentCounting)
+            fragmentCounter.collect(fragmentSamples, false);
+    }
+    this->pipeline.stop();
+
+    if (gpuTiming)
+        gpuTimer.collect(gpuSamples, true);
+    for (double ms : gpuSamples)
+        stats.addGpuSample(ms);
+    if (fragmentCounting)
+        fragmentCounter.collect(fragmentSamples, true);
+
+    FrameStats::Summary latency = FrameStats::summarize(latencySamples);
+    stats.setCounter("pipelineDepth", (double)this->pipeline.getDepth());
+    stats.setCounter("inputLatencyMs", latency.mean);
+    stats.setCounter("inputLatencyP95Ms", latency.p95);
+    stats.setCounter("occlusionMs", FrameStats::summarize(occlusionSamples).mean);
+
+    // Fragments passing the depth test in the opaque pass, which is what gets shaded
+    double shadedFragments = FrameStats::summarize(fragmentSamples).mean;
+    int width, height;
+    glfwGetFramebufferSize(this->window, &width, &height);
+    stats.setCounter("shadedFragments", shadedFragments);
+    stats.setCounter("shadedPerPixel", width > 0 && height > 0 ? shadedFragments / ((double)width * height) : 0.0);
+    stats.setCounter("depthComplexity", FrameStats::summarize(complexitySamples).mean);
+    stats.setCounter("depthPrepassPercent", complexitySamples.empty() ? 0.0 : 100.0 * prepassFrames / complexitySamples.size());
+}
+
+bool MainWindow::cookSceneTextures(bool force)
+{
+    // Normal maps stay uncompressed, DXT5 blocks visibly band the lighting
+    for (int normal = 0; normal < 2; normal++)
+    {
+        std::string path = getSceneTexturePath(normal == 1);
+        std::string cooked = TextureCooker::getCookedPath(path);
+        if (!force && TextureCooker::isUpToDate(path, cooked))
+            continue;
+
+        auto begin = std::chrono::steady_clock::now();
+        if (!TextureCooker::cook(path, cooked, normal == 0))
+        {
+            std::cout << "Failed to cook " << path << std::endl;
+            return false;
+        }
+        std::cout << "Cooked " << cooked << " in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() << " ms" << std::endl;
+    }
+
+    return true;
+}
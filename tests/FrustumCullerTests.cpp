@@ -0,0 +1,65 @@
+#include "Tests.h"
+#include "Benchmark/Random.h"
+#include "Rendering/FrustumCuller.h"
+
+#include <cmath>
+#include <vector>
+
+// The SIMD kernel has to agree with the scalar reference sphere for sphere
+static bool matchesReference(FrustumCuller& culler)
+{
+    size_t visible = culler.cullScalar();
+    std::vector<uint8_t> reference = culler.getVisibility();
+    size_t simdVisible = culler.cull();
+    TEST_CHECK(simdVisible == visible, "SIMD culling found " << simdVisible << " visible spheres, the scalar reference " << visible);
+    TEST_CHECK(culler.getVisibility() == reference, "SIMD culling marks different spheres visible than the scalar reference");
+    return true;
+}
+
+bool testFrustumCuller()
+{
+    FrustumCuller culler;
+    glm::mat4 viewProjection = getTestViewProjection();
+    culler.setFrustum(viewProjection);
+
+    // Known cases around the camera, looking from z = -50 towards the origin
+    culler.resize(4);
+    culler.set(0, glm::vec3(0.f), 1.f);
+    culler.set(1, glm::vec3(0.f, 0.f, -60.f), 1.f);
+    culler.set(2, glm::vec3(0.f, 0.f, 200.f), 1.f);
+    culler.set(3, glm::vec3(0.f, 0.f, 99.5f), 1.f);
+    TEST_CHECK(culler.cull() == 2, "expected the spheres at the origin and across the far plane to be visible");
+    TEST_CHECK(culler.isVisible(0) && !culler.isVisible(1) && !culler.isVisible(2) && culler.isVisible(3),
+               "wrong spheres visible in the known cases");
+
+    // Spheres just inside and just outside the left plane, where rounding matters most
+    Random random(7u);
+    culler.resize(1000);
+    glm::vec4 left = culler.getPlane(0);
+    for (size_t i = 0; i < 1000; i++)
+    {
+        glm::vec3 center(random.next(-60.f, 60.f), random.next(-40.f, 40.f), random.next(-40.f, 90.f));
+        float distance = glm::dot(glm::vec3(left), center) + left.w;
+        float radius = std::fabs(distance) + random.next(-1e-4f, 1e-4f);
+        culler.set(i, center, radius);
+    }
+    if (!matchesReference(culler))
+        return false;
+
+    // Counts that leave partial kernel batches, below and above the parallel threshold
+    const size_t counts[] = { 1, 7, 9, 1003, 100003 };
+    for (size_t count : counts)
+    {
+        culler.resize(count);
+        for (size_t i = 0; i < count; i++)
+            culler.set(i, glm::vec3(random.next(-100.f, 100.f), random.next(-100.f, 100.f), random.next(-100.f, 100.f)), random.next(0.1f, 2.f));
+        if (!matchesReference(culler))
+            return false;
+    }
+
+    // Spheres added one at a time after a clear go through the same padding
+    culler.clear();
+    for (int i = 0; i < 13; i++)
+        culler.add(glm::vec3(0.f, 0.f, -45.f + 10.f * i), 0.5f);
+    return matchesReference(culler);
+}
@@ -0,0 +1,49 @@
+#include "Tests.h"
+#include "Jobs/JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+bool testJobSystem()
+{
+    JobSystem* jobs = JobSystem::getInstance();
+
+    // Dependents taken before their dependency is done wait for it parked, then all run after it
+    std::atomic<bool> gate(false);
+    std::atomic<int> produced(0);
+    std::atomic<int> ranAfter(0);
+    JobSystem::Counter first(0);
+    JobSystem::Counter dependents(0);
+    jobs->run([&gate, &produced] {
+        while (!gate.load())
+            std::this_thread::yield();
+        produced = 1;
+    }, &first);
+    const int DEPENDENT_COUNT = 1000;
+    for (int i = 0; i < DEPENDENT_COUNT; i++)
+        jobs->run([&produced, &ranAfter] { ranAfter += produced.load(); }, &dependents, &first);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    gate = true;
+    jobs->wait(dependents);
+    TEST_CHECK(first.load() == 0 && ranAfter.load() == DEPENDENT_COUNT,
+               ranAfter.load() << " of " << DEPENDENT_COUNT << " dependents ran after their dependency");
+
+    // Far more jobs than the ring holds queued at once, none may be overwritten while it waits
+    const size_t JOB_COUNT = JobSystem::QUEUE_CAPACITY * 4;
+    std::atomic<uint64_t> sum(0);
+    JobSystem::Counter counter(0);
+    for (size_t i = 0; i < JOB_COUNT; i++)
+    {
+        jobs->run([&sum, i] {
+            volatile float work = 0.f;
+            for (int k = 0; k < 200; k++)
+                work = work + (float)k;
+            sum += i;
+        }, &counter);
+    }
+    jobs->wait(counter);
+    uint64_t expected = (uint64_t)JOB_COUNT * (JOB_COUNT - 1) / 2;
+    TEST_CHECK(sum.load() == expected, "jobs summed to " << sum.load() << ", expected " << expected);
+    return true;
+}
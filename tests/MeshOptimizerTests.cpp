@@ -0,0 +1,105 @@
+#include "Tests.h"
+#include "Benchmark/Random.h"
+#include "Meshes/MeshData.h"
+#include "Meshes/MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+typedef std::array<float, 9> TrianglePositions;
+
+// Triangles by their corner positions, each rotated to start at its smallest corner so winding is kept
+static std::vector<TrianglePositions> getTriangles(const MeshData& mesh)
+{
+    std::vector<TrianglePositions> triangles;
+    for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+    {
+        std::array<std::array<float, 3>, 3> corners;
+        for (int c = 0; c < 3; c++)
+        {
+            const float* vertex = &mesh.vertices[mesh.indices[t + c] * 5];
+            corners[c] = { vertex[0], vertex[1], vertex[2] };
+        }
+        std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+
+        TrianglePositions triangle;
+        for (int c = 0; c < 3; c++)
+            std::copy(corners[c].begin(), corners[c].end(), triangle.begin() + c * 3);
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+bool testMeshOptimizer()
+{
+    // A bumpy grid with its triangles shuffled and one vertex nothing uses
+    const int GRID = 64;
+    MeshData mesh;
+    Random random(99u);
+    for (int y = 0; y <= GRID; y++)
+    {
+        for (int x = 0; x <= GRID; x++)
+        {
+            float height = random.next(0.f, 0.25f);
+            mesh.vertices.insert(mesh.vertices.end(), { (float)x, height, (float)y, (float)x / GRID, (float)y / GRID });
+            // Tangents carry the position so the test can see they move with their vertex
+            mesh.tangents.insert(mesh.tangents.end(), { (float)x, height, (float)y, 0.f, 0.f, 1.f });
+        }
+    }
+    mesh.vertices.insert(mesh.vertices.end(), { -1.f, -1.f, -1.f, 0.f, 0.f });
+    mesh.tangents.insert(mesh.tangents.end(), { -1.f, -1.f, -1.f, 0.f, 0.f, 1.f });
+    const size_t usedVertices = (GRID + 1) * (GRID + 1);
+
+    std::vector<std::array<unsigned int, 3>> grid;
+    for (int y = 0; y < GRID; y++)
+    {
+        for (int x = 0; x < GRID; x++)
+        {
+            unsigned int i = y * (GRID + 1) + x;
+            grid.push_back({ i, i + GRID + 1, i + 1 });
+            grid.push_back({ i + 1, i + GRID + 1, i + GRID + 2 });
+        }
+    }
+    for (size_t i = grid.size() - 1; i > 0; i--)
+        std::swap(grid[i], grid[(size_t)random.next(0.f, (float)(i + 1))]);
+    for (const std::array<unsigned int, 3>& triangle : grid)
+        mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+    std::vector<TrianglePositions> triangles = getTriangles(mesh);
+
+    MeshOptimizer::CacheStats shuffled = MeshOptimizer::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.getVertexCount());
+
+    // The cache pass has to beat the shuffled order by far and get near the grid's best
+    MeshOptimizer::optimizeVertexCache(mesh.indices, mesh.getVertexCount());
+    MeshOptimizer::CacheStats cached = MeshOptimizer::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.getVertexCount());
+    TEST_CHECK(getTriangles(mesh) == triangles, "vertex cache optimization changed the triangles");
+    TEST_CHECK(cached.acmr < shuffled.acmr * 0.5f && cached.acmr < 0.8f,
+               "vertex cache optimization only took the ACMR from " << shuffled.acmr << " to " << cached.acmr);
+
+    // The overdraw pass may give up at most its threshold of that
+    MeshOptimizer::optimizeOverdraw(mesh.indices, mesh.vertices);
+    MeshOptimizer::CacheStats sorted = MeshOptimizer::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.getVertexCount());
+    TEST_CHECK(getTriangles(mesh) == triangles, "overdraw optimization changed the triangles");
+    TEST_CHECK(sorted.acmr <= cached.acmr * 1.05f + 1e-4f, "overdraw optimization raised the ACMR from " << cached.acmr << " to " << sorted.acmr);
+
+    // Vertices renumbered in order of first use, the unused one dropped, tangents moved along
+    MeshOptimizer::optimizeVertexFetch(mesh);
+    TEST_CHECK(mesh.getVertexCount() == usedVertices && mesh.tangents.size() == usedVertices * 6,
+               mesh.getVertexCount() << " vertices left, expected " << usedVertices);
+    TEST_CHECK(getTriangles(mesh) == triangles, "vertex fetch optimization changed the triangles");
+    unsigned int next = 0;
+    for (unsigned int index : mesh.indices)
+    {
+        TEST_CHECK(index <= next, "vertex " << index << " used before vertex " << next);
+        if (index == next)
+            next++;
+    }
+    for (size_t i = 0; i < usedVertices; i++)
+    {
+        TEST_CHECK(mesh.tangents[i * 6] == mesh.vertices[i * 5] && mesh.tangents[i * 6 + 1] == mesh.vertices[i * 5 + 1]
+                       && mesh.tangents[i * 6 + 2] == mesh.vertices[i * 5 + 2],
+                   "tangent of vertex " << i << " not moved with it");
+    }
+    return true;
+}
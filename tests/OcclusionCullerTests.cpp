@@ -0,0 +1,89 @@
+#include "Tests.h"
+#include "Benchmark/Random.h"
+#include "Rendering/OcclusionCuller.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vector>
+
+static glm::mat4 getBoxModel(const glm::vec3& position, float size)
+{
+    return glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(size));
+}
+
+bool testOcclusionCuller()
+{
+    const size_t BOX_COUNT = 20000;
+    const int WALL_COLUMNS = 8;
+    const int WALL_ROWS = 6;
+    const float WALL_Z = 20.f;
+
+    // The occlusion benchmark's scene: a wall of slabs with gaps between them, 70 units in front of the camera
+    glm::mat4 viewProjection = getTestViewProjection();
+    Bounds unitBox;
+    unitBox.add(glm::vec3(-0.5f));
+    unitBox.add(glm::vec3(0.5f));
+    OccluderMesh slab;
+    slab.setBox(unitBox);
+    OcclusionCuller occlusionCuller;
+    occlusionCuller.begin(viewProjection);
+    for (int row = 0; row < WALL_ROWS; row++)
+    {
+        for (int column = 0; column < WALL_COLUMNS; column++)
+        {
+            glm::vec3 position((column - (WALL_COLUMNS - 1) * 0.5f) * 5.f, (row - (WALL_ROWS - 1) * 0.5f) * 5.f, WALL_Z);
+            occlusionCuller.addOccluder(slab, glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(4.f, 4.f, 1.f)));
+        }
+    }
+    // At most three faces of a box face the camera, and every slab's front face does
+    size_t triangles = occlusionCuller.getTriangleCount();
+    TEST_CHECK(triangles >= WALL_COLUMNS * WALL_ROWS * 2 && triangles <= WALL_COLUMNS * WALL_ROWS * 6,
+               triangles << " triangles set up for " << WALL_COLUMNS * WALL_ROWS << " slabs, back faces kept or front faces lost");
+
+    // The kernel must match the reference on every pixel, on one thread and split into jobs
+    occlusionCuller.rasterizeScalar();
+    std::vector<float> reference = occlusionCuller.getDepth();
+    occlusionCuller.rasterize(false);
+    TEST_CHECK(occlusionCuller.getDepth() == reference, "serial SIMD rasterization disagrees with the scalar reference");
+    occlusionCuller.rasterize(true);
+    TEST_CHECK(occlusionCuller.getDepth() == reference, "parallel SIMD rasterization disagrees with the scalar reference");
+
+    // A box seen through a gap between slabs stays visible
+    TEST_CHECK(occlusionCuller.isVisible(unitBox, getBoxModel(glm::vec3(0.f, 0.f, 60.f), 0.2f)), "box seen through a gap occluded");
+
+    // Against one large slab: behind it, in front of it, reaching past its edge, off the screen and around the camera
+    OcclusionCuller single;
+    single.begin(viewProjection);
+    single.addOccluder(slab, glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.f, 0.f, WALL_Z)), glm::vec3(30.f, 30.f, 1.f)));
+    single.rasterize();
+    TEST_CHECK(!single.isVisible(unitBox, getBoxModel(glm::vec3(2.5f, 2.5f, 30.f), 0.5f)), "box behind the slab not occluded");
+    TEST_CHECK(single.isVisible(unitBox, getBoxModel(glm::vec3(2.5f, 2.5f, 10.f), 0.5f)), "box in front of the slab occluded");
+    TEST_CHECK(single.isVisible(unitBox, getBoxModel(glm::vec3(16.f, 0.f, 30.f), 4.f)), "box reaching past the slab's edge occluded");
+    TEST_CHECK(single.isVisible(unitBox, getBoxModel(glm::vec3(500.f, 0.f, 30.f), 1.f)), "box off the screen occluded");
+    TEST_CHECK(single.isVisible(unitBox, getBoxModel(glm::vec3(0.f, 0.f, -50.f), 1.f)), "box through the near plane occluded");
+
+    // Nothing reaching in front of the slabs' front faces (half a unit before WALL_Z) may be hidden
+    Random random(12345u);
+    FrustumCuller culler;
+    culler.setFrustum(viewProjection);
+    culler.resize(BOX_COUNT);
+    occlusionCuller.resize(BOX_COUNT);
+    std::vector<float> boxFront(BOX_COUNT);
+    for (size_t i = 0; i < BOX_COUNT; i++)
+    {
+        glm::vec3 position(random.next(-40.f, 40.f), random.next(-30.f, 30.f), random.next(-60.f, 35.f));
+        float size = random.next(0.2f, 2.f);
+        culler.set(i, position, size * 0.8660254f);
+        occlusionCuller.set(i, unitBox, getBoxModel(position, size));
+        boxFront[i] = position.z - size * 0.5f;
+    }
+    culler.cull();
+    size_t occluded = occlusionCuller.cull(culler.getVisibility().data());
+    TEST_CHECK(occluded > 0, "no box behind the wall occluded");
+    for (size_t i = 0; i < BOX_COUNT; i++)
+    {
+        TEST_CHECK(!occlusionCuller.isOccluded(i) || culler.isVisible(i), "box " << i << " outside the frustum tested");
+        TEST_CHECK(!occlusionCuller.isOccluded(i) || boxFront[i] >= WALL_Z - 0.5f, "box " << i << " in front of the occluders hidden");
+    }
+    return true;
+}
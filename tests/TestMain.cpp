@@ -0,0 +1,47 @@
+#include "Tests.h"
+#include "Jobs/JobSystem.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+glm::mat4 getTestViewProjection()
+{
+    glm::mat4 projection = glm::perspective(glm::radians(45.f), 800.f / 600.f, 0.1f, 150.f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.f, 0.f, -50.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+    return projection * view;
+}
+
+int main()
+{
+    // A few workers even on small CI machines, so the parallel paths run too
+    JobSystem::getInstance()->start(3);
+
+    struct Suite
+    {
+        const char* name;
+        bool (*run)();
+    };
+    const Suite suites[] = {
+        { "JobSystem", testJobSystem },
+        { "FrustumCuller", testFrustumCuller },
+        { "OcclusionCuller", testOcclusionCuller },
+        { "MeshOptimizer", testMeshOptimizer },
+    };
+
+    int failed = 0;
+    for (const Suite& suite : suites)
+    {
+        std::cout << suite.name << std::endl;
+        if (!suite.run())
+            failed++;
+    }
+
+    JobSystem::getInstance()->stop();
+
+    if (failed > 0)
+    {
+        std::cout << failed << " test suite(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All tests passed" << std::endl;
+    return 0;
+}
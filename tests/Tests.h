@@ -0,0 +1,33 @@
+#ifndef TESTS_H
+#define TESTS_H
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+
+/*!
+    GL-free checks of the CPU systems, built by make test. Each suite prints what failed and
+    returns false, or returns true when every check passed.
+*/
+bool testJobSystem();
+bool testFrustumCuller();
+bool testOcclusionCuller();
+bool testMeshOptimizer();
+
+// Prints message and fails the enclosing suite when condition is false
+#define TEST_CHECK(condition, message)                                   \
+    do                                                                   \
+    {                                                                    \
+        if (!(condition))                                                \
+        {                                                                \
+            std::cout << "  FAILED: " << message << std::endl;           \
+            return false;                                                \
+        }                                                                \
+    } while (0)
+
+/*!
+    The default scene camera's view projection: 45 degrees vertical, 4:3, 50 units behind the origin
+*/
+glm::mat4 getTestViewProjection();
+
+#endif // TESTS_H